@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <math.h>
+#include "adaptive.h"
+#include "interval.h"
+
+typedef struct {
+    double a, fa, b, fb;
+    int    curved;      /* the parent's midpoint was off its chord */
+} Span;
+
+typedef struct {
+    double *v;
+    long    n, cap;
+} Buffer;
+
+static void push(Buffer *buf, double v) {
+    if (buf->n == buf->cap) {
+        buf->cap = buf->cap ? buf->cap * 2 : 1024;
+        buf->v = realloc(buf->v, buf->cap * sizeof(double));
+    }
+    buf->v[buf->n++] = v;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void evaluateBlocks(const Sampler *s, const double *xs, double *ys, long n) {
+    for (long done = 0; done < n; done += EVAL_BATCH_SIZE) {
+        int count = n - done < EVAL_BATCH_SIZE ? (int)(n - done) : EVAL_BATCH_SIZE;
+        evaluatePoints(s, xs + done, ys + done, count);
+    }
+}
+
+/* Height of the curve over the grid, ignoring the top and bottom 2% of
+ * the values so that a pole does not set the scale. */
+static double curveHeight(const double *ys, long n) {
+    double *v = malloc(n * sizeof(double));
+    long m = 0;
+    for (long i = 0; i < n; i++) {
+        if (isfinite(ys[i])) v[m++] = ys[i];
+    }
+    double height = 0;
+    if (m > 0) {
+        qsort(v, m, sizeof(double), compareDoubles);
+        long q = m / 50;
+        height = v[m - 1 - q] - v[q];
+        if (!(height > 0)) height = fabs(v[m / 2]);
+    }
+    free(v);
+    return height > 0 && isfinite(height) ? height : 1.0;
+}
+
+/* ---------- refinement ---------------------------------------------------- */
+
+/* Whether interval evaluation leaves room for finite values in [a, b]. */
+static int mayBeFinite(const ASTNode *node, double a, double b) {
+    Interval v = evaluateInterval(node, a, b);
+    return v.def != IV_EMPTY && !(v.lo == v.hi && isinf(v.lo));
+}
+
+/* Decides whether the half [a, b] of a span just bisected at level `level`
+ * needs its own midpoint.  Interval bounds over the span overrule the
+ * points where they can: a span bounded within the tolerance is flat
+ * enough whatever its midpoint, one that may hold NaN between two defined
+ * ends hides a hole, and one undefined at both ends may still hold an
+ * island of defined points.  `curved` says the midpoint of the span or of
+ * its parent was off the chord; looking one level back catches a span
+ * centred on an inflection, whose midpoint sits on the chord although the
+ * curve does not.  A jump is only followed into a half that holds more
+ * than `jump_floor` of it (most of the parent's, and no less than the
+ * other half's); one still there at the finest level is recorded as a
+ * break. */
+static int needsMidpoint(const ASTNode *node, double a, double fa, double b, double fb,
+                         int level, int curved, double jump_floor, double jump,
+                         double tolerance, Buffer *breaks) {
+    int finite_a = isfinite(fa), finite_b = isfinite(fb);
+    if (!finite_a && !finite_b) return level < ADAPTIVE_CURVE_LEVELS && mayBeFinite(node, a, b);
+    // One end undefined: home in on the boundary; the undefined points
+    // themselves split the curve
+    if (finite_a != finite_b) return level < ADAPTIVE_EDGE_LEVELS;
+    Interval v = evaluateInterval(node, a, b);
+    if (v.def == IV_DEFINED && v.hi - v.lo <= tolerance) return 0;
+    if (v.def != IV_DEFINED && level < ADAPTIVE_CURVE_LEVELS) return 1;
+    if (curved && level < ADAPTIVE_CURVE_LEVELS) return 1;
+    double d = fabs(fb - fa);
+    if (d <= jump || !(d >= jump_floor)) return 0;
+    if (level < ADAPTIVE_EDGE_LEVELS) return 1;
+    push(breaks, 0.5 * (a + b));
+    return 0;
+}
+
+void sampleAdaptive(const Sampler *s, double x_min, double x_max, AdaptiveSamples *out) {
+    out->xy = NULL;
+    out->n = 0;
+    out->evaluations = 0;
+    if (!(x_max > x_min)) return;
+
+    Buffer xs = {0}, ys = {0}, breaks = {0};
+    long n0 = ADAPTIVE_INITIAL;
+    double range = x_max - x_min;
+
+    for (long i = 0; i <= n0; i++) push(&xs, i == n0 ? x_max : x_min + range * i / n0);
+    ys.v = malloc(xs.n * sizeof(double));
+    ys.n = ys.cap = xs.n;
+    evaluateBlocks(s, xs.v, ys.v, xs.n);
+    out->evaluations = xs.n;
+
+    double height = curveHeight(ys.v, ys.n);
+    double tolerance = ADAPTIVE_TOLERANCE * height;
+    double jump = ADAPTIVE_JUMP * height;
+
+    // Breadth first: the midpoints of one level are evaluated as a batch
+    long n_spans = 0, cap_spans = n0, cap_next = 0, cap_mid = 0;
+    Span *spans = malloc(cap_spans * sizeof(Span)), *next = NULL;
+    double *mx = NULL, *my = NULL;
+    for (long i = 0; i < n0; i++) {
+        // A grid span has no parent; the spans of twice the width around
+        // its ends stand in for it
+        const double *y = ys.v;
+        int curved = (i > 0 && !(fabs(y[i] - 0.5 * (y[i - 1] + y[i + 1])) <= tolerance)) ||
+                     (i + 1 < n0 && !(fabs(y[i + 1] - 0.5 * (y[i] + y[i + 2])) <= tolerance));
+        Span sp = { xs.v[i], y[i], xs.v[i + 1], y[i + 1], curved };
+        if (isfinite(sp.fa) || isfinite(sp.fb) || mayBeFinite(s->node, sp.a, sp.b))
+            spans[n_spans++] = sp;
+    }
+
+    for (int level = 1; n_spans > 0 && !sampleCancelled(); level++) {
+        if (n_spans > cap_mid) {
+            cap_mid = n_spans;
+            mx = realloc(mx, cap_mid * sizeof(double));
+            my = realloc(my, cap_mid * sizeof(double));
+        }
+        if (2 * n_spans > cap_next) {
+            cap_next = 2 * n_spans;
+            next = realloc(next, cap_next * sizeof(Span));
+        }
+        for (long k = 0; k < n_spans; k++) mx[k] = 0.5 * (spans[k].a + spans[k].b);
+        evaluateBlocks(s, mx, my, n_spans);
+        out->evaluations += n_spans;
+
+        long n_next = 0;
+        for (long k = 0; k < n_spans; k++) {
+            Span *sp = &spans[k];
+            double m = mx[k], fm = my[k];
+            push(&xs, m);
+            push(&ys, fm);
+            int curved = !(fabs(fm - 0.5 * (sp->fa + sp->fb)) <= tolerance);
+            int follow = curved || sp->curved;
+            double share = ADAPTIVE_JUMP_SHARE * fabs(sp->fb - sp->fa);
+            double left = fabs(fm - sp->fa), right = fabs(sp->fb - fm);
+            if (needsMidpoint(s->node, sp->a, sp->fa, m, fm, level, follow, fmax(share, right),
+                              jump, tolerance, &breaks))
+                next[n_next++] = (Span){ sp->a, sp->fa, m, fm, curved };
+            if (needsMidpoint(s->node, m, fm, sp->b, sp->fb, level, follow, fmax(share, left),
+                              jump, tolerance, &breaks))
+                next[n_next++] = (Span){ m, fm, sp->b, sp->fb, curved };
+        }
+        if (out->evaluations + n_next > ADAPTIVE_MAX_POINTS) break;
+
+        Span *t = spans;
+        long cap_t = cap_spans;
+        spans = next;
+        cap_spans = cap_next;
+        next = t;
+        cap_next = cap_t;
+        n_spans = n_next;
+    }
+    free(spans);
+    free(next);
+    free(mx);
+    free(my);
+
+    /* ---------- assembly: sort by x, split at undefined points and jumps -- */
+    long n = xs.n;
+    double *pts = malloc(n * 2 * sizeof(double));
+    for (long i = 0; i < n; i++) {
+        pts[2 * i] = xs.v[i];
+        pts[2 * i + 1] = ys.v[i];
+    }
+    qsort(pts, n, 2 * sizeof(double), compareDoubles);
+    if (breaks.n > 1) qsort(breaks.v, breaks.n, sizeof(double), compareDoubles);
+
+    Buffer xy = {0};
+    long b = 0;
+    int started = 0, split = 0;
+    for (long i = 0; i < n; i++) {
+        double x = pts[2 * i], y = pts[2 * i + 1];
+        for (; b < breaks.n && breaks.v[b] < x; b++) split = started;
+        if (!isfinite(y)) {
+            split = started;
+            continue;
+        }
+        if (split) {
+            push(&xy, NAN);
+            push(&xy, NAN);
+            split = 0;
+        }
+        push(&xy, x);
+        push(&xy, y);
+        started = 1;
+    }
+    out->xy = xy.v;
+    out->n = xy.n / 2;
+
+    free(pts);
+    free(xs.v);
+    free(ys.v);
+    free(breaks.v);
+}
+
+void freeAdaptiveSamples(AdaptiveSamples *samples) {
+    free(samples->xy);
+    samples->xy = NULL;
+    samples->n = 0;
+}
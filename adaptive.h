@@ -0,0 +1,39 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include "sampler.h"
+
+/* Adaptive sampling: starts from a coarse grid and bisects an interval
+ * wherever its midpoint is off the straight line between its ends by more
+ * than a fraction of the curve's height.  Intervals whose ends straddle a
+ * NaN boundary or a jump (e.g. the poles of tan(x) or 1/x) are narrowed
+ * down to a tiny width and the curve is split there, so no vertical line
+ * is drawn across them. */
+
+/* Coarse grid intervals before refinement. */
+#define ADAPTIVE_INITIAL 256
+/* Midpoint deviation that triggers a split, relative to the curve height. */
+#define ADAPTIVE_TOLERANCE 1e-3
+/* A jump this large, relative to the height, that survives bisection down
+ * to the finest width is treated as a discontinuity.  Bisecting a steep
+ * but continuous stretch roughly halves the jump, so the search only
+ * follows the half that keeps most of its parent's jump. */
+#define ADAPTIVE_JUMP 0.05
+#define ADAPTIVE_JUMP_SHARE 0.9
+/* Bisection levels below the grid: curvature refinement stops at
+ * range / 2^16, the search for an edge at range / 2^24. */
+#define ADAPTIVE_CURVE_LEVELS 8
+#define ADAPTIVE_EDGE_LEVELS  16
+/* Evaluation budget per curve. */
+#define ADAPTIVE_MAX_POINTS (1L << 20)
+
+typedef struct {
+    double *xy;             /* x y pairs in ascending x; (NaN, NaN) marks a break */
+    long    n;              /* pairs, breaks included */
+    long    evaluations;
+} AdaptiveSamples;
+
+void sampleAdaptive(const Sampler *s, double x_min, double x_max, AdaptiveSamples *out);
+void freeAdaptiveSamples(AdaptiveSamples *samples);
+
+#endif /* ADAPTIVE_H */
@@ -1,69 +1,193 @@
+#include <stdint.h>
+#include <pthread.h>
 #include "ast.h"
 #include "symtab.h"
+#include "vecmath.h"
+#include "stats.h"
+
+/* ---------- builtin names ------------------------------------------------- */
+
+static const char *builtin_names[FN_COUNT] = {
+    [FN_NONE] = "?",
+    [FN_SIN] = "sin", [FN_COS] = "cos", [FN_TAN] = "tan", [FN_EXP] = "exp",
+    [FN_LOG] = "log", [FN_SQRT] = "sqrt", [FN_ABS] = "abs", [FN_LN] = "ln",
+    [FN_ASIN] = "asin", [FN_ACOS] = "acos", [FN_ATAN] = "atan",
+    [FN_SINH] = "sinh", [FN_COSH] = "cosh", [FN_TANH] = "tanh",
+    [FN_CEIL] = "ceil", [FN_FLOOR] = "floor", [FN_SIGN] = "sign",
+    [FN_MAX] = "max", [FN_MIN] = "min",
+    [FN_FMA] = "fma",
+    [FN_DERIVATIVE] = "derivative",
+};
+
+BuiltinFunc builtinFunc(const char *name) {
+    for (int f = FN_NONE + 1; f < FN_COUNT; f++)
+        if (strcmp(builtin_names[f], name) == 0) return (BuiltinFunc)f;
+    return FN_NONE;
+}
+
+const char* builtinName(BuiltinFunc func) {
+    return (func > FN_NONE && func < FN_COUNT) ? builtin_names[func] : builtin_names[FN_NONE];
+}
+
+/* ---------- node arenas --------------------------------------------------- */
+
+/* Blocks are aligned to their size, so a node finds its arena by masking
+ * its own address. */
+#define ARENA_BLOCK_SIZE 16384
+
+typedef struct ArenaBlock {
+    ASTArena          *arena;
+    struct ArenaBlock *next;
+} ArenaBlock;
+
+struct ASTArena {
+    ArenaBlock *blocks;         /* newest first */
+    ArenaBlock *oldest;
+    char       *bump, *end;
+    ASTNode    *free_nodes;     /* linked through left */
+};
+
+static ASTArena    process_arena;
+static __thread ASTArena *current_arena = &process_arena;
+static ArenaBlock *spare_blocks;    /* released by arenaDestroy() */
+static pthread_mutex_t spare_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void addBlock(ASTArena *a) {
+    pthread_mutex_lock(&spare_lock);
+    ArenaBlock *b = spare_blocks;
+    if (b) spare_blocks = b->next;
+    pthread_mutex_unlock(&spare_lock);
+    if (!b) b = aligned_alloc(ARENA_BLOCK_SIZE, ARENA_BLOCK_SIZE);
+    b->arena = a;
+    b->next = a->blocks;
+    a->blocks = b;
+    if (!a->oldest) a->oldest = b;
+    a->bump = (char *)(b + 1);
+    a->end = (char *)b + ARENA_BLOCK_SIZE;
+}
+
+static ASTArena* arenaOf(ASTNode *node) {
+    return ((ArenaBlock *)((uintptr_t)node & ~(uintptr_t)(ARENA_BLOCK_SIZE - 1)))->arena;
+}
+
+ASTArena* arenaCreate(void) {
+    return calloc(1, sizeof(ASTArena));
+}
+
+void arenaDestroy(ASTArena *arena) {
+    if (!arena || arena == &process_arena) return;
+    if (current_arena == arena) current_arena = &process_arena;
+    if (arena->blocks) {
+        pthread_mutex_lock(&spare_lock);
+        arena->oldest->next = spare_blocks;
+        spare_blocks = arena->blocks;
+        pthread_mutex_unlock(&spare_lock);
+    }
+    free(arena);
+}
 
+ASTArena* arenaSwitch(ASTArena *arena) {
+    ASTArena *prev = current_arena;
+    current_arena = arena ? arena : &process_arena;
+    return prev == &process_arena ? NULL : prev;
+}
+
+static ASTNode* allocNode(NodeType type) {
+    ASTArena *a = current_arena;
+    ASTNode *n = a->free_nodes;
+    if (n) {
+        a->free_nodes = n->left;
+    } else {
+        if (a->bump + sizeof(ASTNode) > a->end) addBlock(a);
+        n = (ASTNode *)a->bump;
+        a->bump += sizeof(ASTNode);
+    }
+    STATS_COUNT(COUNTER_NODES_ALLOCATED, 1);
+    n->type = type;
+    n->op = 0;
+    n->func = FN_NONE;
+    n->refs = 1;
+    n->memo = -1;
+    n->value = 0;
+    n->left = n->right = n->arg2 = NULL;
+    return n;
+}
+
+ASTNode* persistAST(ASTNode *node) {
+    if (!node || arenaOf(node) == &process_arena) return node;
+    ASTArena *prev = arenaSwitch(NULL);
+    ASTNode *copy = copyAST(node);
+    arenaSwitch(prev);
+    freeAST(node);
+    return copy;
+}
+
+/* ---------- creation ------------------------------------------------------ */
 
 ASTNode* createNumberNode(double value) {
-    ASTNode *n = malloc(sizeof(ASTNode));
-    n->type = NODE_NUMBER;
+    ASTNode *n = allocNode(NODE_NUMBER);
     n->value = value;
-    n->left = n->right = n->arg2 = NULL;
     return n;
 }
 
 ASTNode* createVarNode() {
-    ASTNode *n = malloc(sizeof(ASTNode));
-    n->type = NODE_VAR;
-    n->left = n->right = n->arg2 = NULL;
-    return n;
+    return allocNode(NODE_VAR);
 }
 
 ASTNode* createIdentifierNode(const char *name) {
-    ASTNode *n = malloc(sizeof(ASTNode));
-    n->type = NODE_IDENTIFIER;
-    strncpy(n->name, name, 49);
-    n->name[49] = '\0';
-    n->left = n->right = n->arg2 = NULL;
+    ASTNode *n = allocNode(NODE_IDENTIFIER);
+    n->name = internName(name);
     return n;
 }
 
 ASTNode* createOpNode(char op, ASTNode *left, ASTNode *right) {
-    ASTNode *n = malloc(sizeof(ASTNode));
-    n->type = NODE_OP;
+    ASTNode *n = allocNode(NODE_OP);
     n->op = op;
     n->left = left;
     n->right = right;
-    n->arg2 = NULL;
     return n;
 }
 
-ASTNode* createFuncNode(const char *func, ASTNode *child) {
-    ASTNode *n = malloc(sizeof(ASTNode));
-    n->type = NODE_FUNC;
-    strncpy(n->func, func, 19);
-    n->func[19] = '\0';
+ASTNode* createFuncNode(BuiltinFunc func, ASTNode *child) {
+    ASTNode *n = allocNode(NODE_FUNC);
+    n->func = func;
     n->left = child;
-    n->right = n->arg2 = NULL;
     return n;
 }
 
-ASTNode* createFunc2Node(const char *func, ASTNode *arg1, ASTNode *arg2) {
-    ASTNode *n = malloc(sizeof(ASTNode));
-    n->type = NODE_FUNC2;
-    strncpy(n->func, func, 19);
-    n->func[19] = '\0';
+ASTNode* createFunc2Node(BuiltinFunc func, ASTNode *arg1, ASTNode *arg2) {
+    ASTNode *n = allocNode(NODE_FUNC2);
+    n->func = func;
     n->left = arg1;
     n->right = arg2;
-    n->arg2 = NULL;
     return n;
 }
 
-ASTNode *createDerivative(const char *func, ASTNode *child) {
-    ASTNode *n = malloc(sizeof(ASTNode));
-    n->type = NODE_DERIVATIVE;
-    strncpy(n->func, func, 19);
-    n->func[19] = '\0';
+ASTNode* createFunc3Node(BuiltinFunc func, ASTNode *arg1, ASTNode *arg2, ASTNode *arg3) {
+    ASTNode *n = allocNode(NODE_FUNC3);
+    n->func = func;
+    n->left = arg1;
+    n->right = arg2;
+    n->arg2 = arg3;
+    return n;
+}
+
+ASTNode *createDerivative(BuiltinFunc func, ASTNode *child) {
+    ASTNode *n = allocNode(NODE_DERIVATIVE);
+    n->func = func;
     n->left = child;
-    n->right = n->arg2 = NULL;
+    return n;
+}
+
+ASTNode* copyAST(ASTNode *node) {
+    if (!node) return NULL;
+    ASTNode *n = allocNode(node->type);
+    n->op = node->op;
+    n->func = node->func;
+    n->value = node->value;
+    n->left = copyAST(node->left);
+    n->right = copyAST(node->right);
+    n->arg2 = copyAST(node->arg2);
     return n;
 }
 
@@ -72,9 +196,17 @@ double derivative(ASTNode *expr, double x) {
     return (evaluate(expr, x + h) - evaluate(expr, x - h)) / (2*h);
 }
 
-double evaluate(ASTNode *node, double x) {
-    if (!node) return 0;
+/* Per-call cache for nodes shared by hashConsAST(): each shared node is
+ * computed once per sample.  Lives on the caller's stack, so evaluate()
+ * stays reentrant. */
+typedef struct {
+    double             value[EVAL_MEMO_SLOTS];
+    unsigned long long valid;
+} EvalMemo;
 
+static double evalMemo(ASTNode *node, double x, EvalMemo *memo);
+
+static double evalNode(ASTNode *node, double x, EvalMemo *memo) {
     switch (node->type) {
         case NODE_NUMBER:
             return node->value;
@@ -83,57 +215,66 @@ double evaluate(ASTNode *node, double x) {
             return x;
         
         case NODE_IDENTIFIER: {
-            double *val = lookupVariable(node->name);
+            double *val = lookupVariableId(node->name);
             if (val) return *val;
             
-            ASTNode *func = lookupFunction(node->name);
+            ASTNode *func = lookupFunctionId(node->name);
             if (func) return evaluate(func, x);
             
-            fprintf(stderr, "\033[1;31mError: Undefined identifier '%s'\033[0m\n", node->name);
+            fprintf(stderr, "\033[1;31mError: Undefined identifier '%s'\033[0m\n", symbolName(node->name));
             return NAN;
         }
         
         case NODE_OP:
             switch (node->op) {
-                case '+': return evaluate(node->left, x) + evaluate(node->right, x);
-                case '-': return evaluate(node->left, x) - evaluate(node->right, x);
-                case '*': return evaluate(node->left, x) * evaluate(node->right, x);
+                case '+': return evalMemo(node->left, x, memo) + evalMemo(node->right, x, memo);
+                case '-': return evalMemo(node->left, x, memo) - evalMemo(node->right, x, memo);
+                case '*': return evalMemo(node->left, x, memo) * evalMemo(node->right, x, memo);
                 case '/': {
-                    double denom = evaluate(node->right, x);
+                    double denom = evalMemo(node->right, x, memo);
                     if (fabs(denom) < 1e-10) return NAN;
-                    return evaluate(node->left, x) / denom;
+                    return evalMemo(node->left, x, memo) / denom;
                 }
-                case '^': return pow(evaluate(node->left, x), evaluate(node->right, x));
-                case '~': return -evaluate(node->left, x);
+                case '^': return pow(evalMemo(node->left, x, memo), evalMemo(node->right, x, memo));
+                case '~': return -evalMemo(node->left, x, memo);
             }
             break;
         
         case NODE_FUNC: {
-            double arg = evaluate(node->left, x);
-            if (strcmp(node->func, "sin") == 0) return sin(arg);
-            if (strcmp(node->func, "cos") == 0) return cos(arg);
-            if (strcmp(node->func, "tan") == 0) return tan(arg);
-            if (strcmp(node->func, "exp") == 0) return exp(arg);
-            if (strcmp(node->func, "log") == 0) return (arg > 0) ? log10(arg) : NAN;
-            if (strcmp(node->func, "sqrt") == 0) return (arg >= 0) ? sqrt(arg) : NAN;
-            if (strcmp(node->func, "abs") == 0) return fabs(arg);
-            if (strcmp(node->func, "ln") == 0) return (arg > 0) ? log(arg) : NAN;
-            if (strcmp(node->func, "asin") == 0) return asin(arg);
-            if (strcmp(node->func, "acos") == 0) return acos(arg);
-            if (strcmp(node->func, "atan") == 0) return atan(arg);
-            if (strcmp(node->func, "sinh") == 0) return sinh(arg);
-            if (strcmp(node->func, "cosh") == 0) return cosh(arg);
-            if (strcmp(node->func, "tanh") == 0) return tanh(arg);
-            if (strcmp(node->func, "ceil") == 0) return ceil(arg);
-            if (strcmp(node->func, "floor") == 0) return floor(arg);
+            double arg = evalMemo(node->left, x, memo);
+            if (node->func == FN_SIN) return sin(arg);
+            if (node->func == FN_COS) return cos(arg);
+            if (node->func == FN_TAN) return tan(arg);
+            if (node->func == FN_EXP) return exp(arg);
+            if (node->func == FN_LOG) return (arg > 0) ? log10(arg) : NAN;
+            if (node->func == FN_SQRT) return (arg >= 0) ? sqrt(arg) : NAN;
+            if (node->func == FN_ABS) return fabs(arg);
+            if (node->func == FN_LN) return (arg > 0) ? log(arg) : NAN;
+            if (node->func == FN_ASIN) return asin(arg);
+            if (node->func == FN_ACOS) return acos(arg);
+            if (node->func == FN_ATAN) return atan(arg);
+            if (node->func == FN_SINH) return sinh(arg);
+            if (node->func == FN_COSH) return cosh(arg);
+            if (node->func == FN_TANH) return tanh(arg);
+            if (node->func == FN_CEIL) return ceil(arg);
+            if (node->func == FN_FLOOR) return floor(arg);
+            if (node->func == FN_SIGN) return (arg > 0) ? 1 : (arg < 0) ? -1 : arg;
             break;
         }
         
         case NODE_FUNC2: {
-            double arg1 = evaluate(node->left, x);
-            double arg2 = evaluate(node->right, x);
-            if (strcmp(node->func, "max") == 0) return (arg1 > arg2) ? arg1 : arg2;
-            if (strcmp(node->func, "min") == 0) return (arg1 < arg2) ? arg1 : arg2;
+            double arg1 = evalMemo(node->left, x, memo);
+            double arg2 = evalMemo(node->right, x, memo);
+            if (node->func == FN_MAX) return (arg1 > arg2) ? arg1 : arg2;
+            if (node->func == FN_MIN) return (arg1 < arg2) ? arg1 : arg2;
+            break;
+        }
+
+        case NODE_FUNC3: {
+            double arg1 = evalMemo(node->left, x, memo);
+            double arg2 = evalMemo(node->right, x, memo);
+            double arg3 = evalMemo(node->arg2, x, memo);
+            if (node->func == FN_FMA) return fma(arg1, arg2, arg3);
             break;
         }
 
@@ -143,12 +284,220 @@ double evaluate(ASTNode *node, double x) {
     return 0;
 }
 
+static double evalMemo(ASTNode *node, double x, EvalMemo *memo) {
+    if (!node) return 0;
+    int slot = node->memo;
+    if (slot >= 0 && slot < EVAL_MEMO_SLOTS) {
+        unsigned long long bit = 1ULL << slot;
+        if (memo->valid & bit) return memo->value[slot];
+        memo->value[slot] = evalNode(node, x, memo);
+        memo->valid |= bit;
+        return memo->value[slot];
+    }
+    return evalNode(node, x, memo);
+}
+
+double evaluate(ASTNode *node, double x) {
+    EvalMemo memo;
+    memo.valid = 0;
+    return evalMemo(node, x, &memo);
+}
+
+/* Column-at-a-time evaluation: every node is computed for all n points
+ * before its parent runs, so dispatch is paid once per node per block and
+ * the arithmetic itself runs in the vector kernels from vecmath.c. */
+typedef struct {
+    double             *scratch;    /* operand columns, used as a stack */
+    int                 top;        /* columns of scratch in use */
+    double             *cols;       /* one column per memo slot */
+    unsigned long long  valid;      /* slots whose column is computed */
+} BatchMemo;
+
+/* Operand columns that evaluating node holds at once, besides its output.
+ * need[] caches shared nodes, so a DAG is walked once per node. */
+static int columnsNeeded(const ASTNode *node, int *need) {
+    if (!node) return 0;
+    int slot = node->memo;
+    int shared = slot >= 0 && slot < EVAL_MEMO_SLOTS;
+    if (shared && need[slot] >= 0) return need[slot];
+    int left = columnsNeeded(node->left, need);
+    int right = columnsNeeded(node->right, need);
+    int arg2 = columnsNeeded(node->arg2, need);
+    int n = 0;
+    switch (node->type) {
+        case NODE_OP:
+            n = node->op == '~' ? left : (left > 1 + right ? left : 1 + right);
+            break;
+        case NODE_FUNC:
+            n = left;
+            break;
+        case NODE_FUNC2:
+            n = left > 1 + right ? left : 1 + right;
+            break;
+        case NODE_FUNC3:
+            n = left > 1 + right ? left : 1 + right;
+            if (2 + arg2 > n) n = 2 + arg2;
+            break;
+        case NODE_DERIVATIVE:       /* its body is evaluated on its own */
+            n = 2;
+            break;
+        default:
+            break;
+    }
+    if (shared) need[slot] = n;
+    return n;
+}
+
+static double* pushColumn(BatchMemo *memo, int n) {
+    return memo->scratch + (size_t)memo->top++ * n;
+}
+
+static void evaluateColumn(ASTNode *node, const double *xs, double *out, int n, BatchMemo *memo);
+
+/* One allocation per evaluation holds every operand column and the
+ * columns of shared nodes. */
+static void evaluateColumnFresh(ASTNode *node, const double *xs, double *out, int n) {
+    int need[EVAL_MEMO_SLOTS];
+    for (int i = 0; i < EVAL_MEMO_SLOTS; i++) need[i] = -1;
+    int depth = columnsNeeded(node, need);
+    int slots = 0;
+    for (int i = 0; i < EVAL_MEMO_SLOTS; i++)
+        if (need[i] >= 0) slots = i + 1;
+
+    BatchMemo memo = {NULL, 0, NULL, 0};
+    if (depth + slots > 0) memo.scratch = malloc((size_t)(depth + slots) * n * sizeof(double));
+    memo.cols = memo.scratch + (size_t)depth * n;
+    evaluateColumn(node, xs, out, n, &memo);
+    free(memo.scratch);
+}
+
+static void evaluateColumnNode(ASTNode *node, const double *xs, double *out, int n, BatchMemo *memo) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            vec_fill(out, node->value, n);
+            return;
+
+        case NODE_VAR:
+            memcpy(out, xs, n * sizeof(double));
+            return;
+
+        case NODE_IDENTIFIER: {
+            double *val = lookupVariableId(node->name);
+            if (val) {
+                vec_fill(out, *val, n);
+                return;
+            }
+
+            ASTNode *func = lookupFunctionId(node->name);
+            if (func) {
+                evaluateColumnFresh(func, xs, out, n);
+                return;
+            }
+
+            fprintf(stderr, "\033[1;31mError: Undefined identifier '%s'\033[0m\n", symbolName(node->name));
+            vec_fill(out, NAN, n);
+            return;
+        }
+
+        case NODE_OP: {
+            evaluateColumn(node->left, xs, out, n, memo);
+            if (node->op == '~') {
+                vec_neg(out, out, n);
+                return;
+            }
+            double *rhs = pushColumn(memo, n);
+            evaluateColumn(node->right, xs, rhs, n, memo);
+            switch (node->op) {
+                case '+': vec_add(out, out, rhs, n); break;
+                case '-': vec_sub(out, out, rhs, n); break;
+                case '*': vec_mul(out, out, rhs, n); break;
+                case '/': vec_div(out, out, rhs, n); break;
+                case '^': vec_pow(out, out, rhs, n); break;
+                default:  vec_fill(out, 0, n);
+            }
+            memo->top--;
+            return;
+        }
+
+        case NODE_FUNC:
+            evaluateColumn(node->left, xs, out, n, memo);
+            if (!vec_func(node->func, out, out, n)) vec_fill(out, 0, n);
+            return;
+
+        case NODE_FUNC2: {
+            evaluateColumn(node->left, xs, out, n, memo);
+            double *rhs = pushColumn(memo, n);
+            evaluateColumn(node->right, xs, rhs, n, memo);
+            if (node->func == FN_MAX) vec_max(out, out, rhs, n);
+            else if (node->func == FN_MIN) vec_min(out, out, rhs, n);
+            else vec_fill(out, 0, n);
+            memo->top--;
+            return;
+        }
+
+        case NODE_FUNC3: {
+            evaluateColumn(node->left, xs, out, n, memo);
+            double *mid = pushColumn(memo, n);
+            evaluateColumn(node->right, xs, mid, n, memo);
+            double *rhs = pushColumn(memo, n);
+            evaluateColumn(node->arg2, xs, rhs, n, memo);
+            if (node->func == FN_FMA) vec_fma(out, out, mid, rhs, n);
+            else vec_fill(out, 0, n);
+            memo->top -= 2;
+            return;
+        }
+
+        case NODE_DERIVATIVE: {
+            double h = 1e-5;
+            double *shifted = pushColumn(memo, n);
+            double *lower = pushColumn(memo, n);
+            for (int i = 0; i < n; i++) shifted[i] = xs[i] - h;
+            evaluateColumnFresh(node->left, shifted, lower, n);
+            for (int i = 0; i < n; i++) shifted[i] = xs[i] + h;
+            evaluateColumnFresh(node->left, shifted, out, n);
+            for (int i = 0; i < n; i++) out[i] = (out[i] - lower[i]) / (2*h);
+            memo->top -= 2;
+            return;
+        }
+    }
+    vec_fill(out, 0, n);
+}
+
+static void evaluateColumn(ASTNode *node, const double *xs, double *out, int n, BatchMemo *memo) {
+    if (!node) {
+        vec_fill(out, 0, n);
+        return;
+    }
+    int slot = node->memo;
+    if (slot < 0 || slot >= EVAL_MEMO_SLOTS) {
+        evaluateColumnNode(node, xs, out, n, memo);
+        return;
+    }
+    double *col = memo->cols + (size_t)slot * n;
+    unsigned long long bit = 1ULL << slot;
+    if (!(memo->valid & bit)) {
+        evaluateColumnNode(node, xs, out, n, memo);
+        memcpy(col, out, n * sizeof(double));
+        memo->valid |= bit;
+        return;
+    }
+    memcpy(out, col, n * sizeof(double));
+}
+
+void evaluateBatch(ASTNode *node, const double *xs, double *ys, int n) {
+    if (n <= 0) return;
+    evaluateColumnFresh(node, xs, ys, n);
+}
+
 void freeAST(ASTNode *node) {
     if (!node) return;
+    if (--node->refs > 0) return;   /* still shared by another parent */
     freeAST(node->left);
     freeAST(node->right);
     freeAST(node->arg2);
-    free(node);
+    ASTArena *a = arenaOf(node);
+    node->left = a->free_nodes;
+    a->free_nodes = node;
 }
 
 int validateAST(ASTNode *node) {
@@ -165,7 +514,7 @@ int validateAST(ASTNode *node) {
 
     // Check for log of non-positive constant
     if (node->type == NODE_FUNC &&
-        (strcmp(node->func, "log") == 0 || strcmp(node->func, "ln") == 0)) {
+        (node->func == FN_LOG || node->func == FN_LN)) {
         if (node->left && node->left->type == NODE_NUMBER &&
             node->left->value <= 0) {
             fprintf(stderr, "\033[1;31mError: log/ln of non-positive constant (%.2f)\033[0m\n",
@@ -175,7 +524,7 @@ int validateAST(ASTNode *node) {
     }
     
     // Check for sqrt of negative constant
-    if (node->type == NODE_FUNC && strcmp(node->func, "sqrt") == 0) {
+    if (node->type == NODE_FUNC && node->func == FN_SQRT) {
         if (node->left && node->left->type == NODE_NUMBER &&
             node->left->value < 0) {
             fprintf(stderr, "\033[1;31mError: sqrt of negative constant (%.2f)\033[0m\n",
@@ -191,6 +540,7 @@ void printAST(ASTNode *node, int indent) {
     if (!node) return;
 
     for (int i = 0; i < indent; i++) printf("  ");
+    if (node->memo >= 0) printf("#%d ", node->memo);
 
     switch (node->type) {
         case NODE_NUMBER:
@@ -200,7 +550,7 @@ void printAST(ASTNode *node, int indent) {
             printf("VAR: x\n");
             break;
         case NODE_IDENTIFIER:
-            printf("IDENTIFIER: %s\n", node->name);
+            printf("IDENTIFIER: %s\n", symbolName(node->name));
             break;
         case NODE_OP:
             printf("OP: %c\n", node->op);
@@ -208,26 +558,49 @@ void printAST(ASTNode *node, int indent) {
             printAST(node->right, indent + 1);
             break;
         case NODE_FUNC:
-            printf("FUNC: %s\n", node->func);
+            printf("FUNC: %s\n", builtinName(node->func));
             printAST(node->left, indent + 1);
             break;
         case NODE_FUNC2:
-            printf("FUNC2: %s\n", node->func);
+            printf("FUNC2: %s\n", builtinName(node->func));
             printAST(node->left, indent + 1);
             printAST(node->right, indent + 1);
             break;
+        case NODE_FUNC3:
+            printf("FUNC3: %s\n", builtinName(node->func));
+            printAST(node->left, indent + 1);
+            printAST(node->right, indent + 1);
+            printAST(node->arg2, indent + 1);
+            break;
         case NODE_DERIVATIVE:
-            printf("DERIV: %s\n", node->func);
+            printf("DERIV: %s\n", builtinName(node->func));
             printAST(node->left, indent + 1);
     }
 }
 
+/* Shared nodes already printed during the current top-level call. */
+static unsigned long long shown_shared;
+
 void printASTPretty(ASTNode *node, const char *prefix, int is_left) {
     if (!node) return;
+    if (prefix[0] == '\0') shown_shared = 0;   /* top-level call */
 
     printf("%s", prefix);
     printf("%s", is_left ? "├── " : "└── ");
 
+    // Shared (hash-consed) nodes are tagged and expanded only once
+    if (node->memo >= 0) {
+        if (node->memo < EVAL_MEMO_SLOTS) {
+            unsigned long long bit = 1ULL << node->memo;
+            if (shown_shared & bit) {
+                printf("\033[1;34m↑ shared #%d\033[0m\n", node->memo);
+                return;
+            }
+            shown_shared |= bit;
+        }
+        printf("\033[1;34m#%d\033[0m ", node->memo);
+    }
+
     switch (node->type) {
         case NODE_NUMBER:
             printf("\033[1;33mNUMBER\033[0m: %.4f\n", node->value);
@@ -236,7 +609,7 @@ void printASTPretty(ASTNode *node, const char *prefix, int is_left) {
             printf("\033[1;32mVAR\033[0m: x\n");
             break;
         case NODE_IDENTIFIER:
-            printf("\033[1;36mID\033[0m: %s\n", node->name);
+            printf("\033[1;36mID\033[0m: %s\n", symbolName(node->name));
             break;
         case NODE_OP: {
             printf("\033[1;31mOP\033[0m: %c\n", node->op);
@@ -255,7 +628,7 @@ void printASTPretty(ASTNode *node, const char *prefix, int is_left) {
             break;
         }
         case NODE_FUNC: {
-            printf("\033[1;35mFUNC\033[0m: %s\n", node->func);
+            printf("\033[1;35mFUNC\033[0m: %s\n", builtinName(node->func));
             if (node->left) {
                 char *new_prefix = malloc(strlen(prefix) + 10);
                 sprintf(new_prefix, "%s%s", prefix, is_left ? "│   " : "    ");
@@ -265,7 +638,7 @@ void printASTPretty(ASTNode *node, const char *prefix, int is_left) {
             break;
         }
         case NODE_FUNC2: {
-            printf("\033[1;35mFUNC2\033[0m: %s\n", node->func);
+            printf("\033[1;35mFUNC2\033[0m: %s\n", builtinName(node->func));
             if (node->left || node->right) {
                 char *new_prefix = malloc(strlen(prefix) + 10);
                 if (node->left) {
@@ -280,8 +653,18 @@ void printASTPretty(ASTNode *node, const char *prefix, int is_left) {
             }
             break;
         }
+        case NODE_FUNC3: {
+            printf("\033[1;35mFUNC3\033[0m: %s\n", builtinName(node->func));
+            char *new_prefix = malloc(strlen(prefix) + 10);
+            sprintf(new_prefix, "%s%s", prefix, is_left ? "│   " : "    ");
+            printASTPretty(node->left, new_prefix, 1);
+            printASTPretty(node->right, new_prefix, 1);
+            printASTPretty(node->arg2, new_prefix, 0);
+            free(new_prefix);
+            break;
+        }
         case NODE_DERIVATIVE: {
-            printf("\033[1;35mDERIV\033[0m: %s\n", node->func);
+            printf("\033[1;35mDERIV\033[0m: %s\n", builtinName(node->func));
             if (node->left) {
                 char *new_prefix = malloc(strlen(prefix) + 10);
                 sprintf(new_prefix, "%s%s", prefix, is_left ? "│   " : "    ");
@@ -345,12 +728,13 @@ ASTNode* optimizeAST(ASTNode *node) {
         double result = 0;
         int can_fold = 1;
 
-        if (strcmp(node->func, "sin") == 0) result = sin(arg);
-        else if (strcmp(node->func, "cos") == 0) result = cos(arg);
-        else if (strcmp(node->func, "abs") == 0) result = fabs(arg);
-        else if (strcmp(node->func, "sqrt") == 0 && arg >= 0) result = sqrt(arg);
-        else if (strcmp(node->func, "exp") == 0) result = exp(arg);
-        else if (strcmp(node->func, "tan") == 0) result = tan(arg);
+        if (node->func == FN_SIN) result = sin(arg);
+        else if (node->func == FN_COS) result = cos(arg);
+        else if (node->func == FN_ABS) result = fabs(arg);
+        else if (node->func == FN_SQRT && arg >= 0) result = sqrt(arg);
+        else if (node->func == FN_EXP) result = exp(arg);
+        else if (node->func == FN_TAN) result = tan(arg);
+        else if (node->func == FN_SIGN) result = (arg > 0) ? 1 : (arg < 0) ? -1 : arg;
         else can_fold = 0;
 
         if (can_fold) {
@@ -366,9 +750,9 @@ ASTNode* optimizeAST(ASTNode *node) {
         node->left && node->left->type == NODE_NUMBER &&
         node->right && node->right->type == NODE_NUMBER) {
         double result = 0;
-        if (strcmp(node->func, "max") == 0) {
+        if (node->func == FN_MAX) {
             result = (node->left->value > node->right->value) ? node->left->value : node->right->value;
-        } else if (strcmp(node->func, "min") == 0) {
+        } else if (node->func == FN_MIN) {
             result = (node->left->value < node->right->value) ? node->left->value : node->right->value;
         }
         freeAST(node->left);
@@ -378,5 +762,229 @@ ASTNode* optimizeAST(ASTNode *node) {
         node->left = node->right = NULL;
     }
 
+    // Constant folding for fma
+    if (node->type == NODE_FUNC3 && node->func == FN_FMA &&
+        node->left && node->left->type == NODE_NUMBER &&
+        node->right && node->right->type == NODE_NUMBER &&
+        node->arg2 && node->arg2->type == NODE_NUMBER) {
+        double result = fma(node->left->value, node->right->value, node->arg2->value);
+        freeAST(node->left);
+        freeAST(node->right);
+        freeAST(node->arg2);
+        node->type = NODE_NUMBER;
+        node->value = result;
+        node->left = node->right = node->arg2 = NULL;
+    }
+
+    return node;
+}
+
+/* ---------- hash consing ---------------------------------------------------- */
+
+typedef struct {
+    ASTNode **slots;
+    size_t    cap;      /* power of two */
+    size_t    count;
+} ConsTable;
+
+static unsigned long long hashNode(const ASTNode *n) {
+    unsigned long long h = 1469598103934665603ULL;
+#define MIX(v) (h = (h ^ (unsigned long long)(v)) * 1099511628211ULL)
+    MIX(n->type);
+    switch (n->type) {
+        case NODE_NUMBER: {
+            unsigned long long bits;
+            memcpy(&bits, &n->value, sizeof(bits));
+            MIX(bits);
+            break;
+        }
+        case NODE_IDENTIFIER:
+            MIX(n->name);
+            break;
+        case NODE_OP:
+            MIX(n->op);
+            break;
+        case NODE_FUNC:
+        case NODE_FUNC2:
+        case NODE_FUNC3:
+        case NODE_DERIVATIVE:
+            MIX(n->func);
+            break;
+        default:
+            break;
+    }
+    MIX((size_t)n->left);
+    MIX((size_t)n->right);
+    MIX((size_t)n->arg2);
+#undef MIX
+    return h;
+}
+
+/* Children are compared by pointer: they are already canonical. */
+static int sameNode(const ASTNode *a, const ASTNode *b) {
+    if (a->type != b->type || a->left != b->left ||
+        a->right != b->right || a->arg2 != b->arg2) return 0;
+    switch (a->type) {
+        case NODE_NUMBER:     return memcmp(&a->value, &b->value, sizeof(double)) == 0;
+        case NODE_IDENTIFIER: return a->name == b->name;
+        case NODE_OP:         return a->op == b->op;
+        case NODE_FUNC:
+        case NODE_FUNC2:
+        case NODE_FUNC3:
+        case NODE_DERIVATIVE: return a->func == b->func;
+        default:              return 1;
+    }
+}
+
+static void consInsert(ConsTable *t, ASTNode *node) {
+    if ((t->count + 1) * 10 > t->cap * 7) {
+        size_t old_cap = t->cap;
+        ASTNode **old = t->slots;
+        t->cap = old_cap ? old_cap * 2 : 64;
+        t->slots = calloc(t->cap, sizeof(ASTNode *));
+        t->count = 0;
+        for (size_t i = 0; i < old_cap; i++)
+            if (old[i]) consInsert(t, old[i]);
+        free(old);
+    }
+    size_t i = hashNode(node) & (t->cap - 1);
+    while (t->slots[i]) i = (i + 1) & (t->cap - 1);
+    t->slots[i] = node;
+    t->count++;
+}
+
+static ASTNode* consLookup(ConsTable *t, ASTNode *node) {
+    if (!t->cap) return NULL;
+    size_t i = hashNode(node) & (t->cap - 1);
+    while (t->slots[i]) {
+        if (sameNode(t->slots[i], node)) return t->slots[i];
+        i = (i + 1) & (t->cap - 1);
+    }
+    return NULL;
+}
+
+/* memo value of nodes already in the table, so a DAG handed in (e.g. by
+ * the linker) is walked once per node, not once per path */
+#define MEMO_CANONICAL (-2)
+
+/* Returns the canonical node for `node`, transferring the caller's
+ * reference to it. */
+static ASTNode* cons(ConsTable *t, ASTNode *node) {
+    if (!node || node->memo == MEMO_CANONICAL) return node;
+    node->left = cons(t, node->left);
+    node->right = cons(t, node->right);
+    node->arg2 = cons(t, node->arg2);
+
+    ASTNode *canon = consLookup(t, node);
+    if (canon) {
+        canon->refs++;
+        freeAST(node);      /* drops its references to the shared children */
+        return canon;
+    }
+    node->memo = MEMO_CANONICAL;
+    consInsert(t, node);
+    return node;
+}
+
+/* ASTNode.memo is a signed char */
+_Static_assert(EVAL_MEMO_SLOTS <= 127, "memo slots must fit in ASTNode.memo");
+
+/* Slots go to shared nodes bottom-up until EVAL_MEMO_SLOTS are taken;
+ * the rest keep -1 and are recomputed. */
+static void assignMemo(ASTNode *node, int *next) {
+    if (!node || node->memo != MEMO_CANONICAL) return;
+    node->memo = -1;
+    assignMemo(node->left, next);
+    assignMemo(node->right, next);
+    assignMemo(node->arg2, next);
+    // Leaves are cheaper to recompute than to cache
+    if (node->refs > 1 && *next < EVAL_MEMO_SLOTS && node->type != NODE_NUMBER &&
+        node->type != NODE_VAR && node->type != NODE_IDENTIFIER) {
+        node->memo = (*next)++;
+    }
+}
+
+ASTNode* hashConsAST(ASTNode *node) {
+    ConsTable table = {NULL, 0, 0};
+    node = cons(&table, node);
+    free(table.slots);
+
+    int next = 0;
+    assignMemo(node, &next);
     return node;
-}
\ No newline at end of file
+}
+
+/* ---------- structural hash ------------------------------------------------- */
+
+typedef struct {
+    const ASTNode      *node;
+    unsigned long long  hash;
+} HashedNode;
+
+typedef struct {
+    HashedNode *slots;
+    size_t      cap;    /* power of two */
+    size_t      count;
+} HashMemo;
+
+static HashedNode* memoSlot(HashMemo *m, const ASTNode *node) {
+    size_t i = ((size_t)node >> 4) & (m->cap - 1);
+    while (m->slots[i].node && m->slots[i].node != node) i = (i + 1) & (m->cap - 1);
+    return &m->slots[i];
+}
+
+static void memoInsert(HashMemo *m, const ASTNode *node, unsigned long long hash) {
+    if ((m->count + 1) * 10 > m->cap * 7) {
+        HashMemo old = *m;
+        m->cap = old.cap ? old.cap * 2 : 64;
+        m->slots = calloc(m->cap, sizeof(HashedNode));
+        m->count = 0;
+        for (size_t i = 0; i < old.cap; i++)
+            if (old.slots[i].node) memoInsert(m, old.slots[i].node, old.slots[i].hash);
+        free(old.slots);
+    }
+    HashedNode *slot = memoSlot(m, node);
+    slot->node = node;
+    slot->hash = hash;
+    m->count++;
+}
+
+/* Like hashNode(), with the children's hashes in place of their addresses */
+static unsigned long long structuralHash(HashMemo *m, const ASTNode *n) {
+    if (!n) return 0;
+    if (m->cap) {
+        HashedNode *slot = memoSlot(m, n);
+        if (slot->node) return slot->hash;
+    }
+    ASTNode shape = *n;
+    shape.left = (ASTNode *)(size_t)structuralHash(m, n->left);
+    shape.right = (ASTNode *)(size_t)structuralHash(m, n->right);
+    shape.arg2 = (ASTNode *)(size_t)structuralHash(m, n->arg2);
+    unsigned long long h = hashNode(&shape);
+    if (n->refs > 1) memoInsert(m, n, h);
+    return h;
+}
+
+unsigned long long hashAST(const ASTNode *node) {
+    HashMemo memo = {NULL, 0, 0};
+    unsigned long long h = structuralHash(&memo, node);
+    free(memo.slots);
+    return h;
+}
+
+/* Only shared nodes can be reached twice, so only they are remembered */
+static int countDistinct(HashMemo *m, const ASTNode *n) {
+    if (!n) return 0;
+    if (n->refs > 1) {
+        if (m->cap && memoSlot(m, n)->node) return 0;
+        memoInsert(m, n, 0);
+    }
+    return 1 + countDistinct(m, n->left) + countDistinct(m, n->right) + countDistinct(m, n->arg2);
+}
+
+int countAST(const ASTNode *node) {
+    HashMemo memo = {NULL, 0, 0};
+    int n = countDistinct(&memo, node);
+    free(memo.slots);
+    return n;
+}
@@ -13,35 +13,88 @@ typedef enum {
     NODE_FUNC,
     NODE_IDENTIFIER,
     NODE_FUNC2,
-    NODE_DERIVATIVE
+    NODE_DERIVATIVE,
+    NODE_FUNC3
 } NodeType;
 
+/* Builtin functions, stored in a node as one byte. */
+typedef enum {
+    FN_NONE,
+    FN_SIN, FN_COS, FN_TAN, FN_EXP, FN_LOG, FN_SQRT, FN_ABS, FN_LN,
+    FN_ASIN, FN_ACOS, FN_ATAN, FN_SINH, FN_COSH, FN_TANH,
+    FN_CEIL, FN_FLOOR, FN_SIGN,     // FUNC
+    FN_MAX, FN_MIN,                 // FUNC2
+    FN_FMA,                         // FUNC3
+    FN_DERIVATIVE,                  // DERIVATIVE (finite difference)
+    FN_COUNT
+} BuiltinFunc;
+
 typedef struct ASTNode {
-    NodeType type;
-    double   value;     // for NUMBER
-    char     op;        // for OP   ('+', '-', '*', '/', '^', '~')
-    char     func[20];  // for FUNC / FUNC2
-    char     name[50];  // for IDENTIFIER
+    unsigned char type;     // NodeType
+    char          op;       // for OP   ('+', '-', '*', '/', '^', '~')
+    unsigned char func;     // BuiltinFunc, for FUNC / FUNC2 / FUNC3 / DERIVATIVE
+    signed char   memo;     // per-sample cache slot of a shared node, -1 if none
+    int           refs;     // parents holding this node (hash-consed DAGs share subtrees)
+    union {
+        double    value;    // for NUMBER
+        int       name;     // for IDENTIFIER: interned id, see symbolName()
+    };
     struct ASTNode *left;
     struct ASTNode *right;
-    struct ASTNode *arg2;   // only for FUNC2
+    struct ASTNode *arg2;   // third operand of FUNC3
 } ASTNode;
 
+/* Shared nodes beyond this many are recomputed instead of cached.  At most
+ * 127, since slots are kept in ASTNode.memo. */
+#define EVAL_MEMO_SLOTS 64
+
+/* ---- builtin names ------------------------------------------------------ */
+BuiltinFunc builtinFunc(const char *name);     /* FN_NONE if unknown */
+const char* builtinName(BuiltinFunc func);
+
+/* ---- node arenas -------------------------------------------------------- */
+/* Nodes are bump-allocated from the current arena, and freeAST() returns
+ * them to the free list of the arena they came from.  Until another arena
+ * is selected, nodes come from a process-wide arena that is never
+ * destroyed.  arenaDestroy() releases every node of an arena at once, in
+ * O(1); none of them may be used or freed afterwards.  Each thread selects
+ * its own current arena; an arena is used by one thread at a time. */
+typedef struct ASTArena ASTArena;
+ASTArena* arenaCreate(void);
+void      arenaDestroy(ASTArena *arena);
+ASTArena* arenaSwitch(ASTArena *arena);    /* NULL: process-wide; returns the previous one */
+/* Moves node into the process-wide arena so it can outlive the current
+ * one (e.g. a def body).  Takes over the caller's reference. */
+ASTNode*  persistAST(ASTNode *node);
+
 /* ---- creation ----------------------------------------------------------- */
 ASTNode* createNumberNode(double value);
 ASTNode* createVarNode(void);
 ASTNode* createIdentifierNode(const char *name);
 ASTNode* createOpNode(char op, ASTNode *left, ASTNode *right);
-ASTNode* createFuncNode(const char *func, ASTNode *child);
-ASTNode* createFunc2Node(const char *func, ASTNode *arg1, ASTNode *arg2);
-ASTNode *createDerivative(const char *func, ASTNode *child);
+ASTNode* createFuncNode(BuiltinFunc func, ASTNode *child);
+ASTNode* createFunc2Node(BuiltinFunc func, ASTNode *arg1, ASTNode *arg2);
+/* Only built by the simplifier: fma(a, b, c) = a*b + c with one rounding. */
+ASTNode* createFunc3Node(BuiltinFunc func, ASTNode *arg1, ASTNode *arg2, ASTNode *arg3);
+ASTNode *createDerivative(BuiltinFunc func, ASTNode *child);
+ASTNode* copyAST(ASTNode *node);
+
+/* Block size used by callers of evaluateBatch(). */
+#define EVAL_BATCH_SIZE 1024
 
 /* ---- evaluation / utilities -------------------------------------------- */
 double   evaluate(ASTNode *node, double x);
+void     evaluateBatch(ASTNode *node, const double *xs, double *ys, int n);
 void     freeAST(ASTNode *node);
 int      validateAST(ASTNode *node);
 void     printAST(ASTNode *node, int indent);
 void     printASTPretty(ASTNode *node, const char *prefix, int is_left);
 ASTNode* optimizeAST(ASTNode *node);
+ASTNode* hashConsAST(ASTNode *node);
+/* Hash of the tree's structure and constants: equal trees hash equally,
+ * wherever their nodes live.  Shared subtrees are hashed once. */
+unsigned long long hashAST(const ASTNode *node);
+/* Distinct nodes of the tree: a shared subtree counts once. */
+int      countAST(const ASTNode *node);
 
 #endif /* AST_H */
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "ast.h"
+#include "parser.h"
+#include "symtab.h"
+#include "simplify.h"
+#include "inliner.h"
+#include "sampler.h"
+#include "samplefile.h"
+
+typedef struct {
+    char      *text;        /* the line as written */
+    int        index;       /* e<index> */
+    int        open;        /* file was created */
+    SampleFile file;
+    long       defined;
+    double     min, max, sum;
+} BatchExpr;
+
+/* An expression line waiting to be compiled with the others of its run. */
+typedef struct {
+    char      *text;
+    long       number;      /* in the script */
+    int        ok;
+    char       error[64];   /* why it did not parse */
+    int        expr;        /* an expression, prepared into sampler */
+    Sampler    sampler;
+} BatchLine;
+
+typedef struct {
+    const BatchOptions *o;
+    const char *name;       /* of the script, for messages */
+    FILE       *out;        /* samples or summaries; NULL when writing files */
+    FILE       *index;      /* out_dir/index.txt */
+    long        points, slab;
+    int         group_max;
+    Sampler     samplers[BATCH_GROUP_MAX];
+    BatchExpr   exprs[BATCH_GROUP_MAX];
+    double     *ys[BATCH_GROUP_MAX];
+    int         n;          /* expressions waiting to be sampled */
+    int         next_index;
+    BatchLine   lines[BATCH_GROUP_MAX];
+    int         n_lines;    /* lines waiting to be compiled */
+    ASTArena   *arena;      /* nodes of let and def lines */
+    ASTArena  **arenas;     /* per pool thread: nodes of the waiting samplers */
+    int         n_arenas;
+    int         failed;
+} Batch;
+
+/* ---------- output ---------------------------------------------------------- */
+
+static void startExpr(Batch *b, BatchExpr *e) {
+    const BatchOptions *o = b->o;
+    if (o->summary) {
+        e->defined = 0;
+        e->min = INFINITY;
+        e->max = -INFINITY;
+        e->sum = 0;
+    } else if (b->out) {
+        fprintf(b->out, "%s# e%d: %s\n", e->index ? "\n\n" : "", e->index, e->text);
+    } else {
+        char path[sizeof(e->file.path)];
+        snprintf(path, sizeof(path), "%s/e%d.bin", o->out_dir, e->index);
+        e->open = sampleFileCreate(&e->file, path, SAMPLES_COLUMNS, b->points,
+                                   o->x_min, o->step);
+        if (e->open) {
+            fprintf(b->index, "e%d.bin\t%s\n", e->index, e->text);
+        } else {
+            b->failed++;
+        }
+    }
+}
+
+static void writeSlab(Batch *b, BatchExpr *e, const double *ys, long first, long count) {
+    const BatchOptions *o = b->o;
+    if (o->summary) {
+        for (long j = 0; j < count; j++) {
+            if (!isfinite(ys[j])) continue;
+            e->defined++;
+            if (ys[j] < e->min) e->min = ys[j];
+            if (ys[j] > e->max) e->max = ys[j];
+            e->sum += ys[j];
+        }
+    } else if (b->out) {
+        for (long j = 0; j < count; j++) {
+            double x = o->x_min + (first + j) * o->step;
+            if (isnan(ys[j])) {
+                fprintf(b->out, "%.17g nan\n", x);
+            } else {
+                fprintf(b->out, "%.17g %.17g\n", x, ys[j]);
+            }
+        }
+    } else if (e->open) {
+        for (long j = 0; j < count; j++) {
+            sampleFileAdd(&e->file, o->x_min + (first + j) * o->step, ys[j]);
+        }
+    }
+}
+
+static void finishExpr(Batch *b, BatchExpr *e) {
+    if (b->o->summary) {
+        int any = e->defined > 0;
+        fprintf(b->out, "e%d\t%ld\t%ld\t%.17g\t%.17g\t%.17g\t%s\n", e->index, b->points,
+                e->defined, any ? e->min : NAN, any ? e->max : NAN,
+                any ? e->sum / e->defined : NAN, e->text);
+    } else if (e->open && !sampleFileFinish(&e->file)) {
+        b->failed++;
+    }
+}
+
+/* ---------- groups ---------------------------------------------------------- */
+
+/* Samples every waiting expression, all of them in each sweep, so their
+ * chunks share the thread pool.  A group of several has a single slab, so
+ * the stream still gets one expression after the other. */
+static void flushGroup(Batch *b) {
+    if (b->n == 0) return;
+    for (long first = 0; first < b->points; first += b->slab) {
+        long count = b->points - first < b->slab ? b->points - first : b->slab;
+        sampleSweep(b->samplers, b->n, b->o->x_min, b->o->step, first, count, b->ys);
+        for (int k = 0; k < b->n; k++) {
+            if (first == 0) startExpr(b, &b->exprs[k]);
+            writeSlab(b, &b->exprs[k], b->ys[k], first, count);
+        }
+    }
+    for (int k = 0; k < b->n; k++) {
+        finishExpr(b, &b->exprs[k]);
+        releaseSampler(&b->samplers[k]);
+        free(b->exprs[k].text);
+    }
+    b->n = 0;
+    arenaDestroy(b->arena);
+    b->arena = NULL;
+    for (int w = 0; w < b->n_arenas; w++) {
+        arenaDestroy(b->arenas[w]);
+        b->arenas[w] = NULL;
+    }
+}
+
+/* Takes over the prepared sampler and the text. */
+static void addExpr(Batch *b, const Sampler *sampler, char *text) {
+    BatchExpr *e = &b->exprs[b->n];
+    memset(e, 0, sizeof(*e));
+    e->text = text;
+    e->index = b->next_index++;
+    b->samplers[b->n++] = *sampler;
+}
+
+/* ---------- runs of expressions --------------------------------------------- */
+
+/* On a pool thread, into that thread's arena.  The sampler links its own
+ * copy of the tree, with the values variables have now, so later lines
+ * cannot change what it computes.  The REPL's listing commands are
+ * accepted and ignored. */
+static void compileLine(void *ctx, int item, int worker) {
+    Batch *b = ctx;
+    BatchLine *l = &b->lines[item];
+    if (!b->arenas[worker]) b->arenas[worker] = arenaCreate();
+    ASTArena *previous = arenaSwitch(b->arenas[worker]);
+    Statement s;
+    l->ok = parseStatement(l->text, &s);
+    l->expr = 0;
+    snprintf(l->error, sizeof(l->error), "%s", l->ok ? "" : s.error);
+    if (l->ok && s.kind == STMT_EXPR) {
+        ASTNode *node = optimizeAST(inlineAST(s.node));
+        l->ok = validateAST(node);
+        if (l->ok) {
+            node = hashConsAST(simplifyAST(node));
+            prepareSampler(&l->sampler, node);
+            l->expr = 1;
+        }
+        freeAST(node);
+    }
+    freeStatement(&s);
+    arenaSwitch(previous);
+}
+
+/* Compiles the waiting lines on the pool, then reports and groups them in
+ * script order. */
+static void runPending(Batch *b) {
+    if (b->n_lines == 0) return;
+    // Their nodes share the pool threads' arenas with the group's
+    if (b->n + b->n_lines > b->group_max) flushGroup(b);
+    sampleEach(compileLine, b, b->n_lines);
+    for (int i = 0; i < b->n_lines; i++) {
+        BatchLine *l = &b->lines[i];
+        if (l->expr) {
+            addExpr(b, &l->sampler, l->text);
+            continue;
+        }
+        if (!l->ok) {
+            if (l->error[0]) fprintf(stderr, "Error: %s\n", l->error);
+            fprintf(stderr, "%s:%ld: skipped '%s'\n", b->name, l->number, l->text);
+            b->failed++;
+        }
+        free(l->text);
+    }
+    b->n_lines = 0;
+    if (b->n == b->group_max) flushGroup(b);
+}
+
+static void addLine(Batch *b, const char *text, long number) {
+    BatchLine *l = &b->lines[b->n_lines++];
+    l->text = strdup(text);
+    l->number = number;
+    if (b->n_lines == b->group_max) runPending(b);
+}
+
+/* ---------- script ---------------------------------------------------------- */
+
+/* let and def change what later lines mean, so they run alone, between
+ * runs of expressions. */
+static int isBarrier(const char *text) {
+    size_t word = strspn(text, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+    return word == 3 && (strncmp(text, "let", 3) == 0 || strncmp(text, "def", 3) == 0);
+}
+
+static void runLine(Batch *b, const char *text, long line) {
+    if (!b->arena) b->arena = arenaCreate();
+    ASTArena *previous = arenaSwitch(b->arena);
+    Statement s;
+    int ok = parseStatement(text, &s);
+    if (!ok) fprintf(stderr, "Error: %s\n", s.error);
+
+    if (ok && s.kind == STMT_LET) {
+        s.node = inlineAST(s.node);
+        storeVariable(s.name, evaluate(s.node, 0));
+        freeAST(s.node);
+    } else if (ok && s.kind == STMT_DEF) {
+        storeFunction(s.name, persistAST(s.node));
+    }
+    freeStatement(&s);
+    arenaSwitch(previous);
+    if (!ok) {
+        fprintf(stderr, "%s:%ld: skipped '%s'\n", b->name, line, text);
+        b->failed++;
+    }
+}
+
+static int openOutput(Batch *b) {
+    const BatchOptions *o = b->o;
+    if (!o->out_dir) {
+        b->out = stdout;
+        return 1;
+    }
+    if (mkdir(o->out_dir, 0777) != 0 && errno != EEXIST) {
+        perror(o->out_dir);
+        return 0;
+    }
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", o->out_dir, o->summary ? "summary.txt" : "index.txt");
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    if (o->summary) {
+        b->out = f;
+    } else {
+        b->index = f;
+    }
+    return 1;
+}
+
+int runBatch(const BatchOptions *o) {
+    Batch b = {0};
+    b.o = o;
+    int from_stdin = !o->script || strcmp(o->script, "-") == 0;
+    b.name = from_stdin ? "stdin" : o->script;
+    FILE *in = from_stdin ? stdin : fopen(o->script, "r");
+    if (!in) {
+        perror(o->script);
+        return 1;
+    }
+    if (!openOutput(&b)) {
+        if (!from_stdin) fclose(in);
+        return 1;
+    }
+    if (b.out && o->summary) fprintf(b.out, "# expr\tpoints\tdefined\tmin\tmax\tmean\tsource\n");
+
+    b.points = sweepPoints(o->x_min, o->x_max, o->step);
+    b.slab = b.points < BATCH_POINT_BUDGET ? b.points : BATCH_POINT_BUDGET;
+    long fit = BATCH_POINT_BUDGET / b.points;
+    b.group_max = fit < 1 ? 1 : fit > BATCH_GROUP_MAX ? BATCH_GROUP_MAX : (int)fit;
+    for (int k = 0; k < b.group_max; k++) b.ys[k] = malloc(b.slab * sizeof(double));
+    b.n_arenas = samplerThreads();
+    b.arenas = calloc(b.n_arenas, sizeof(ASTArena *));
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    for (long number = 1; (len = getline(&line, &cap, in)) >= 0; number++) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *text = line + strspn(line, " \t");
+        if (*text == '\0' || *text == '#') continue;
+        if (strcmp(text, "quit") == 0 || strcmp(text, "exit") == 0) break;
+        if (isBarrier(text)) {
+            runPending(&b);
+            runLine(&b, text, number);
+        } else {
+            addLine(&b, text, number);
+        }
+    }
+    runPending(&b);
+    flushGroup(&b);
+
+    free(line);
+    free(b.arenas);
+    for (int k = 0; k < b.group_max; k++) free(b.ys[k]);
+    if (!from_stdin) fclose(in);
+    if (b.index) fclose(b.index);
+    if (b.out == stdout) {
+        fflush(stdout);
+    } else if (b.out) {
+        fclose(b.out);
+    }
+    return b.failed;
+}
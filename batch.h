@@ -0,0 +1,46 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/* Non-interactive mode: runs a script of let/def/expression lines with no
+ * banners, prompts or plots, and writes what every expression evaluates
+ * to.  Lines may be of any length; blank lines and lines starting with #
+ * are skipped, and quit or exit ends the script.
+ *
+ * Output goes to stdout, or into out_dir:
+ *   samples   stdout: "# e<i>: <expr>", then one "x y" line per point of the
+ *             sweep (y is nan where undefined); expressions are separated
+ *             by two blank lines, so gnuplot reads them as `index <i>`.
+ *             out_dir: one binary sample file e<i>.bin per expression in
+ *             the COLUMNS layout (see samplefile.h), plus index.txt.
+ *   summary   one tab-separated line per expression: e<i>, points,
+ *             defined points, min, max, mean and the expression;
+ *             out_dir: summary.txt.
+ *
+ * A let or def changes what later lines mean, so each one runs alone, in
+ * script order.  The expression lines between two of them are independent:
+ * they are parsed and compiled in parallel on the sampler's thread pool
+ * (see sampleEach()), each thread into an arena of its own, then sampled
+ * in groups that share the same pool, so a script of many short
+ * expressions keeps every core busy.  Skipped lines are reported in
+ * script order; what the compiler reports (undefined names, constant
+ * division by zero) comes from the thread that met it. */
+
+typedef struct {
+    const char *script;     /* NULL or "-": stdin */
+    const char *out_dir;    /* NULL: stdout */
+    int         summary;
+    double      x_min, x_max, step;
+} BatchOptions;
+
+/* Returns the number of lines that failed, after reporting each one on
+ * stderr as script:line. */
+int runBatch(const BatchOptions *o);
+
+/* Points sampled at once: a group holds as many expressions as fit, and
+ * a sweep longer than this is written a slab at a time. */
+#define BATCH_POINT_BUDGET (1L << 22)
+
+/* Expressions sampled together at most. */
+#define BATCH_GROUP_MAX 64
+
+#endif /* BATCH_H */
@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ast.h"
+#include "symtab.h"
+#include "parser.h"
+#include "simplify.h"
+#include "inliner.h"
+#include "tac.h"
+#include "sampler.h"
+#include "samplefile.h"
+
+/* Benchmarks every stage an expression goes through: parsing, the
+ * optimization pipeline, TAC lowering and passes, sampling with each
+ * backend, and writing a sample file.
+ *
+ *   ./graph_bench [--json | --csv] [--points N] [--repeat N]
+ *
+ * Times are per run of a stage, averaged over --repeat runs (sampling and
+ * writing run once over --points points).  Allocations are the malloc,
+ * calloc and realloc calls of one parse + optimize + TAC + prepareSampler;
+ * the Makefile links with --wrap so these calls come here first. */
+
+/* ---------- allocation counting ------------------------------------------ */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+static long allocations, allocated_bytes;
+
+static void countAllocation(size_t bytes) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocated_bytes, (long)bytes, __ATOMIC_RELAXED);
+}
+
+void *__wrap_malloc(size_t size) {
+    countAllocation(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    countAllocation(n * size);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    countAllocation(size);
+    return __real_realloc(p, size);
+}
+
+/* ---------- corpus ------------------------------------------------------- */
+
+#define DEF_CHAIN 16
+#define LARGE_TERMS 200
+
+typedef struct {
+    const char *name;
+    char       *source;
+} BenchExpr;
+
+static char* generateLarge(void) {
+    size_t cap = LARGE_TERMS * 40;
+    char *s = malloc(cap);
+    size_t len = 0;
+    for (int k = 1; k <= LARGE_TERMS; k++) {
+        len += snprintf(s + len, cap - len, "%ssin(%d*x)*cos(x/%d)", k > 1 ? " + " : "", k, k);
+    }
+    return s;
+}
+
+static int buildCorpus(BenchExpr *corpus) {
+    int n = 0;
+    corpus[n++] = (BenchExpr){"polynomial", strdup("3*x^5 - 2*x^4 + x^3 - 7*x^2 + 0.5*x - 1")};
+    corpus[n++] = (BenchExpr){"trig_nesting",
+        strdup("sin(cos(sin(cos(sin(cos(sin(cos(x))))))))*cos(sin(x/2))")};
+    corpus[n++] = (BenchExpr){"nested_d", strdup("d(d(d(sin(x)*exp(-x/4))))")};
+    corpus[n++] = (BenchExpr){"rational", strdup("(x^3 - 2*x + 1)/(x^2 + 1) + sqrt(abs(x))*ln(x^2 + 1)")};
+    char name[16];
+    snprintf(name, sizeof(name), "c%d", DEF_CHAIN - 1);
+    corpus[n++] = (BenchExpr){"def_chain", strdup(name)};
+    corpus[n++] = (BenchExpr){"large", generateLarge()};
+    return n;
+}
+
+/* Returns the expression, or NULL after storing a let or def. */
+static ASTNode* parse(const char *source) {
+    Statement s;
+    if (!parseStatement(source, &s)) return NULL;
+    if (s.kind == STMT_LET) {
+        s.node = inlineAST(s.node);
+        storeVariable(s.name, evaluate(s.node, 0));
+        freeAST(s.node);
+    } else if (s.kind == STMT_DEF) {
+        storeFunction(s.name, persistAST(s.node));
+    }
+    freeStatement(&s);
+    return s.kind == STMT_EXPR ? s.node : NULL;
+}
+
+/* c0 = sin(x), c_i = a*c_(i-1) + cos(i*x): every level is inlined. */
+static void defineChain(void) {
+    char line[128];
+    parse("let a = 0.5");
+    parse("def c0 = sin(x)");
+    for (int i = 1; i < DEF_CHAIN; i++) {
+        snprintf(line, sizeof(line), "def c%d = a*c%d + cos(%d*x)", i, i - 1, i);
+        parse(line);
+    }
+}
+
+static ASTNode* optimize(ASTNode *node) {
+    return hashConsAST(simplifyAST(optimizeAST(inlineAST(node))));
+}
+
+/* ---------- measuring ---------------------------------------------------- */
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static const char *backend_names[] = {"ast", "vm", "batch", "jit", "tac"};
+#define BENCH_BACKENDS 5
+
+typedef struct {
+    double parse_us, optimize_us, tac_us;
+    int    source_bytes, operations;
+    long   allocations, allocated_bytes;
+    double points_per_s[BENCH_BACKENDS];
+    double ns_per_node[BENCH_BACKENDS];
+    double write_mb_per_s;
+} BenchResult;
+
+static void benchStages(const BenchExpr *e, int repeat, BenchResult *r) {
+    double t_parse = 0, t_optimize = 0, t_tac = 0;
+    for (int i = 0; i < repeat; i++) {
+        ASTArena *scratch = arenaCreate();
+        ASTArena *previous = arenaSwitch(scratch);
+        double t0 = now();
+        ASTNode *node = parse(e->source);
+        double t1 = now();
+        node = optimize(node);
+        double t2 = now();
+        TacProgram *p = tacLower(node);
+        tacOptimize(p);
+        double t3 = now();
+        t_parse += t1 - t0;
+        t_optimize += t2 - t1;
+        t_tac += t3 - t2;
+        r->operations = tacOperations(p);
+        tacFree(p);
+        arenaSwitch(previous);
+        arenaDestroy(scratch);
+    }
+    r->parse_us = t_parse / repeat * 1e6;
+    r->optimize_us = t_optimize / repeat * 1e6;
+    r->tac_us = t_tac / repeat * 1e6;
+    r->source_bytes = (int)strlen(e->source);
+
+    // One more time, counting what it allocates up to a prepared sampler
+    ASTArena *scratch = arenaCreate();
+    ASTArena *previous = arenaSwitch(scratch);
+    long calls = allocations, bytes = allocated_bytes;
+    ASTNode *node = optimize(parse(e->source));
+    TacProgram *p = tacLower(node);
+    tacOptimize(p);
+    Sampler s;
+    prepareSampler(&s, node);
+    r->allocations = allocations - calls;
+    r->allocated_bytes = allocated_bytes - bytes;
+    releaseSampler(&s);
+    tacFree(p);
+    arenaSwitch(previous);
+    arenaDestroy(scratch);
+}
+
+/* Single-threaded, so backends compare per core. */
+static void benchSampling(const BenchExpr *e, long points, BenchResult *r) {
+    double *xs = malloc(points * sizeof(double));
+    double *ys = malloc(points * sizeof(double));
+    for (long i = 0; i < points; i++) xs[i] = -10 + 20.0 * i / points;
+
+    ASTArena *scratch = arenaCreate();
+    ASTArena *previous = arenaSwitch(scratch);
+    ASTNode *node = optimize(parse(e->source));
+    Backend saved = backend;
+    for (int b = 0; b < BENCH_BACKENDS; b++) {
+        backend = (Backend)b;
+        Sampler s;
+        prepareSampler(&s, node);
+        double t0 = now();
+        for (long i = 0; i < points; i += SWEEP_CHUNK) {
+            int n = points - i < SWEEP_CHUNK ? (int)(points - i) : SWEEP_CHUNK;
+            evaluatePoints(&s, xs + i, ys + i, n);
+        }
+        double t = now() - t0;
+        releaseSampler(&s);
+        r->points_per_s[b] = points / t;
+        r->ns_per_node[b] = t * 1e9 / ((double)points * (r->operations > 0 ? r->operations : 1));
+    }
+    backend = saved;
+    arenaSwitch(previous);
+    arenaDestroy(scratch);
+
+    char path[64];
+    snprintf(path, sizeof(path), "bench%d.bin", (int)getpid());
+    SampleFile f;
+    double t0 = now();
+    if (sampleFileCreate(&f, path, SAMPLES_PAIRS, points, -10, 20.0 / points)) {
+        for (long i = 0; i < points; i++) sampleFileAdd(&f, xs[i], ys[i]);
+        long written = f.count;
+        if (sampleFileFinish(&f)) {
+            r->write_mb_per_s = (SAMPLE_HEADER_SIZE + written * 16.0) / 1048576.0 / (now() - t0);
+        }
+        unlink(path);
+    }
+    free(xs);
+    free(ys);
+}
+
+/* ---------- reporting ---------------------------------------------------- */
+
+typedef enum { REPORT_TABLE, REPORT_JSON, REPORT_CSV } ReportFormat;
+
+static void report(ReportFormat format, const BenchExpr *corpus, const BenchResult *results,
+                   int n, long points, int repeat) {
+    if (format == REPORT_JSON) {
+        printf("{\n  \"points\": %ld,\n  \"repeat\": %d,\n  \"threads\": %d,\n  \"results\": [\n",
+               points, repeat, samplerThreads());
+        for (int i = 0; i < n; i++) {
+            const BenchResult *r = &results[i];
+            printf("    {\"name\": \"%s\", \"source_bytes\": %d, \"operations\": %d, "
+                   "\"parse_us\": %.3f, \"optimize_us\": %.3f, \"tac_us\": %.3f, "
+                   "\"allocations\": %ld, \"allocated_bytes\": %ld, \"write_mb_per_s\": %.1f",
+                   corpus[i].name, r->source_bytes, r->operations, r->parse_us,
+                   r->optimize_us, r->tac_us, r->allocations, r->allocated_bytes,
+                   r->write_mb_per_s);
+            for (int b = 0; b < BENCH_BACKENDS; b++) {
+                printf(", \"%s\": {\"points_per_s\": %.0f, \"ns_per_node\": %.3f}",
+                       backend_names[b], r->points_per_s[b], r->ns_per_node[b]);
+            }
+            printf("}%s\n", i + 1 < n ? "," : "");
+        }
+        printf("  ]\n}\n");
+        return;
+    }
+    if (format == REPORT_CSV) {
+        printf("name,source_bytes,operations,parse_us,optimize_us,tac_us,allocations,"
+               "allocated_bytes,write_mb_per_s");
+        for (int b = 0; b < BENCH_BACKENDS; b++) {
+            printf(",%s_points_per_s,%s_ns_per_node", backend_names[b], backend_names[b]);
+        }
+        printf("\n");
+        for (int i = 0; i < n; i++) {
+            const BenchResult *r = &results[i];
+            printf("%s,%d,%d,%.3f,%.3f,%.3f,%ld,%ld,%.1f", corpus[i].name, r->source_bytes,
+                   r->operations, r->parse_us, r->optimize_us, r->tac_us, r->allocations,
+                   r->allocated_bytes, r->write_mb_per_s);
+            for (int b = 0; b < BENCH_BACKENDS; b++) {
+                printf(",%.0f,%.3f", r->points_per_s[b], r->ns_per_node[b]);
+            }
+            printf("\n");
+        }
+        return;
+    }
+
+    printf("%ld points per backend, stages averaged over %d runs\n\n", points, repeat);
+    printf("%-14s %6s %5s %10s %10s %10s %7s %9s %9s\n", "expression", "bytes", "ops",
+           "parse us", "optim us", "tac us", "allocs", "alloc KB", "write MB/s");
+    for (int i = 0; i < n; i++) {
+        const BenchResult *r = &results[i];
+        printf("%-14s %6d %5d %10.2f %10.2f %10.2f %7ld %9.1f %9.0f\n", corpus[i].name,
+               r->source_bytes, r->operations, r->parse_us, r->optimize_us, r->tac_us,
+               r->allocations, r->allocated_bytes / 1024.0, r->write_mb_per_s);
+    }
+    printf("\n%-14s", "Mpoints/s");
+    for (int b = 0; b < BENCH_BACKENDS; b++) printf(" %9s", backend_names[b]);
+    printf("   (ns per node)\n");
+    for (int i = 0; i < n; i++) {
+        const BenchResult *r = &results[i];
+        printf("%-14s", corpus[i].name);
+        for (int b = 0; b < BENCH_BACKENDS; b++) printf(" %9.2f", r->points_per_s[b] / 1e6);
+        printf("  ");
+        for (int b = 0; b < BENCH_BACKENDS; b++) printf(" %.2f", r->ns_per_node[b]);
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    ReportFormat format = REPORT_TABLE;
+    long points = 1000000;
+    int repeat = 200;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            format = REPORT_JSON;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            format = REPORT_CSV;
+        } else if (strcmp(argv[i], "--points") == 0 && i + 1 < argc) {
+            points = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: ./graph_bench [--json | --csv] [--points N] [--repeat N]\n");
+            return 2;
+        }
+    }
+    if (points < 1 || repeat < 1) {
+        fprintf(stderr, "--points and --repeat must be positive.\n");
+        return 2;
+    }
+
+    defineChain();
+    BenchExpr corpus[8];
+    BenchResult results[8];
+    int n = buildCorpus(corpus);
+    for (int i = 0; i < n; i++) {
+        memset(&results[i], 0, sizeof(BenchResult));
+        benchStages(&corpus[i], repeat, &results[i]);
+        benchSampling(&corpus[i], points, &results[i]);
+    }
+    report(format, corpus, results, n, points, repeat);
+    for (int i = 0; i < n; i++) free(corpus[i].source);
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "bytecode.h"
+#include "symtab.h"
+
+/* Nesting limit for inlined user functions; also catches def f = f + 1. */
+#define MAX_INLINE_DEPTH 64
+
+static const int builtin_ops[FN_COUNT] = {
+    [FN_SIN] = OP_SIN, [FN_COS] = OP_COS, [FN_TAN] = OP_TAN,
+    [FN_EXP] = OP_EXP, [FN_LOG] = OP_LOG, [FN_SQRT] = OP_SQRT,
+    [FN_ABS] = OP_ABS, [FN_LN] = OP_LN,
+    [FN_ASIN] = OP_ASIN, [FN_ACOS] = OP_ACOS, [FN_ATAN] = OP_ATAN,
+    [FN_SINH] = OP_SINH, [FN_COSH] = OP_COSH, [FN_TANH] = OP_TANH,
+    [FN_CEIL] = OP_CEIL, [FN_FLOOR] = OP_FLOOR, [FN_SIGN] = OP_SIGN,
+    [FN_MAX] = OP_MAX, [FN_MIN] = OP_MIN,
+};
+
+static int lookup_builtin(int func) {
+    int op = (func > FN_NONE && func < FN_COUNT) ? builtin_ops[func] : 0;
+    return op ? op : -1;    /* OP_CONST (0) marks a missing entry */
+}
+
+/* ---------- program construction ----------------------------------------- */
+
+static Program* newProgram(void) {
+    Program *p = calloc(1, sizeof(Program));
+    return p;
+}
+
+static void emit(Program *p, int op, int arg) {
+    if (p->n_code == p->cap_code) {
+        p->cap_code = p->cap_code ? p->cap_code * 2 : 32;
+        p->code = realloc(p->code, p->cap_code * sizeof(Instr));
+    }
+    p->code[p->n_code].op = op;
+    p->code[p->n_code].arg = arg;
+    p->n_code++;
+}
+
+static int addConst(Program *p, double value) {
+    for (int i = 0; i < p->n_consts; i++)
+        if (memcmp(&p->consts[i], &value, sizeof(double)) == 0)
+            return i;
+    if (p->n_consts == p->cap_consts) {
+        p->cap_consts = p->cap_consts ? p->cap_consts * 2 : 8;
+        p->consts = realloc(p->consts, p->cap_consts * sizeof(double));
+    }
+    p->consts[p->n_consts] = value;
+    return p->n_consts++;
+}
+
+static int addSub(Program *p, Program *sub) {
+    p->subs = realloc(p->subs, (p->n_subs + 1) * sizeof(Program *));
+    p->subs[p->n_subs] = sub;
+    return p->n_subs++;
+}
+
+static int compileNode(Program *p, ASTNode *node, int depth, int inline_depth);
+
+/* Emits code for node.  `depth` is the current stack height before the
+ * node runs; returns 0 if the node cannot be compiled. */
+static int compileValue(Program *p, ASTNode *node, int depth, int inline_depth) {
+    if (!node) {
+        emit(p, OP_CONST, addConst(p, 0));
+        depth++;
+        if (depth > p->max_stack) p->max_stack = depth;
+        return depth <= PROGRAM_MAX_STACK;
+    }
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            emit(p, OP_CONST, addConst(p, node->value));
+            depth++;
+            break;
+
+        case NODE_VAR:
+            emit(p, OP_X, 0);
+            depth++;
+            break;
+
+        case NODE_IDENTIFIER: {
+            double *val = lookupVariableId(node->name);
+            if (val) {
+                emit(p, OP_CONST, addConst(p, *val));
+                depth++;
+                break;
+            }
+            ASTNode *func = lookupFunctionId(node->name);
+            if (func) {
+                if (inline_depth >= MAX_INLINE_DEPTH) return 0;
+                return compileNode(p, func, depth, inline_depth + 1);
+            }
+            fprintf(stderr, "\033[1;31mError: Undefined identifier '%s'\033[0m\n", symbolName(node->name));
+            emit(p, OP_CONST, addConst(p, NAN));
+            depth++;
+            break;
+        }
+
+        case NODE_OP: {
+            if (node->op == '~') {
+                if (!compileNode(p, node->left, depth, inline_depth)) return 0;
+                emit(p, OP_NEG, 0);
+                return 1;
+            }
+            if (!compileNode(p, node->left, depth, inline_depth)) return 0;
+            if (!compileNode(p, node->right, depth + 1, inline_depth)) return 0;
+            switch (node->op) {
+                case '+': emit(p, OP_ADD, 0); break;
+                case '-': emit(p, OP_SUB, 0); break;
+                case '*': emit(p, OP_MUL, 0); break;
+                case '/': emit(p, OP_DIV, 0); break;
+                case '^': emit(p, OP_POW, 0); break;
+                default:  return 0;
+            }
+            return 1;
+        }
+
+        case NODE_FUNC: {
+            int op = lookup_builtin(node->func);
+            if (op < 0) return 0;
+            if (!compileNode(p, node->left, depth, inline_depth)) return 0;
+            emit(p, op, 0);
+            return 1;
+        }
+
+        case NODE_FUNC2: {
+            int op = lookup_builtin(node->func);
+            if (op < 0) return 0;
+            if (!compileNode(p, node->left, depth, inline_depth)) return 0;
+            if (!compileNode(p, node->right, depth + 1, inline_depth)) return 0;
+            emit(p, op, 0);
+            return 1;
+        }
+
+        case NODE_FUNC3: {
+            if (node->func != FN_FMA) return 0;
+            if (!compileNode(p, node->left, depth, inline_depth)) return 0;
+            if (!compileNode(p, node->right, depth + 1, inline_depth)) return 0;
+            if (!compileNode(p, node->arg2, depth + 2, inline_depth)) return 0;
+            emit(p, OP_FMA, 0);
+            return 1;
+        }
+
+        case NODE_DERIVATIVE: {
+            Program *sub = newProgram();
+            if (!compileNode(sub, node->left, 0, inline_depth)) {
+                freeProgram(sub);
+                return 0;
+            }
+            emit(sub, OP_RET, 0);
+            emit(p, OP_DERIV, addSub(p, sub));
+            depth++;
+            break;
+        }
+
+        default:
+            return 0;
+    }
+
+    if (depth > p->max_stack) p->max_stack = depth;
+    return depth <= PROGRAM_MAX_STACK;
+}
+
+/* Shared DAG nodes are computed once: the first use stores the value in a
+ * local slot, later uses load it.  Memo slots are only meaningful for the
+ * DAG being compiled, not for inlined function bodies. */
+static int compileNode(Program *p, ASTNode *node, int depth, int inline_depth) {
+    int slot = (node && inline_depth == 0) ? node->memo : -1;
+    if (slot < 0 || slot >= EVAL_MEMO_SLOTS)
+        return compileValue(p, node, depth, inline_depth);
+
+    unsigned long long bit = 1ULL << slot;
+    if (p->stored & bit) {
+        emit(p, OP_LOAD, slot);
+        depth++;
+        if (depth > p->max_stack) p->max_stack = depth;
+        return depth <= PROGRAM_MAX_STACK;
+    }
+    if (!compileValue(p, node, depth, inline_depth)) return 0;
+    emit(p, OP_STORE, slot);
+    p->stored |= bit;
+    return 1;
+}
+
+Program* compileProgram(ASTNode *node) {
+    Program *p = newProgram();
+    if (!compileNode(p, node, 0, 0)) {
+        freeProgram(p);
+        return NULL;
+    }
+    emit(p, OP_RET, 0);
+    return p;
+}
+
+void freeProgram(Program *prog) {
+    if (!prog) return;
+    for (int i = 0; i < prog->n_subs; i++)
+        freeProgram(prog->subs[i]);
+    free(prog->subs);
+    free(prog->code);
+    free(prog->consts);
+    free(prog);
+}
+
+/* ---------- interpreter --------------------------------------------------- */
+
+double runProgram(const Program *prog, double x) {
+    double stack[PROGRAM_MAX_STACK];
+    double locals[EVAL_MEMO_SLOTS];
+    double *sp = stack;             /* points one past the top */
+    const Instr  *ip = prog->code;
+    const double *k  = prog->consts;
+
+    for (;;) {
+        switch (ip->op) {
+            case OP_CONST: *sp++ = k[ip->arg]; break;
+            case OP_X:     *sp++ = x; break;
+
+            case OP_ADD: sp--; sp[-1] = sp[-1] + sp[0]; break;
+            case OP_SUB: sp--; sp[-1] = sp[-1] - sp[0]; break;
+            case OP_MUL: sp--; sp[-1] = sp[-1] * sp[0]; break;
+            case OP_DIV:
+                sp--;
+                sp[-1] = (fabs(sp[0]) < 1e-10) ? NAN : sp[-1] / sp[0];
+                break;
+            case OP_POW: sp--; sp[-1] = pow(sp[-1], sp[0]); break;
+            case OP_NEG: sp[-1] = -sp[-1]; break;
+
+            case OP_SIN:   sp[-1] = sin(sp[-1]); break;
+            case OP_COS:   sp[-1] = cos(sp[-1]); break;
+            case OP_TAN:   sp[-1] = tan(sp[-1]); break;
+            case OP_EXP:   sp[-1] = exp(sp[-1]); break;
+            case OP_LOG:   sp[-1] = (sp[-1] > 0) ? log10(sp[-1]) : NAN; break;
+            case OP_SQRT:  sp[-1] = (sp[-1] >= 0) ? sqrt(sp[-1]) : NAN; break;
+            case OP_ABS:   sp[-1] = fabs(sp[-1]); break;
+            case OP_LN:    sp[-1] = (sp[-1] > 0) ? log(sp[-1]) : NAN; break;
+            case OP_ASIN:  sp[-1] = asin(sp[-1]); break;
+            case OP_ACOS:  sp[-1] = acos(sp[-1]); break;
+            case OP_ATAN:  sp[-1] = atan(sp[-1]); break;
+            case OP_SINH:  sp[-1] = sinh(sp[-1]); break;
+            case OP_COSH:  sp[-1] = cosh(sp[-1]); break;
+            case OP_TANH:  sp[-1] = tanh(sp[-1]); break;
+            case OP_CEIL:  sp[-1] = ceil(sp[-1]); break;
+            case OP_FLOOR: sp[-1] = floor(sp[-1]); break;
+            case OP_SIGN:  sp[-1] = (sp[-1] > 0) ? 1 : (sp[-1] < 0) ? -1 : sp[-1]; break;
+
+            case OP_MAX: sp--; sp[-1] = (sp[-1] > sp[0]) ? sp[-1] : sp[0]; break;
+            case OP_MIN: sp--; sp[-1] = (sp[-1] < sp[0]) ? sp[-1] : sp[0]; break;
+            case OP_FMA: sp -= 2; sp[-1] = fma(sp[-1], sp[0], sp[1]); break;
+
+            case OP_DERIV: {
+                const Program *sub = prog->subs[ip->arg];
+                double h = 1e-5;
+                *sp++ = (runProgram(sub, x + h) - runProgram(sub, x - h)) / (2*h);
+                break;
+            }
+
+            case OP_STORE: locals[ip->arg] = sp[-1]; break;
+            case OP_LOAD:  *sp++ = locals[ip->arg]; break;
+
+            case OP_RET:
+                return sp[-1];
+        }
+        ip++;
+    }
+}
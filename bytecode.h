@@ -0,0 +1,49 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "ast.h"
+
+/* Maximum operand stack depth a compiled program may use.  Deeper trees
+ * are rejected by compileProgram() and fall back to evaluate(). */
+#define PROGRAM_MAX_STACK 256
+
+typedef enum {
+    OP_CONST,       /* push consts[arg]                      */
+    OP_X,           /* push x                                */
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW,
+    OP_NEG,
+    OP_SIN, OP_COS, OP_TAN, OP_EXP, OP_LOG, OP_SQRT, OP_ABS, OP_LN,
+    OP_ASIN, OP_ACOS, OP_ATAN, OP_SINH, OP_COSH, OP_TANH,
+    OP_CEIL, OP_FLOOR, OP_SIGN,
+    OP_MAX, OP_MIN,
+    OP_FMA,         /* a b c -> a*b + c, single rounding     */
+    OP_DERIV,       /* push d/dx of subs[arg] at x           */
+    OP_STORE,       /* locals[arg] = top (value stays)       */
+    OP_LOAD,        /* push locals[arg]                      */
+    OP_RET
+} OpCode;
+
+typedef struct {
+    int op;
+    int arg;
+} Instr;
+
+typedef struct Program {
+    Instr   *code;
+    int      n_code, cap_code;
+    double  *consts;        /* constant pool */
+    int      n_consts, cap_consts;
+    struct Program **subs;  /* bodies of d(...) sub-expressions */
+    int      n_subs;
+    int      max_stack;
+    unsigned long long stored;  /* shared-node slots already emitted */
+} Program;
+
+/* ---- compilation -------------------------------------------------------- */
+Program* compileProgram(ASTNode *node);
+void     freeProgram(Program *prog);
+
+/* ---- execution ---------------------------------------------------------- */
+double   runProgram(const Program *prog, double x);
+
+#endif /* BYTECODE_H */
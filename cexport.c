@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "cexport.h"
+#include "symtab.h"
+#include "native.h"
+
+/* ---------- names --------------------------------------------------------- */
+
+/* Names an exported function may not take: C keywords and what <math.h>
+ * declares, including its macros.  Generated helpers and locals start with
+ * gc_ or _. */
+static const char *reserved[] = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do",
+    "double", "else", "enum", "extern", "float", "for", "goto", "if",
+    "inline", "int", "long", "register", "restrict", "return", "short",
+    "signed", "sizeof", "static", "struct", "switch", "typedef", "union",
+    "unsigned", "void", "volatile", "while", "main",
+    "acos", "acosh", "asin", "asinh", "atan", "atan2", "atanh", "cbrt",
+    "ceil", "copysign", "cos", "cosh", "erf", "erfc", "exp", "exp2", "expm1",
+    "fabs", "fdim", "floor", "fma", "fmax", "fmin", "fmod", "frexp",
+    "gamma", "hypot", "ilogb", "j0", "j1", "jn", "ldexp", "lgamma", "llrint",
+    "llround", "log", "log10", "log1p", "log2", "logb", "lrint", "lround",
+    "modf", "nan", "nearbyint", "nextafter", "nexttoward", "pow", "remainder",
+    "remquo", "rint", "round", "scalbln", "scalbn", "signbit", "sin", "sinh",
+    "sqrt", "tan", "tanh", "tgamma", "trunc", "y0", "y1", "yn",
+    "fpclassify", "isfinite", "isgreater", "isgreaterequal", "isinf", "isless",
+    "islessequal", "islessgreater", "isnan", "isnormal", "isunordered",
+    "NAN", "INFINITY", "HUGE_VAL", "HUGE_VALF", "HUGE_VALL", "FP_NAN",
+    "FP_INFINITE", "FP_ZERO", "FP_SUBNORMAL", "FP_NORMAL", "FP_FAST_FMA",
+    "FP_ILOGB0", "FP_ILOGBNAN", "MATH_ERRNO", "MATH_ERREXCEPT",
+    "math_errhandling", "float_t", "double_t",
+    "M_E", "M_LOG2E", "M_LOG10E", "M_LN2", "M_LN10", "M_PI", "M_PI_2", "M_PI_4",
+    "M_1_PI", "M_2_PI", "M_2_SQRTPI", "M_SQRT2", "M_SQRT1_2", NULL
+};
+
+static int usableName(const char *name) {
+    if (!isalpha((unsigned char)name[0]) || strncmp(name, "gc_", 3) == 0) return 0;
+    for (const char *s = name; *s; s++)
+        if (!isalnum((unsigned char)*s) && *s != '_') return 0;
+    for (int i = 0; reserved[i]; i++)
+        if (strcmp(name, reserved[i]) == 0) return 0;
+    return 1;
+}
+
+/* Variables the code reads, in order of first use; every NAME must be
+ * one.  Returns the count, or -1 after printing why not. */
+static int collectParams(const char *func, const TacProgram *p, int *params) {
+    int n = 0;
+    for (int i = 0; i < p->n; i++) {
+        if (p->code[i].op != TAC_NAME) continue;
+        int name = p->code[i].name;
+        if (!lookupVariableId(name)) {
+            fprintf(stderr, "\033[1;31mError: %s uses '%s', which is %s\033[0m\n", func,
+                    symbolName(name), lookupFunctionId(name)
+                        ? "a def that cannot be inlined" : "not defined");
+            return -1;
+        }
+        if (!usableName(symbolName(name))) {
+            fprintf(stderr, "\033[1;31mError: variable '%s' of %s cannot be a C parameter\033[0m\n",
+                    symbolName(name), func);
+            return -1;
+        }
+        int seen = 0;
+        for (int k = 0; k < n; k++) seen |= params[k] == name;
+        if (!seen) params[n++] = name;
+    }
+    return n;
+}
+
+/* ---------- code ---------------------------------------------------------- */
+
+static const char *callNames[FN_COUNT] = {
+    [FN_SIN] = "sin", [FN_COS] = "cos", [FN_TAN] = "tan", [FN_EXP] = "exp",
+    [FN_LOG] = "gc_log", [FN_SQRT] = "gc_sqrt", [FN_ABS] = "fabs", [FN_LN] = "gc_ln",
+    [FN_ASIN] = "asin", [FN_ACOS] = "acos", [FN_ATAN] = "atan", [FN_SINH] = "sinh",
+    [FN_COSH] = "cosh", [FN_TANH] = "tanh", [FN_CEIL] = "ceil", [FN_FLOOR] = "floor",
+    [FN_SIGN] = "gc_sign", [FN_MAX] = "gc_max", [FN_MIN] = "gc_min", [FN_FMA] = "fma"
+};
+
+/* Same rules as evaluate() where C's differ. */
+static const char *helpers =
+    "static inline double gc_div(double a, double b) { return (fabs(b) < 1e-10) ? NAN : a / b; }\n"
+    "static inline double gc_log(double a) { return (a > 0) ? log10(a) : NAN; }\n"
+    "static inline double gc_ln(double a) { return (a > 0) ? log(a) : NAN; }\n"
+    "static inline double gc_sqrt(double a) { return (a >= 0) ? sqrt(a) : NAN; }\n"
+    "static inline double gc_sign(double a) { return (a > 0) ? 1 : (a < 0) ? -1 : a; }\n"
+    "static inline double gc_max(double a, double b) { return (a > b) ? a : b; }\n"
+    "static inline double gc_min(double a, double b) { return (a < b) ? a : b; }\n"
+    "static inline double gc_zero(double a) { (void)a; return 0; }\n";
+
+/* Constants are written with 17 digits, which read back to the same
+ * double, and always as floating-point literals. */
+static void writeOperand(FILE *out, const TacProgram *p, int t) {
+    const TacInstr *in = &p->code[t];
+    if (in->op == TAC_X) {
+        fprintf(out, "x");
+    } else if (in->op == TAC_NAME) {
+        fprintf(out, "%s", symbolName(in->name));
+    } else if (in->op != TAC_CONST) {
+        fprintf(out, "_t%d", t);
+    } else if (isnan(in->value)) {
+        fprintf(out, "NAN");
+    } else if (isinf(in->value)) {
+        fprintf(out, in->value < 0 ? "(-INFINITY)" : "INFINITY");
+    } else {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", in->value);
+        if (!strpbrk(buf, ".e")) strcat(buf, ".0");
+        fprintf(out, signbit(in->value) ? "(%s)" : "%s", buf);
+    }
+}
+
+static void writeParams(FILE *out, const int *params, int n, int typed) {
+    for (int i = 0; i < n; i++)
+        fprintf(out, ", %s%s", typed ? "double " : "", symbolName(params[i]));
+}
+
+static void writeFunction(FILE *out, const char *name, const TacProgram *p,
+                          const int *params, int n_params) {
+    static const char ops[] = { [TAC_ADD] = '+', [TAC_SUB] = '-', [TAC_MUL] = '*' };
+    fprintf(out, "double %s(double x", name);
+    writeParams(out, params, n_params, 1);
+    fprintf(out, ") {\n");
+    int reads_x = 0;
+    for (int i = 0; i < p->n; i++) reads_x |= p->code[i].op == TAC_X;
+    if (!reads_x) fprintf(out, "    (void)x;\n");
+    for (int i = 0; i < p->n; i++) {
+        const TacInstr *in = &p->code[i];
+        if (in->op == TAC_CONST || in->op == TAC_X || in->op == TAC_NAME) continue;
+        fprintf(out, "    const double _t%d = ", i);
+        switch (in->op) {
+            case TAC_COPY:
+                writeOperand(out, p, in->a);
+                break;
+            case TAC_NEG:
+                fprintf(out, "-");
+                writeOperand(out, p, in->a);
+                break;
+            case TAC_ADD:
+            case TAC_SUB:
+            case TAC_MUL:
+                writeOperand(out, p, in->a);
+                fprintf(out, " %c ", ops[in->op]);
+                writeOperand(out, p, in->b);
+                break;
+            case TAC_DIV:
+            case TAC_POW:
+                fprintf(out, "%s(", in->op == TAC_DIV ? "gc_div" : "pow");
+                writeOperand(out, p, in->a);
+                fprintf(out, ", ");
+                writeOperand(out, p, in->b);
+                fprintf(out, ")");
+                break;
+            case TAC_CALL: {
+                const char *call = in->func < FN_COUNT ? callNames[in->func] : NULL;
+                fprintf(out, "%s(", call ? call : "gc_zero");
+                writeOperand(out, p, in->a);
+                if (call && in->b >= 0) {
+                    fprintf(out, ", ");
+                    writeOperand(out, p, in->b);
+                }
+                if (call && in->c >= 0) {
+                    fprintf(out, ", ");
+                    writeOperand(out, p, in->c);
+                }
+                fprintf(out, ")");
+                break;
+            }
+        }
+        fprintf(out, ";\n");
+    }
+    fprintf(out, "    return ");
+    writeOperand(out, p, p->result);
+    fprintf(out, ";\n}\n\n");
+
+    fprintf(out, "void %s_array(const double *_xs, double *_ys, long _n", name);
+    writeParams(out, params, n_params, 1);
+    fprintf(out, ") {\n    for (long _i = 0; _i < _n; _i++) _ys[_i] = %s(_xs[_i]", name);
+    writeParams(out, params, n_params, 0);
+    fprintf(out, ");\n}\n\n");
+}
+
+/* ---------- file ---------------------------------------------------------- */
+
+int exportSource(const char *path, const ExportFunc *funcs, int n) {
+    int **params = calloc(n, sizeof(int *));
+    int *n_params = calloc(n, sizeof(int));
+    int ok = 1;
+    for (int f = 0; f < n && ok; f++) {
+        if (!usableName(funcs[f].name)) {
+            fprintf(stderr, "\033[1;31mError: '%s' cannot be the name of a C function\033[0m\n",
+                    funcs[f].name);
+            ok = 0;
+            break;
+        }
+        params[f] = malloc((funcs[f].tac->n + 1) * sizeof(int));
+        n_params[f] = collectParams(funcs[f].name, funcs[f].tac, params[f]);
+        ok = n_params[f] >= 0;
+    }
+
+    FILE *out = ok ? fopen(path, "w") : NULL;
+    if (ok && !out) {
+        perror(path);
+        ok = 0;
+    }
+    if (ok) {
+        fprintf(out, "/* Generated by graph_compiler's export command.\n *\n");
+        for (int f = 0; f < n; f++) {
+            fprintf(out, " *   double %s(double x", funcs[f].name);
+            writeParams(out, params[f], n_params[f], 1);
+            fprintf(out, ");\n *   void   %s_array(const double *xs, double *ys, long n",
+                    funcs[f].name);
+            writeParams(out, params[f], n_params[f], 1);
+            fprintf(out, ");\n");
+        }
+        fprintf(out, " *\n * Build without floating-point contraction, and without turning\n"
+                     " * pow(x, 2.0) into x*x, to get the values the plotter computes, e.g.\n"
+                     " *   cc -O2 -ffp-contract=off -fno-builtin-pow -fPIC -shared -o lib.so this.c -lm\n */\n"
+                     "#include <math.h>\n\n%s\n", helpers);
+        for (int f = 0; f < n; f++) {
+            writeFunction(out, funcs[f].name, funcs[f].tac, params[f], n_params[f]);
+        }
+
+        fprintf(out, "/* Read back by the plotter's load command */\n"
+                     "struct gc_export {\n"
+                     "    const char *name;\n"
+                     "    unsigned long long hash;\n"
+                     "    int n_params;\n"
+                     "    const char *const *params;\n"
+                     "    void (*eval)(const double *, double *, long, const double *);\n"
+                     "};\n\n");
+        for (int f = 0; f < n; f++) {
+            const char *name = funcs[f].name;
+            if (n_params[f] > 0) {
+                fprintf(out, "static const char *const gc_%s_params[] = {", name);
+                for (int i = 0; i < n_params[f]; i++)
+                    fprintf(out, "%s\"%s\"", i ? ", " : " ", symbolName(params[f][i]));
+                fprintf(out, " };\n");
+            }
+            fprintf(out, "static void gc_%s_eval(const double *_xs, double *_ys, long _n, "
+                         "const double *_p) {\n    %s_array(_xs, _ys, _n", name, name);
+            for (int i = 0; i < n_params[f]; i++) fprintf(out, ", _p[%d]", i);
+            fprintf(out, ");%s\n}\n", n_params[f] ? "" : "\n    (void)_p;");
+        }
+        fprintf(out, "\nconst struct gc_export gc_exports[] = {\n");
+        for (int f = 0; f < n; f++) {
+            const char *name = funcs[f].name;
+            char list[160];
+            snprintf(list, sizeof(list), n_params[f] ? "gc_%s_params" : "0", name);
+            fprintf(out, "    { \"%s\", 0x%016llxULL, %d, %s, gc_%s_eval },\n", name,
+                    tacHash(funcs[f].tac), n_params[f], list, name);
+        }
+        fprintf(out, "};\nconst int gc_export_count = %d;\nconst int gc_export_version = %d;\n",
+                n, NATIVE_ABI_VERSION);
+        if (fclose(out) != 0) {
+            perror(path);
+            ok = 0;
+        }
+    }
+    for (int f = 0; f < n; f++) free(params[f]);
+    free(params);
+    free(n_params);
+    return ok;
+}
+
+int compileShared(const char *c_path, const char *so_path) {
+    const char *cc = getenv("CC");
+    if (!cc || !*cc) cc = "cc";
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 0;
+    }
+    if (pid == 0) {
+        execlp(cc, cc, "-O2", "-ffp-contract=off", "-fno-builtin-pow", "-fPIC", "-shared",
+               "-o", so_path, c_path, "-lm", (char *)NULL);
+        perror(cc);
+        _exit(127);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "\033[1;31mError: %s could not build %s\033[0m\n", cc, so_path);
+        return 0;
+    }
+    return 1;
+}
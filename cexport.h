@@ -0,0 +1,32 @@
+#ifndef CEXPORT_H
+#define CEXPORT_H
+
+#include "tac.h"
+
+/* Ahead-of-time export: writes the optimized three-address code of a set
+ * of functions as one self-contained C file, which needs nothing but
+ * <math.h>.  For a function f reading variables a and b it defines
+ *
+ *     double f(double x, double a, double b);
+ *     void   f_array(const double *xs, double *ys, long n, double a, double b);
+ *
+ * Code lowered from a linked tree has its variables folded in, and the
+ * entry points take x alone.  The file also holds the table that `load`
+ * reads back (see native.h).  Built without floating-point contraction
+ * or pow() folding and with the same libm, it computes what evaluate()
+ * does, bit for bit. */
+
+typedef struct {
+    const char       *name;
+    const TacProgram *tac;
+} ExportFunc;
+
+/* Returns 0 and prints why if a function cannot be exported: its name is
+ * not a free C identifier, or its code still calls a def that could not
+ * be inlined (a recursive one). */
+int exportSource(const char *path, const ExportFunc *funcs, int n);
+
+/* Builds a shared library from a C file with $CC (cc by default). */
+int compileShared(const char *c_path, const char *so_path);
+
+#endif /* CEXPORT_H */
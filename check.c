@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ast.h"
+#include "symtab.h"
+#include "parser.h"
+#include "simplify.h"
+#include "inliner.h"
+#include "sampler.h"
+
+/* Regression checks: every backend against the plain tree walk of the
+ * parsed expression, on expressions that once came out wrong.
+ *
+ *   ./graph_check      (make check)
+ *
+ * Prints each failure and exits 1 if there was one. */
+
+#define CHECK_POINTS 257
+#define CHECK_TOLERANCE 1e-9
+
+/* Sweeps for the culling checks: the blocks below 0 are wholly undefined
+ * for sqrt and ln. */
+#define CULL_X_MIN -40.0
+#define CULL_X_MAX  40.0
+#define CULL_STEP   0.01
+
+static const char *backend_names[] = {"ast", "vm", "batch", "jit", "tac"};
+
+static int failures;
+
+/* Returns the expression, or NULL after storing a let or def. */
+static ASTNode* parse(const char *source) {
+    Statement s;
+    if (!parseStatement(source, &s)) {
+        printf("FAIL  parse '%s': %s\n", source, s.error);
+        failures++;
+        return NULL;
+    }
+    if (s.kind == STMT_LET) {
+        s.node = inlineAST(s.node);
+        storeVariable(s.name, evaluate(s.node, 0));
+        freeAST(s.node);
+    } else if (s.kind == STMT_DEF) {
+        storeFunction(s.name, persistAST(s.node));
+    }
+    freeStatement(&s);
+    return s.kind == STMT_EXPR ? s.node : NULL;
+}
+
+static int agrees(double a, double b) {
+    if (isnan(a) || isnan(b)) return isnan(a) && isnan(b);
+    return fabs(a - b) <= CHECK_TOLERANCE * (1 + fabs(b));
+}
+
+/* Samples source on [x_min, x_max] with every backend after the
+ * optimization pipeline and compares with evaluate() on reference as
+ * parsed, which shares nothing. */
+static void checkRange(const char *label, const char *source, const char *reference,
+                       double x_min, double x_max) {
+    ASTArena *scratch = arenaCreate();
+    ASTArena *previous = arenaSwitch(scratch);
+    ASTNode *plain = parse(reference);
+    ASTNode *node = parse(source);
+    if (plain && node) {
+        node = hashConsAST(simplifyAST(optimizeAST(inlineAST(node))));
+        double xs[CHECK_POINTS], expected[CHECK_POINTS], ys[CHECK_POINTS];
+        for (int i = 0; i < CHECK_POINTS; i++) {
+            xs[i] = x_min + (x_max - x_min) * i / (CHECK_POINTS - 1);
+            expected[i] = evaluate(plain, xs[i]);
+        }
+        Backend saved = backend;
+        for (int b = BACKEND_AST; b <= BACKEND_TAC; b++) {      /* native needs a loaded export */
+            backend = (Backend)b;
+            Sampler s;
+            prepareSampler(&s, node);
+            evaluatePoints(&s, xs, ys, CHECK_POINTS);
+            releaseSampler(&s);
+            for (int i = 0; i < CHECK_POINTS; i++) {
+                if (agrees(ys[i], expected[i])) continue;
+                printf("FAIL  %-18s %-6s f(%g) = %.10g, expected %.10g\n",
+                       label, backend_names[b], xs[i], ys[i], expected[i]);
+                failures++;
+                break;
+            }
+        }
+        backend = saved;
+    }
+    arenaSwitch(previous);
+    arenaDestroy(scratch);
+}
+
+static void checkAgainst(const char *label, const char *source, const char *reference) {
+    checkRange(label, source, reference, -3, 3);
+}
+
+static void checkBackends(const char *label, const char *source) {
+    checkAgainst(label, source, source);
+}
+
+/* A sampler is stale after a store to a name it was linked against, here
+ * or in a def it calls, and only then. */
+static void checkGenerations(void) {
+    parse("let gk = 2");
+    parse("def gf = gk*x");
+    ASTArena *scratch = arenaCreate();
+    ASTArena *previous = arenaSwitch(scratch);
+    ASTNode *node = parse("gf + 1");
+    Sampler s;
+    prepareSampler(&s, node);
+    int fresh = samplerCurrent(&s);
+    parse("let gother = 1");
+    int unrelated = samplerCurrent(&s);
+    parse("let gk = 3");
+    int stale = !samplerCurrent(&s);
+    releaseSampler(&s);
+    arenaSwitch(previous);
+    arenaDestroy(scratch);
+    if (!fresh || !unrelated || !stale) {
+        printf("FAIL  generations      current %d, after an unrelated let %d, after let gk %d\n",
+               fresh, unrelated, !stale);
+        failures++;
+    }
+}
+
+/* Sweeps source with every backend but ast, which skips interval culling
+ * and evaluates every point, and compares each point with the ast sweep:
+ * a block culled as undefined must have had no defined point. */
+static void checkCulling(const char *label, const char *source) {
+    ASTArena *scratch = arenaCreate();
+    ASTArena *previous = arenaSwitch(scratch);
+    ASTNode *node = parse(source);
+    if (node) {
+        node = hashConsAST(simplifyAST(optimizeAST(inlineAST(node))));
+        long count = sweepPoints(CULL_X_MIN, CULL_X_MAX, CULL_STEP);
+        double *expected = malloc(count * sizeof(double));
+        double *ys = malloc(count * sizeof(double));
+        Backend saved = backend;
+        for (int b = BACKEND_AST; b <= BACKEND_TAC; b++) {      /* native needs a loaded export */
+            backend = (Backend)b;
+            Sampler s;
+            prepareSampler(&s, node);
+            sampleSweep(&s, 1, CULL_X_MIN, CULL_STEP, 0, count, b == BACKEND_AST ? &expected : &ys);
+            releaseSampler(&s);
+            for (long i = 0; b != BACKEND_AST && i < count; i++) {
+                if (agrees(ys[i], expected[i])) continue;
+                printf("FAIL  %-18s %-6s f(%g) = %.10g, expected %.10g\n", label,
+                       backend_names[b], CULL_X_MIN + i * CULL_STEP, ys[i], expected[i]);
+                failures++;
+                break;
+            }
+        }
+        backend = saved;
+        free(expected);
+        free(ys);
+    }
+    arenaSwitch(previous);
+    arenaDestroy(scratch);
+}
+
+/* sum of n terms sin(x+k)*sin(x+k): n shared subtrees, more than there
+ * are memo slots */
+static char* sharedTerms(int n) {
+    size_t cap = n * 40;
+    char *s = malloc(cap);
+    size_t len = 0;
+    for (int k = 1; k <= n; k++) {
+        len += snprintf(s + len, cap - len, "%ssin(x+%d)*sin(x+%d)", k > 1 ? " + " : "", k, k);
+    }
+    return s;
+}
+
+int main(void) {
+    char *shared = sharedTerms(300);
+    checkBackends("shared_300", shared);
+    free(shared);
+    checkBackends("shared_nested", "sin(x)*sin(x) + cos(sin(x)*sin(x)) + exp(cos(sin(x)*sin(x))/4)");
+
+    parse("let a = 0.5");
+    parse("def f = a*x^3 + sin(x)");
+    checkBackends("def", "f*f + d(f)");
+
+    /* d() follows a redefinition like any other use */
+    parse("def p = sin(x)");
+    parse("def q = d(p)");
+    parse("def p = x*x");
+    checkAgainst("d_redefined", "q + p", "2*x + x*x");
+
+    checkGenerations();
+
+    /* x^3 overflows beyond |x| ~ 5.6e102: the terms must not cancel */
+    checkRange("cancel_overflow", "x^3 - x^3 + x", "x^3 - x^3 + x", -1e110, 1e110);
+    checkRange("cancel_horner", "x^3 - x^3 + x^2/1e200 + x", "x^3 - x^3 + x^2/1e200 + x", -1e110, 1e110);
+    checkRange("cancel_partial", "2*x^3 - 1.9*x^3 + x", "2*x^3 - 1.9*x^3 + x", -1e110, 1e110);
+    checkRange("cancel_zero", "0*x^2 + x + 1", "0*x^2 + x + 1", -1e160, 1e160);
+
+    /* NaN regions and poles through interval culling */
+    checkCulling("cull_sqrt", "sqrt(x)");
+    checkCulling("cull_ln", "ln(x)");
+    checkCulling("cull_asin", "asin(x/2)");
+    checkCulling("cull_pole", "1/(x-1)");
+    checkCulling("cull_tan", "tan(x)");
+    checkCulling("cull_pow", "x^0.5");
+    checkCulling("cull_max_ln", "max(ln(x), 0)");
+
+    if (failures) {
+        printf("%d check%s failed\n", failures, failures > 1 ? "s" : "");
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -1,8 +0,0 @@
-#ifndef COMMANDS_H
-#define COMMANDS_H
-
-extern int  cmd_let, cmd_def, cmd_ast, cmd_vars, cmd_funcs, cmd_show;
-extern char show_func_name[50];
-extern int  error_occurred;
-
-#endif /* COMMANDS_H */
\ No newline at end of file
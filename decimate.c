@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <math.h>
+#include "decimate.h"
+
+void decimatorInit(Decimator *d, DecimateMode mode, long width,
+                   double x_min, double x_max, DecimateSink sink, void *ctx) {
+    d->mode = mode;
+    d->width = width > 0 ? width : 1;
+    d->x_min = x_min;
+    d->scale = x_max > x_min ? d->width / (x_max - x_min) : 0;
+    d->sink = sink;
+    d->ctx = ctx;
+    d->column = -1;
+    d->seen = 0;
+    d->current = (PointBuffer){0};
+    d->pending = (PointBuffer){0};
+    d->has_kept = 0;
+}
+
+static long columnOf(const Decimator *d, double x) {
+    double c = floor((x - d->x_min) * d->scale);
+    if (!(c >= 0)) return 0;
+    return c < d->width ? (long)c : d->width - 1;
+}
+
+static void pushPoint(PointBuffer *b, double x, double y) {
+    if (b->n == b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 256;
+        b->xy = realloc(b->xy, b->cap * 2 * sizeof(double));
+    }
+    b->xy[2 * b->n] = x;
+    b->xy[2 * b->n + 1] = y;
+    b->n++;
+}
+
+/* ---------- M4 ------------------------------------------------------------ */
+
+static void flushM4(Decimator *d) {
+    if (d->seen == 0) return;
+    // first <= low, high <= last in x; put low and high in x order and
+    // skip the ones that are the same point as a neighbour
+    const double *p[4] = { d->first, d->low, d->high, d->last };
+    if (p[1][0] > p[2][0]) {
+        p[1] = d->high;
+        p[2] = d->low;
+    }
+    const double *prev = NULL;
+    for (int i = 0; i < 4; i++) {
+        if (prev && p[i][0] == prev[0]) continue;
+        d->sink(d->ctx, p[i][0], p[i][1]);
+        prev = p[i];
+    }
+    d->seen = 0;
+}
+
+static void addM4(Decimator *d, double x, double y) {
+    long column = columnOf(d, x);
+    if (column != d->column) {
+        flushM4(d);
+        d->column = column;
+    }
+    if (d->seen++ == 0) {
+        d->first[0] = d->low[0] = d->high[0] = x;
+        d->first[1] = d->low[1] = d->high[1] = y;
+    } else if (y < d->low[1]) {
+        d->low[0] = x;
+        d->low[1] = y;
+    } else if (y > d->high[1]) {
+        d->high[0] = x;
+        d->high[1] = y;
+    }
+    d->last[0] = x;
+    d->last[1] = y;
+}
+
+/* ---------- LTTB ---------------------------------------------------------- */
+
+static void keep(Decimator *d, double x, double y) {
+    d->sink(d->ctx, x, y);
+    d->kept[0] = x;
+    d->kept[1] = y;
+    d->has_kept = 1;
+}
+
+/* Keeps the pending column's point with the largest triangle between the
+ * last kept point and (nx, ny). */
+static void settle(Decimator *d, double nx, double ny) {
+    PointBuffer *b = &d->pending;
+    if (b->n == 0) return;
+    double ax = d->kept[0], ay = d->kept[1];
+    long best = 0;
+    double best_area = -1;
+    for (long i = 0; i < b->n; i++) {
+        double px = b->xy[2 * i], py = b->xy[2 * i + 1];
+        double area = fabs((ax - nx) * (py - ay) - (ax - px) * (ny - ay));
+        if (area > best_area) {
+            best_area = area;
+            best = i;
+        }
+    }
+    keep(d, b->xy[2 * best], b->xy[2 * best + 1]);
+    b->n = 0;
+}
+
+static void meanOf(const PointBuffer *b, double *mx, double *my) {
+    double sx = 0, sy = 0;
+    for (long i = 0; i < b->n; i++) {
+        sx += b->xy[2 * i];
+        sy += b->xy[2 * i + 1];
+    }
+    *mx = sx / b->n;
+    *my = sy / b->n;
+}
+
+static void addLTTB(Decimator *d, double x, double y) {
+    long column = columnOf(d, x);
+    if (!d->has_kept) {
+        // a segment always starts with its first point
+        keep(d, x, y);
+        d->column = column;
+        return;
+    }
+    if (column != d->column && d->current.n > 0) {
+        double mx, my;
+        meanOf(&d->current, &mx, &my);
+        settle(d, mx, my);
+        PointBuffer t = d->pending;
+        d->pending = d->current;
+        d->current = t;
+        d->current.n = 0;
+    }
+    d->column = column;
+    pushPoint(&d->current, x, y);
+}
+
+/* Ends a segment with its last point. */
+static void flushLTTB(Decimator *d) {
+    if (d->current.n > 0) {
+        double lx = d->current.xy[2 * d->current.n - 2];
+        double ly = d->current.xy[2 * d->current.n - 1];
+        double mx, my;
+        meanOf(&d->current, &mx, &my);
+        settle(d, mx, my);
+        keep(d, lx, ly);
+    }
+    d->current.n = d->pending.n = 0;
+    d->has_kept = 0;
+}
+
+/* ---------- interface ----------------------------------------------------- */
+
+void decimatorAdd(Decimator *d, double x, double y) {
+    switch (d->mode) {
+        case DECIMATE_M4:   addM4(d, x, y); break;
+        case DECIMATE_LTTB: addLTTB(d, x, y); break;
+        default:            d->sink(d->ctx, x, y); break;
+    }
+}
+
+static void flush(Decimator *d) {
+    if (d->mode == DECIMATE_M4) flushM4(d);
+    if (d->mode == DECIMATE_LTTB) flushLTTB(d);
+    d->column = -1;
+}
+
+void decimatorBreak(Decimator *d) {
+    flush(d);
+    d->sink(d->ctx, NAN, NAN);
+}
+
+void decimatorFinish(Decimator *d) {
+    flush(d);
+    free(d->current.xy);
+    free(d->pending.xy);
+    d->current = (PointBuffer){0};
+    d->pending = (PointBuffer){0};
+}
@@ -0,0 +1,61 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+/* Pixel-aware decimation.  The x-range is divided into `width` columns and
+ * each curve is reduced column by column as its points stream in, so only
+ * the current column is ever held:
+ *
+ *   M4    keeps the first, last, lowest and highest point of every column.
+ *         A line through them lights the same pixels as the full curve
+ *         when the columns are no wider than a pixel.
+ *   LTTB  keeps one point per column, the one spanning the largest
+ *         triangle with the point kept before it and the mean of the next
+ *         column (Largest-Triangle-Three-Buckets).  Fewer points, close
+ *         to but not exactly the same picture.
+ *
+ * Points must arrive in ascending x.  Kept points are passed to a sink;
+ * (NaN, NaN) is passed through as a break between line segments. */
+
+typedef enum {
+    DECIMATE_OFF,
+    DECIMATE_M4,
+    DECIMATE_LTTB
+} DecimateMode;
+
+typedef void (*DecimateSink)(void *ctx, double x, double y);
+
+typedef struct {
+    double *xy;
+    long    n, cap;
+} PointBuffer;
+
+typedef struct {
+    DecimateMode mode;
+    double       x_min, scale;  /* column = (x - x_min) * scale */
+    long         width;
+    DecimateSink sink;
+    void        *ctx;
+
+    long   column;              /* column being filled, -1 before the first point */
+    long   seen;                /* points in the current column */
+
+    /* M4: the column's first, last, lowest and highest points (x y) */
+    double first[2], last[2], low[2], high[2];
+
+    /* LTTB: points of the column being filled and of the one before it,
+     * which is settled once this one is complete; `kept` is the last point
+     * passed on */
+    PointBuffer current, pending;
+    double      kept[2];
+    int         has_kept;
+} Decimator;
+
+void decimatorInit(Decimator *d, DecimateMode mode, long width,
+                   double x_min, double x_max, DecimateSink sink, void *ctx);
+void decimatorAdd(Decimator *d, double x, double y);
+/* Ends the current segment; the next point starts a new one. */
+void decimatorBreak(Decimator *d);
+/* Ends the curve and releases the buffers. */
+void decimatorFinish(Decimator *d);
+
+#endif /* DECIMATE_H */
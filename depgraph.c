@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <string.h>
+#include "depgraph.h"
+
+/* Users of a name are functions (their symbol id, >= 0) and tracked
+ * expressions (encoded as -1 - expr). */
+#define EXPR_USER(e) (-1 - (e))
+
+typedef struct {
+    int *ids;
+    int  n, cap;
+} IdList;
+
+static IdList *func_uses;   /* by symbol id: names a function body refers to */
+static IdList *users;       /* by symbol id: who refers to the name */
+static int     n_ids;
+static IdList  expr_uses[DEPGRAPH_MAX_EXPRS];
+static char    tracked[DEPGRAPH_MAX_EXPRS];
+static char    stale[DEPGRAPH_MAX_EXPRS];
+
+static void growTo(int id) {
+    if (id < n_ids) return;
+    int n = n_ids ? n_ids : 64;
+    while (n <= id) n *= 2;
+    func_uses = realloc(func_uses, n * sizeof(IdList));
+    users = realloc(users, n * sizeof(IdList));
+    memset(func_uses + n_ids, 0, (n - n_ids) * sizeof(IdList));
+    memset(users + n_ids, 0, (n - n_ids) * sizeof(IdList));
+    n_ids = n;
+}
+
+static int contains(const IdList *l, int id) {
+    for (int i = 0; i < l->n; i++)
+        if (l->ids[i] == id) return 1;
+    return 0;
+}
+
+static void add(IdList *l, int id) {
+    if (contains(l, id)) return;
+    if (l->n == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 4;
+        l->ids = realloc(l->ids, l->cap * sizeof(int));
+    }
+    l->ids[l->n++] = id;
+}
+
+static void removeId(IdList *l, int id) {
+    for (int i = 0; i < l->n; i++) {
+        if (l->ids[i] == id) {
+            l->ids[i] = l->ids[--l->n];
+            return;
+        }
+    }
+}
+
+static void collectNames(const ASTNode *n, IdList *out) {
+    if (!n) return;
+    if (n->type == NODE_IDENTIFIER) {
+        add(out, n->name);
+        return;
+    }
+    collectNames(n->left, out);
+    collectNames(n->right, out);
+    collectNames(n->arg2, out);
+}
+
+/* Points the edges of a user at new names, dropping the old ones. */
+static void setUses(IdList *uses, int user, const ASTNode *node) {
+    for (int i = 0; i < uses->n; i++) removeId(&users[uses->ids[i]], user);
+    uses->n = 0;
+    collectNames(node, uses);
+    for (int i = 0; i < uses->n; i++) {
+        growTo(uses->ids[i]);
+        add(&users[uses->ids[i]], user);
+    }
+}
+
+void depgraphDefine(int id, const ASTNode *body) {
+    growTo(id);
+    if (body) setUses(&func_uses[id], id, body);
+
+    // Walk the users backwards from the name; defs may be recursive
+    char *seen = calloc(n_ids, 1);
+    int *queue = malloc(n_ids * sizeof(int));
+    int head = 0, tail = 0;
+    queue[tail++] = id;
+    seen[id] = 1;
+    while (head < tail) {
+        IdList *l = &users[queue[head++]];
+        for (int i = 0; i < l->n; i++) {
+            int u = l->ids[i];
+            if (u < 0) {
+                stale[-1 - u] = 1;
+            } else if (!seen[u]) {
+                seen[u] = 1;
+                queue[tail++] = u;
+            }
+        }
+    }
+    free(queue);
+    free(seen);
+}
+
+void depgraphTrack(int expr, const ASTNode *node) {
+    if (expr < 0 || expr >= DEPGRAPH_MAX_EXPRS) return;
+    setUses(&expr_uses[expr], EXPR_USER(expr), node);
+    tracked[expr] = 1;
+    stale[expr] = 0;
+}
+
+void depgraphForget(int expr) {
+    if (expr < 0 || expr >= DEPGRAPH_MAX_EXPRS) return;
+    setUses(&expr_uses[expr], EXPR_USER(expr), NULL);
+    tracked[expr] = 0;
+    stale[expr] = 0;
+}
+
+int depgraphTakeStale(int *exprs, int max) {
+    int n = 0;
+    for (int e = 0; e < DEPGRAPH_MAX_EXPRS && n < max; e++) {
+        if (stale[e] && tracked[e]) exprs[n++] = e;
+        stale[e] = 0;
+    }
+    return n;
+}
@@ -0,0 +1,28 @@
+#ifndef DEPGRAPH_H
+#define DEPGRAPH_H
+
+#include "ast.h"
+
+/* Dependency graph between names and the expressions that use them.  A
+ * function depends on the names its body refers to, and a tracked
+ * expression (a stored or plotted one, numbered by the caller) on the
+ * names it refers to.  Every store to the symbol table marks the
+ * expressions that reach the name, directly or through nested defs, as
+ * stale; nothing else has to be re-evaluated. */
+
+#define DEPGRAPH_MAX_EXPRS 64
+
+/* Called by the symbol table after a store: body is the new body of a
+ * function, NULL for a variable. */
+void depgraphDefine(int id, const ASTNode *body);
+
+/* Records the names an expression refers to, replacing what it used
+ * before, and clears its stale mark. */
+void depgraphTrack(int expr, const ASTNode *node);
+void depgraphForget(int expr);
+
+/* Moves up to max stale expressions into exprs, in increasing order, and
+ * returns how many there were. */
+int  depgraphTakeStale(int *exprs, int max);
+
+#endif /* DEPGRAPH_H */
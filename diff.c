@@ -0,0 +1,265 @@
+#include "diff.h"
+#include "symtab.h"
+
+/* Nesting limit for inlined user functions; also catches def f = d(f). */
+#define MAX_INLINE_DEPTH 64
+
+/* ---------- folding constructors ------------------------------------------ */
+/* Each constructor takes ownership of its arguments.  They fold the zeros
+ * and ones the product/chain rules produce so the result stays small
+ * before optimizeAST() sees it. */
+
+static int isNum(ASTNode *n, double v) {
+    return n && n->type == NODE_NUMBER && n->value == v;
+}
+
+static ASTNode* num(double v) {
+    return createNumberNode(v);
+}
+
+static ASTNode* add(ASTNode *a, ASTNode *b) {
+    if (isNum(a, 0)) { freeAST(a); return b; }
+    if (isNum(b, 0)) { freeAST(b); return a; }
+    return createOpNode('+', a, b);
+}
+
+static ASTNode* neg(ASTNode *a) {
+    if (a->type == NODE_NUMBER) {
+        a->value = -a->value;
+        return a;
+    }
+    if (a->type == NODE_OP && a->op == '~') {
+        ASTNode *inner = a->left;
+        a->left = NULL;
+        freeAST(a);
+        return inner;
+    }
+    return createOpNode('~', a, NULL);
+}
+
+static ASTNode* sub(ASTNode *a, ASTNode *b) {
+    if (isNum(b, 0)) { freeAST(b); return a; }
+    if (isNum(a, 0)) { freeAST(a); return neg(b); }
+    return createOpNode('-', a, b);
+}
+
+static ASTNode* mul(ASTNode *a, ASTNode *b) {
+    if (isNum(a, 0) || isNum(b, 0)) {
+        freeAST(a);
+        freeAST(b);
+        return num(0);
+    }
+    if (isNum(a, 1)) { freeAST(a); return b; }
+    if (isNum(b, 1)) { freeAST(b); return a; }
+    return createOpNode('*', a, b);
+}
+
+static ASTNode* dvd(ASTNode *a, ASTNode *b) {
+    if (isNum(a, 0)) { freeAST(b); return a; }
+    if (isNum(b, 1)) { freeAST(b); return a; }
+    return createOpNode('/', a, b);
+}
+
+static ASTNode* fn(BuiltinFunc func, ASTNode *a) {
+    return createFuncNode(func, a);
+}
+
+static ASTNode* cp(ASTNode *n) {
+    return copyAST(n);
+}
+
+/* sqrt(u) * sqrt(u): equals u where u >= 0 and is NaN where u < 0, so
+ * derivatives of ln/log keep the domain of the original function. */
+static ASTNode* guardedArg(ASTNode *u) {
+    return mul(fn(FN_SQRT, cp(u)), fn(FN_SQRT, cp(u)));
+}
+
+/* ---------- differentiation ----------------------------------------------- */
+
+static ASTNode* diff(ASTNode *node, int inline_depth);
+
+/* d/dx f(u) = f'(u) * u' for the single-argument builtins */
+static ASTNode* diffFunc(ASTNode *node, int inline_depth) {
+    ASTNode *u = node->left;
+    ASTNode *du = diff(u, inline_depth);
+    if (!du) return NULL;
+    if (isNum(du, 0)) return du;
+
+    ASTNode *outer;
+
+    switch (node->func) {
+        case FN_SIN:
+            outer = fn(FN_COS, cp(u));
+            break;
+        case FN_COS:
+            outer = neg(fn(FN_SIN, cp(u)));
+            break;
+        case FN_TAN:
+            outer = dvd(num(1), mul(fn(FN_COS, cp(u)), fn(FN_COS, cp(u))));
+            break;
+        case FN_EXP:
+            outer = fn(FN_EXP, cp(u));
+            break;
+        case FN_LN:
+            return dvd(du, guardedArg(u));
+        case FN_LOG:
+            return dvd(du, mul(num(log(10.0)), guardedArg(u)));
+        case FN_SQRT:
+            return dvd(du, mul(num(2), fn(FN_SQRT, cp(u))));
+        case FN_ABS:
+            outer = fn(FN_SIGN, cp(u));
+            break;
+        case FN_ASIN:
+            return dvd(du, fn(FN_SQRT, sub(num(1), mul(cp(u), cp(u)))));
+        case FN_ACOS:
+            return neg(dvd(du, fn(FN_SQRT, sub(num(1), mul(cp(u), cp(u))))));
+        case FN_ATAN:
+            return dvd(du, add(num(1), mul(cp(u), cp(u))));
+        case FN_SINH:
+            outer = fn(FN_COSH, cp(u));
+            break;
+        case FN_COSH:
+            outer = fn(FN_SINH, cp(u));
+            break;
+        case FN_TANH:
+            outer = sub(num(1), mul(fn(FN_TANH, cp(u)), fn(FN_TANH, cp(u))));
+            break;
+        case FN_CEIL:
+        case FN_FLOOR:
+        case FN_SIGN:
+            /* piecewise constant: zero wherever the derivative exists */
+            freeAST(du);
+            return num(0);
+        default:
+            freeAST(du);
+            return NULL;
+    }
+    return mul(outer, du);
+}
+
+/* d/dx u^v */
+static ASTNode* diffPow(ASTNode *u, ASTNode *v, int inline_depth) {
+    ASTNode *du = diff(u, inline_depth);
+    if (!du) return NULL;
+    ASTNode *dv = diff(v, inline_depth);
+    if (!dv) { freeAST(du); return NULL; }
+
+    if (isNum(dv, 0)) {
+        /* constant exponent: v * u^(v-1) * u' */
+        freeAST(dv);
+        if (isNum(du, 0)) return du;
+        ASTNode *power;
+        if (v->type == NODE_NUMBER && v->value == 1) {
+            power = num(1);
+        } else if (v->type == NODE_NUMBER && v->value == 2) {
+            power = cp(u);
+        } else if (v->type == NODE_NUMBER) {
+            power = createOpNode('^', cp(u), num(v->value - 1));
+        } else {
+            power = createOpNode('^', cp(u), sub(cp(v), num(1)));
+        }
+        return mul(mul(cp(v), power), du);
+    }
+
+    if (isNum(du, 0)) {
+        /* constant base: u^v * ln(u) * v' */
+        freeAST(du);
+        return mul(mul(createOpNode('^', cp(u), cp(v)), fn(FN_LN, cp(u))), dv);
+    }
+
+    /* general case: u^v * (v' * ln(u) + v * u' / u) */
+    ASTNode *inner = add(mul(dv, fn(FN_LN, cp(u))),
+                         dvd(mul(cp(v), du), cp(u)));
+    return mul(createOpNode('^', cp(u), cp(v)), inner);
+}
+
+static ASTNode* diff(ASTNode *node, int inline_depth) {
+    if (!node) return num(0);
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            return num(0);
+
+        case NODE_VAR:
+            return num(1);
+
+        case NODE_IDENTIFIER: {
+            if (lookupVariableId(node->name)) return num(0);
+            ASTNode *func = lookupFunctionId(node->name);
+            if (!func || inline_depth >= MAX_INLINE_DEPTH) return NULL;
+            return diff(func, inline_depth + 1);
+        }
+
+        case NODE_OP: {
+            if (node->op == '~') {
+                ASTNode *du = diff(node->left, inline_depth);
+                return du ? neg(du) : NULL;
+            }
+            if (node->op == '^') return diffPow(node->left, node->right, inline_depth);
+
+            ASTNode *du = diff(node->left, inline_depth);
+            if (!du) return NULL;
+            ASTNode *dv = diff(node->right, inline_depth);
+            if (!dv) { freeAST(du); return NULL; }
+
+            switch (node->op) {
+                case '+': return add(du, dv);
+                case '-': return sub(du, dv);
+                case '*':
+                    return add(mul(du, cp(node->right)), mul(cp(node->left), dv));
+                case '/':
+                    /* (u' - (u/v) * v') / v: only ever divides by v itself,
+                     * so it is undefined exactly where u/v is */
+                    return dvd(sub(du, mul(dvd(cp(node->left), cp(node->right)), dv)),
+                               cp(node->right));
+            }
+            freeAST(du);
+            freeAST(dv);
+            return NULL;
+        }
+
+        case NODE_FUNC:
+            return diffFunc(node, inline_depth);
+
+        case NODE_FUNC2: {
+            /* max/min(u, v)' = (u' + v')/2 +/- sign(u - v) * (u' - v')/2 */
+            int is_max = node->func == FN_MAX;
+            if (!is_max && node->func != FN_MIN) return NULL;
+            ASTNode *du = diff(node->left, inline_depth);
+            if (!du) return NULL;
+            ASTNode *dv = diff(node->right, inline_depth);
+            if (!dv) { freeAST(du); return NULL; }
+
+            ASTNode *mean = mul(num(0.5), add(cp(du), cp(dv)));
+            ASTNode *half = mul(mul(num(0.5), fn(FN_SIGN, sub(cp(node->left), cp(node->right)))),
+                                sub(du, dv));
+            return is_max ? add(mean, half) : sub(mean, half);
+        }
+
+        case NODE_FUNC3: {
+            /* fma(a, b, c)' = a' * b + a * b' + c' */
+            if (node->func != FN_FMA) return NULL;
+            ASTNode *da = diff(node->left, inline_depth);
+            if (!da) return NULL;
+            ASTNode *db = diff(node->right, inline_depth);
+            if (!db) { freeAST(da); return NULL; }
+            ASTNode *dc = diff(node->arg2, inline_depth);
+            if (!dc) { freeAST(da); freeAST(db); return NULL; }
+            return add(add(mul(da, cp(node->right)), mul(cp(node->left), db)), dc);
+        }
+
+        case NODE_DERIVATIVE: {
+            /* left over from a failed expansion: differentiate its body twice */
+            ASTNode *inner = diff(node->left, inline_depth);
+            if (!inner) return NULL;
+            ASTNode *outer = diff(inner, inline_depth);
+            freeAST(inner);
+            return outer;
+        }
+    }
+    return NULL;
+}
+
+ASTNode* differentiateAST(ASTNode *node) {
+    return diff(node, 0);
+}
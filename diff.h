@@ -0,0 +1,12 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include "ast.h"
+
+/* Returns a new tree for d/dx of node, or NULL when it cannot be built
+ * symbolically (undefined identifiers, recursive definitions).  User
+ * functions are inlined from the symbol table at the time of the call.
+ * node itself is left untouched. */
+ASTNode* differentiateAST(ASTNode *node);
+
+#endif /* DIFF_H */
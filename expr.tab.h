@@ -0,0 +1,134 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison interface for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_YY_EXPR_TAB_H_INCLUDED
+# define YY_YY_EXPR_TAB_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int yydebug;
+#endif
+/* "%code requires" blocks.  */
+#line 9 "expr.y"
+
+#include "parser.h"
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+#line 58 "expr.tab.h"
+
+/* Token kinds.  */
+#ifndef YYTOKENTYPE
+# define YYTOKENTYPE
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    NUMBER = 258,                  /* NUMBER  */
+    IDENTIFIER = 259,              /* IDENTIFIER  */
+    VAR = 260,                     /* VAR  */
+    SIN = 261,                     /* SIN  */
+    COS = 262,                     /* COS  */
+    TAN = 263,                     /* TAN  */
+    EXP = 264,                     /* EXP  */
+    LOG = 265,                     /* LOG  */
+    SQRT = 266,                    /* SQRT  */
+    ABS = 267,                     /* ABS  */
+    LN = 268,                      /* LN  */
+    ASIN = 269,                    /* ASIN  */
+    ACOS = 270,                    /* ACOS  */
+    ATAN = 271,                    /* ATAN  */
+    SINH = 272,                    /* SINH  */
+    COSH = 273,                    /* COSH  */
+    TANH = 274,                    /* TANH  */
+    MAX = 275,                     /* MAX  */
+    MIN = 276,                     /* MIN  */
+    CEIL = 277,                    /* CEIL  */
+    FLOOR = 278,                   /* FLOOR  */
+    DERIV = 279,                   /* DERIV  */
+    LET = 280,                     /* LET  */
+    DEF = 281,                     /* DEF  */
+    PLOT = 282,                    /* PLOT  */
+    AST_CMD = 283,                 /* AST_CMD  */
+    VARS = 284,                    /* VARS  */
+    FUNCS = 285,                   /* FUNCS  */
+    SHOW = 286,                    /* SHOW  */
+    QUIT = 287,                    /* QUIT  */
+    CLEAR = 288,                   /* CLEAR  */
+    LIST = 289,                    /* LIST  */
+    TAC = 290,                     /* TAC  */
+    EQ = 291,                      /* EQ  */
+    NEQ = 292,                     /* NEQ  */
+    LE = 293,                      /* LE  */
+    GE = 294,                      /* GE  */
+    UMINUS = 295                   /* UMINUS  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
+#endif
+
+/* Value type.  */
+#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
+union YYSTYPE
+{
+#line 34 "expr.y"
+
+    double   dval;
+    ASTNode *node;
+    char    *sval;
+
+#line 121 "expr.tab.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
+# define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
+#endif
+
+
+
+
+int yyparse (yyscan_t scanner, Statement *s);
+
+
+#endif /* !YY_YY_EXPR_TAB_H_INCLUDED  */
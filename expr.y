@@ -3,14 +3,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
-#include "symtab.h"
-#include "commands.h"
+%}
 
-ASTNode *root;
-int yylex(void);
-int yyerror(const char *s);
+%code requires {
+#include "parser.h"
 
-%}
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+}
+
+%code {
+/* the scanner's side (lex.yy.c) */
+typedef struct yy_buffer_state *YY_BUFFER_STATE;
+int  yylex(YYSTYPE *lval, yyscan_t scanner);
+int  yylex_init(yyscan_t *scanner);
+int  yylex_destroy(yyscan_t scanner);
+YY_BUFFER_STATE yy_scan_string(const char *text, yyscan_t scanner);
+
+static void yyerror(yyscan_t scanner, Statement *s, const char *msg);
+}
+
+/* No globals: the scanner and the statement being built are passed in */
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {Statement *s}
 
 %union {
     double   dval;
@@ -29,6 +47,8 @@ int yyerror(const char *s);
 %type <node> expr
 %type <sval> ident
 
+%destructor { free($$); } <sval>
+
 %left  EQ NEQ '<' '>' LE GE
 %left  '+' '-'
 %left  '*' '/'
@@ -37,69 +57,39 @@ int yyerror(const char *s);
 
 %%
 
-input:
-    /* empty */
-  | input line
-;
-
 line:
-    '\n'                    { /* empty line */ }
-  | statement '\n'          { return 0; }
-  | error '\n'              { 
-        yyerrok; 
-        error_occurred = 1;
-    }
+    statement
+  | statement '\n'
 ;
 
 statement:
-      VARS {
-          listVariables();
-      }
-    | FUNCS {
-          listFunctions();
-      }
+      %empty                { s->kind = STMT_NONE; }
+    | VARS                  { s->kind = STMT_VARS; }
+    | FUNCS                 { s->kind = STMT_FUNCS; }
     | SHOW ident {
-          showFunction($2);
-          free($2);
+          s->kind = STMT_SHOW;
+          s->name = $2;
       }
-    | LET ident '=' expr { 
-          double val = evaluate($4, 0);
-          storeVariable($2, val); 
-          printf("Variable '\033[1;33m%s\033[0m' = %.4f\n", $2, val);
-          freeAST($4);
-          free($2);
+    | LET ident '=' expr {
+          s->kind = STMT_LET;
+          s->name = $2;
+          s->node = $4;
       }
     | DEF ident '=' expr {
-          storeFunction($2, $4);
-          printf("Function '\033[1;33m%s\033[0m' defined\n", $2);
-          free($2);
+          s->kind = STMT_DEF;
+          s->name = $2;
+          s->node = $4;
       }
     | AST_CMD expr {
-          ASTNode *optimized = optimizeAST($2);
-          printf("\n\033[1;36m╔════════════════════════════════════════╗\033[0m\n");
-          printf("\033[1;36m║  Abstract Syntax Tree (optimized)      ║\033[0m\n");
-          printf("\033[1;36m╚════════════════════════════════════════╝\033[0m\n\n");
-          printASTPretty(optimized, "", 0);
-          printf("\n");
-          freeAST(optimized);
-      }
-    | expr { 
-          root = $1; 
+          s->kind = STMT_AST;
+          s->node = $2;
       }
-    | QUIT { exit(0); }
-    | TAC {
-          FILE *f = fopen("tac.txt", "r");
-          if (!f){
-            perror("Error opening file");
-          }
-          else{
-            int c;
-            while ((c = fgetc(f)) != EOF){
-              putchar(c);
-            }
-            fclose(f);
-          }
+    | expr {
+          s->kind = STMT_EXPR;
+          s->node = $1;
       }
+    | QUIT                  { s->kind = STMT_QUIT; }
+    | TAC                   { s->kind = STMT_TAC; }
 ;
 
 ident: IDENTIFIER { $$ = $1; }
@@ -116,30 +106,57 @@ expr:
     | NUMBER { $$ = createNumberNode($1); }
     | VAR { $$ = createVarNode(); }
     | IDENTIFIER { $$ = createIdentifierNode($1); free($1); }
-    | DERIV '(' expr ')'  { $$ = createDerivative("derivative", $3); }
-    | SIN '(' expr ')' { $$ = createFuncNode("sin", $3); }
-    | COS '(' expr ')' { $$ = createFuncNode("cos", $3); }
-    | TAN '(' expr ')' { $$ = createFuncNode("tan", $3); }
-    | EXP '(' expr ')' { $$ = createFuncNode("exp", $3); }
-    | LOG '(' expr ')' { $$ = createFuncNode("log", $3); }
-    | SQRT '(' expr ')' { $$ = createFuncNode("sqrt", $3); }
-    | ABS '(' expr ')' { $$ = createFuncNode("abs", $3); }
-    | LN '(' expr ')' { $$ = createFuncNode("ln", $3); }
-    | ASIN '(' expr ')' { $$ = createFuncNode("asin", $3); }
-    | ACOS '(' expr ')' { $$ = createFuncNode("acos", $3); }
-    | ATAN '(' expr ')' { $$ = createFuncNode("atan", $3); }
-    | SINH '(' expr ')' { $$ = createFuncNode("sinh", $3); }
-    | COSH '(' expr ')' { $$ = createFuncNode("cosh", $3); }
-    | TANH '(' expr ')' { $$ = createFuncNode("tanh", $3); }
-    | CEIL '(' expr ')'  { $$ = createFuncNode("ceil", $3); }  
-    | FLOOR '(' expr ')' { $$ = createFuncNode("floor", $3); } 
-    | MAX '(' expr ',' expr ')' { $$ = createFunc2Node("max", $3, $5); }
-    | MIN '(' expr ',' expr ')' { $$ = createFunc2Node("min", $3, $5); }
+    | DERIV '(' expr ')'  {
+          /* expanded by inlineAST(), against the definitions of the time */
+          $$ = createDerivative(FN_DERIVATIVE, $3);
+      }
+    | SIN '(' expr ')' { $$ = createFuncNode(FN_SIN, $3); }
+    | COS '(' expr ')' { $$ = createFuncNode(FN_COS, $3); }
+    | TAN '(' expr ')' { $$ = createFuncNode(FN_TAN, $3); }
+    | EXP '(' expr ')' { $$ = createFuncNode(FN_EXP, $3); }
+    | LOG '(' expr ')' { $$ = createFuncNode(FN_LOG, $3); }
+    | SQRT '(' expr ')' { $$ = createFuncNode(FN_SQRT, $3); }
+    | ABS '(' expr ')' { $$ = createFuncNode(FN_ABS, $3); }
+    | LN '(' expr ')' { $$ = createFuncNode(FN_LN, $3); }
+    | ASIN '(' expr ')' { $$ = createFuncNode(FN_ASIN, $3); }
+    | ACOS '(' expr ')' { $$ = createFuncNode(FN_ACOS, $3); }
+    | ATAN '(' expr ')' { $$ = createFuncNode(FN_ATAN, $3); }
+    | SINH '(' expr ')' { $$ = createFuncNode(FN_SINH, $3); }
+    | COSH '(' expr ')' { $$ = createFuncNode(FN_COSH, $3); }
+    | TANH '(' expr ')' { $$ = createFuncNode(FN_TANH, $3); }
+    | CEIL '(' expr ')'  { $$ = createFuncNode(FN_CEIL, $3); }  
+    | FLOOR '(' expr ')' { $$ = createFuncNode(FN_FLOOR, $3); } 
+    | MAX '(' expr ',' expr ')' { $$ = createFunc2Node(FN_MAX, $3, $5); }
+    | MIN '(' expr ',' expr ')' { $$ = createFunc2Node(FN_MIN, $3, $5); }
 ;
 
 %%
 
-int yyerror(const char *s) {
-    fprintf(stderr, "Error: %s\n", s);
-    return 0;
-}
\ No newline at end of file
+static void yyerror(yyscan_t scanner, Statement *s, const char *msg) {
+    (void)scanner;
+    snprintf(s->error, sizeof(s->error), "%s", msg);
+}
+
+int parseStatement(const char *text, Statement *s) {
+    yyscan_t scanner;
+    memset(s, 0, sizeof(*s));
+    if (yylex_init(&scanner) != 0) {
+        snprintf(s->error, sizeof(s->error), "out of memory");
+        return 0;
+    }
+    yy_scan_string(text, scanner);
+    int ok = yyparse(scanner, s) == 0;
+    yylex_destroy(scanner);     /* frees the buffer too */
+    if (!ok) {
+        free(s->name);          /* a statement may be reduced before the error */
+        s->name = NULL;
+        s->node = NULL;
+        s->kind = STMT_NONE;
+    }
+    return ok;
+}
+
+void freeStatement(Statement *s) {
+    free(s->name);
+    s->name = NULL;
+}
@@ -0,0 +1,99 @@
+#include "inliner.h"
+#include "symtab.h"
+#include "diff.h"
+
+/* Inlining is decided per function, not per call site: a function is
+ * either substituted everywhere in the expression or kept as a call
+ * everywhere, so the linker never binds a body that was also inlined.
+ * Recursive functions are always kept.  While the fully expanded tree is
+ * over budget, the kept set grows by the function with the largest
+ * expansion. */
+typedef struct {
+    int    *kept;
+    int    *on_path;
+    double *size;               /* expanded size this pass, < 0 if unknown */
+    int     n_kept;
+} Inliner;
+
+static int calleeIndex(int name) {
+    if (lookupVariableId(name)) return -1;  /* variables shadow functions */
+    return functionIndexId(name);
+}
+
+/* Node count of node after inlining everything not kept (double: chains
+ * of defs grow exponentially). */
+static double expandedSize(Inliner *in, ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == NODE_IDENTIFIER) {
+        int f = calleeIndex(node->name);
+        if (f < 0 || in->kept[f]) return 1;
+        if (in->on_path[f]) {               /* recursive: never inline */
+            in->kept[f] = 1;
+            in->n_kept++;
+            return 1;
+        }
+        if (in->size[f] < 0) {
+            in->on_path[f] = 1;
+            in->size[f] = expandedSize(in, functions[f].ast);
+            in->on_path[f] = 0;
+        }
+        return in->size[f];
+    }
+    return 1 + expandedSize(in, node->left) + expandedSize(in, node->right) +
+           expandedSize(in, node->arg2);
+}
+
+/* d() is expanded here, not when it is parsed, so a stored def follows
+ * the functions it differentiates.  It stays a finite difference when the
+ * body cannot be differentiated (e.g. undefined names). */
+static ASTNode* expandDerivative(ASTNode *node) {
+    ASTNode *d = differentiateAST(node->left);
+    if (!d) return node;
+    freeAST(node);
+    return optimizeAST(d);
+}
+
+static ASTNode* inlineNode(Inliner *in, ASTNode *node) {
+    if (!node) return NULL;
+    if (node->type == NODE_IDENTIFIER) {
+        int f = calleeIndex(node->name);
+        if (f < 0 || in->kept[f]) return node;
+        freeAST(node);
+        return inlineNode(in, copyAST(functions[f].ast));
+    }
+    node->left = inlineNode(in, node->left);
+    node->right = inlineNode(in, node->right);
+    node->arg2 = inlineNode(in, node->arg2);
+    if (node->type == NODE_DERIVATIVE) return expandDerivative(node);
+    return node;
+}
+
+ASTNode* inlineAST(ASTNode *node) {
+    Inliner in;
+    in.kept = calloc(func_count + 1, sizeof(int));
+    in.on_path = calloc(func_count + 1, sizeof(int));
+    in.size = calloc(func_count + 1, sizeof(double));
+    in.n_kept = 0;
+
+    for (;;) {
+        for (int i = 0; i < func_count; i++) in.size[i] = -1;
+        int kept_before = in.n_kept;
+        double total = expandedSize(&in, node);
+        if (in.n_kept != kept_before) continue;     /* found recursion: recount */
+        if (total <= MAX_INLINE_NODES) break;
+
+        int largest = -1;
+        for (int i = 0; i < func_count; i++)
+            if (!in.kept[i] && in.size[i] >= 0 &&
+                (largest < 0 || in.size[i] > in.size[largest]))
+                largest = i;
+        if (largest < 0) break;                     /* over budget without calls */
+        in.kept[largest] = 1;
+        in.n_kept++;
+    }
+    node = inlineNode(&in, node);
+    free(in.kept);
+    free(in.on_path);
+    free(in.size);
+    return node;
+}
@@ -0,0 +1,17 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "ast.h"
+
+/* Substitutes the current body of every user function called in node, so
+ * optimizeAST()/simplifyAST() can fold and simplify across definitions,
+ * and expands d() symbolically on the result.
+ * Recursive functions, and functions whose expansion would push the tree
+ * past MAX_INLINE_NODES, stay as calls for linkAST() to bind.  Takes
+ * ownership of node and returns the new tree. */
+ASTNode* inlineAST(ASTNode *node);
+
+/* Node budget for one inlined expression. */
+#define MAX_INLINE_NODES 4096
+
+#endif /* INLINER_H */
@@ -0,0 +1,344 @@
+#include "interval.h"
+
+/* evaluate() gives NaN for a denominator closer to 0 than this */
+#define DIV_EPS 1e-10
+
+static const Interval EMPTY = { NAN, NAN, IV_EMPTY };
+
+static Interval make(double lo, double hi, IntervalDef def) {
+    Interval v = { lo, hi, def };
+    return v;
+}
+
+static Interval unbounded(IntervalDef def) {
+    return make(-INFINITY, INFINITY, def);
+}
+
+static IntervalDef worse(IntervalDef a, IntervalDef b) {
+    return a > b ? a : b;
+}
+
+static IntervalDef partly(IntervalDef def) {
+    return worse(def, IV_PARTIAL);
+}
+
+static int containsZero(Interval v) {
+    return v.lo <= 0 && v.hi >= 0;
+}
+
+/* libm does not promise that its results are monotone to the last bit,
+ * so bounds that come from it are moved out by one ulp.  +, -, *, / and
+ * sqrt round correctly, and rounding is monotone, so bounds computed from
+ * the end points with them already hold. */
+static Interval widen(Interval v) {
+    if (isfinite(v.lo)) v.lo = nextafter(v.lo, -INFINITY);
+    if (isfinite(v.hi)) v.hi = nextafter(v.hi, INFINITY);
+    return v;
+}
+
+static Interval clamp(Interval v, double lo, double hi) {
+    v.lo = fmax(v.lo, lo);
+    v.hi = fmin(v.hi, hi);
+    return v;
+}
+
+/* The hull of four candidate bounds; a NaN among them (0 * inf, inf / inf)
+ * means some points may be NaN and the values are not bounded. */
+static Interval hull4(double a, double b, double c, double d, IntervalDef def) {
+    if (isnan(a) || isnan(b) || isnan(c) || isnan(d)) return unbounded(partly(def));
+    return make(fmin(fmin(a, b), fmin(c, d)), fmax(fmax(a, b), fmax(c, d)), def);
+}
+
+/* ---------- arithmetic ---------------------------------------------------- */
+
+static Interval add(Interval a, Interval b) {
+    IntervalDef def = worse(a.def, b.def);
+    if (def == IV_EMPTY) return EMPTY;
+    // inf + -inf is NaN
+    if ((a.hi == INFINITY && b.lo == -INFINITY) || (a.lo == -INFINITY && b.hi == INFINITY))
+        def = partly(def);
+    double lo = a.lo + b.lo, hi = a.hi + b.hi;
+    return make(isnan(lo) ? -INFINITY : lo, isnan(hi) ? INFINITY : hi, def);
+}
+
+static Interval neg(Interval a) {
+    return a.def == IV_EMPTY ? EMPTY : make(-a.hi, -a.lo, a.def);
+}
+
+static Interval mul(Interval a, Interval b) {
+    IntervalDef def = worse(a.def, b.def);
+    if (def == IV_EMPTY) return EMPTY;
+    return hull4(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi, def);
+}
+
+/* x*x of one node: both factors are the same value, so never negative */
+static Interval square(Interval a) {
+    if (a.def == IV_EMPTY) return EMPTY;
+    double l = a.lo * a.lo, h = a.hi * a.hi;
+    if (containsZero(a)) return make(0, fmax(l, h), a.def);
+    return make(fmin(l, h), fmax(l, h), a.def);
+}
+
+static Interval divide(Interval a, Interval b) {
+    IntervalDef def = worse(a.def, b.def);
+    if (def == IV_EMPTY) return EMPTY;
+    int below = b.lo <= -DIV_EPS, above = b.hi >= DIV_EPS;
+    if (!below && !above) return EMPTY;
+    // A denominator that gets near 0 is a pole: the quotient grows up to
+    // |a| / DIV_EPS before it turns NaN
+    if (b.lo < DIV_EPS && b.hi > -DIV_EPS) return unbounded(partly(def));
+    return hull4(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi, def);
+}
+
+static Interval power(Interval a, Interval b) {
+    // pow(NaN, 0) and pow(1, NaN) are 1, so a NaN operand does not always
+    // make the result NaN
+    if (a.def == IV_EMPTY || b.def == IV_EMPTY) {
+        if (a.def == IV_EMPTY && (b.def == IV_EMPTY || !containsZero(b))) return EMPTY;
+        if (b.def == IV_EMPTY && !(a.lo <= 1 && a.hi >= 1)) return EMPTY;
+        return make(1, 1, IV_PARTIAL);
+    }
+    IntervalDef def = worse(a.def, b.def);
+    Interval r;
+    if (b.lo == b.hi && isfinite(b.lo)) {
+        double e = b.lo;
+        if (e == 0) return make(1, 1, IV_DEFINED);
+        if (e == floor(e)) {
+            // Integer powers are monotone on either side of 0
+            if (e < 0 && containsZero(a)) return unbounded(def);
+            double p = pow(a.lo, e), q = pow(a.hi, e);
+            if (e > 0 && fmod(e, 2) == 0 && containsZero(a)) {
+                r = make(0, fmax(p, q), def);
+            } else {
+                r = make(fmin(p, q), fmax(p, q), def);
+            }
+        } else {
+            // Other powers of negative numbers are NaN
+            if (a.hi < 0) return EMPTY;
+            if (a.lo < 0) def = partly(def);
+            double lo = fmax(a.lo, 0);
+            if (e > 0) {
+                r = make(pow(lo, e), pow(a.hi, e), def);
+            } else {
+                r = make(pow(a.hi, e), lo == 0 ? INFINITY : pow(lo, e), def);
+            }
+        }
+    } else if (a.lo > 0 || (a.lo >= 0 && b.lo > 0)) {
+        // x^y = e^(y ln x) is bilinear in (y, ln x): extremes at the corners
+        r = hull4(pow(a.lo, b.lo), pow(a.lo, b.hi), pow(a.hi, b.lo), pow(a.hi, b.hi), def);
+    } else {
+        return unbounded(a.lo < 0 ? partly(def) : def);
+    }
+    // A NaN operand may still have been raised to 0 or been 1
+    if ((a.def != IV_DEFINED && containsZero(b)) || (b.def != IV_DEFINED && a.lo <= 1 && a.hi >= 1)) {
+        r.lo = fmin(r.lo, 1);
+        r.hi = fmax(r.hi, 1);
+    }
+    return widen(r);
+}
+
+/* ---------- builtins ------------------------------------------------------ */
+
+/* Whether [lo, hi] holds phase + k*period for some integer k; errs towards
+ * yes, which only loosens the bounds. */
+static int containsPhase(double lo, double hi, double phase, double period) {
+    double k = ceil((lo - phase) / period - 1e-9);
+    return phase + k * period <= hi + 1e-9 * (1 + fabs(hi));
+}
+
+/* sin or cos: the value at the ends, or +-1 where a peak lies inside */
+static Interval periodic(Interval a, double (*f)(double), double peak) {
+    IntervalDef def = a.def;
+    if (!isfinite(a.lo) || !isfinite(a.hi)) return make(-1, 1, partly(def));
+    if (a.hi - a.lo >= 2 * M_PI || fmax(fabs(a.lo), fabs(a.hi)) > 1e12) return make(-1, 1, def);
+    double p = f(a.lo), q = f(a.hi);
+    Interval r = make(fmin(p, q), fmax(p, q), def);
+    if (containsPhase(a.lo, a.hi, peak, 2 * M_PI)) r.hi = 1;
+    if (containsPhase(a.lo, a.hi, peak + M_PI, 2 * M_PI)) r.lo = -1;
+    return clamp(widen(r), -1, 1);
+}
+
+static Interval increasing(Interval a, double (*f)(double)) {
+    return widen(make(f(a.lo), f(a.hi), a.def));
+}
+
+static Interval func1(BuiltinFunc func, Interval a) {
+    if (a.def == IV_EMPTY) return EMPTY;
+    switch (func) {
+        case FN_SIN: return periodic(a, sin, M_PI / 2);
+        case FN_COS: return periodic(a, cos, 0);
+        case FN_TAN:
+            if (!isfinite(a.lo) || !isfinite(a.hi)) return unbounded(partly(a.def));
+            if (a.hi - a.lo >= M_PI || fmax(fabs(a.lo), fabs(a.hi)) > 1e12 ||
+                containsPhase(a.lo, a.hi, M_PI / 2, M_PI))
+                return unbounded(a.def);
+            return increasing(a, tan);
+        case FN_EXP:
+            return clamp(increasing(a, exp), 0, INFINITY);
+        case FN_LOG:
+        case FN_LN: {
+            double (*f)(double) = func == FN_LOG ? log10 : log;
+            if (a.hi <= 0) return EMPTY;
+            if (a.lo > 0) return increasing(a, f);
+            return widen(make(-INFINITY, f(a.hi), partly(a.def)));
+        }
+        case FN_SQRT:
+            if (a.hi < 0) return EMPTY;
+            if (a.lo >= 0) return make(sqrt(a.lo), sqrt(a.hi), a.def);
+            return make(0, sqrt(a.hi), partly(a.def));
+        case FN_ABS:
+            if (containsZero(a)) return make(0, fmax(-a.lo, a.hi), a.def);
+            return a.hi < 0 ? make(-a.hi, -a.lo, a.def) : a;
+        case FN_ASIN:
+        case FN_ACOS: {
+            if (a.lo > 1 || a.hi < -1) return EMPTY;
+            IntervalDef def = (a.lo < -1 || a.hi > 1) ? partly(a.def) : a.def;
+            double lo = fmax(a.lo, -1), hi = fmin(a.hi, 1);
+            if (func == FN_ASIN) return widen(make(asin(lo), asin(hi), def));
+            return widen(make(acos(hi), acos(lo), def));
+        }
+        case FN_ATAN: return increasing(a, atan);
+        case FN_SINH: return increasing(a, sinh);
+        case FN_TANH: return clamp(increasing(a, tanh), -1, 1);
+        case FN_COSH: {
+            double p = cosh(a.lo), q = cosh(a.hi);
+            Interval r = containsZero(a) ? make(1, fmax(p, q), a.def)
+                                         : make(fmin(p, q), fmax(p, q), a.def);
+            return clamp(widen(r), 1, INFINITY);
+        }
+        case FN_CEIL:  return make(ceil(a.lo), ceil(a.hi), a.def);
+        case FN_FLOOR: return make(floor(a.lo), floor(a.hi), a.def);
+        case FN_SIGN:
+            return make(a.lo > 0 ? 1 : a.lo < 0 ? -1 : a.lo,
+                        a.hi > 0 ? 1 : a.hi < 0 ? -1 : a.hi, a.def);
+        default:
+            return unbounded(IV_PARTIAL);
+    }
+}
+
+/* max(a, b) is (a > b) ? a : b: NaN in b comes through, NaN in a gives b.
+ * min(a, b) likewise. */
+static Interval func2(BuiltinFunc func, Interval a, Interval b) {
+    if (b.def == IV_EMPTY || a.def == IV_EMPTY) return b.def == IV_EMPTY ? EMPTY : b;
+    if (func == FN_MAX) {
+        Interval r = make(fmax(a.lo, b.lo), fmax(a.hi, b.hi), b.def);
+        if (a.def != IV_DEFINED) r.lo = b.lo;
+        return r;
+    }
+    if (func == FN_MIN) {
+        Interval r = make(fmin(a.lo, b.lo), fmin(a.hi, b.hi), b.def);
+        if (a.def != IV_DEFINED) r.hi = b.hi;
+        return r;
+    }
+    return unbounded(IV_PARTIAL);
+}
+
+/* ---------- evaluation ---------------------------------------------------- */
+
+/* Shared nodes are bounded once per call, as in evaluate() */
+typedef struct {
+    Interval           value[EVAL_MEMO_SLOTS];
+    unsigned long long valid;
+} IntervalMemo;
+
+static Interval evalMemo(const ASTNode *node, double x_lo, double x_hi, IntervalMemo *memo);
+
+static Interval evalNode(const ASTNode *node, double x_lo, double x_hi, IntervalMemo *memo) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return isnan(node->value) ? EMPTY : make(node->value, node->value, IV_DEFINED);
+
+        case NODE_VAR:
+            return make(x_lo, x_hi, IV_DEFINED);
+
+        case NODE_OP: {
+            Interval a = evalMemo(node->left, x_lo, x_hi, memo);
+            if (node->op == '~') return neg(a);
+            if (node->op == '*' && node->left == node->right) return square(a);
+            Interval b = evalMemo(node->right, x_lo, x_hi, memo);
+            switch (node->op) {
+                case '+': return add(a, b);
+                case '-': return add(a, neg(b));
+                case '*': return mul(a, b);
+                case '/': return divide(a, b);
+                case '^': return power(a, b);
+            }
+            break;
+        }
+
+        case NODE_FUNC:
+            return func1((BuiltinFunc)node->func, evalMemo(node->left, x_lo, x_hi, memo));
+
+        case NODE_FUNC2:
+            return func2((BuiltinFunc)node->func, evalMemo(node->left, x_lo, x_hi, memo),
+                         evalMemo(node->right, x_lo, x_hi, memo));
+
+        case NODE_FUNC3: {
+            if (node->func != FN_FMA) break;
+            // One rounding in fma: widen the product before the sum
+            Interval p = mul(evalMemo(node->left, x_lo, x_hi, memo),
+                             evalMemo(node->right, x_lo, x_hi, memo));
+            return add(widen(p), evalMemo(node->arg2, x_lo, x_hi, memo));
+        }
+
+        case NODE_DERIVATIVE: {
+            // Defined where both differences are; a bound on the quotient
+            // from intervals would be far too wide to be of use
+            double h = 1e-5;
+            Interval up = evaluateInterval(node->left, x_lo + h, x_hi + h);
+            Interval down = evaluateInterval(node->left, x_lo - h, x_hi - h);
+            Interval diff = add(up, neg(down));
+            return diff.def == IV_EMPTY ? EMPTY : unbounded(diff.def);
+        }
+
+        default:
+            break;
+    }
+    // Names are bound by the linker; an unlinked tree is not bounded
+    return unbounded(IV_PARTIAL);
+}
+
+static Interval evalMemo(const ASTNode *node, double x_lo, double x_hi, IntervalMemo *memo) {
+    if (!node) return make(0, 0, IV_DEFINED);
+    int slot = node->memo;
+    if (slot >= 0 && slot < EVAL_MEMO_SLOTS) {
+        unsigned long long bit = 1ULL << slot;
+        if (!(memo->valid & bit)) {
+            memo->value[slot] = evalNode(node, x_lo, x_hi, memo);
+            memo->valid |= bit;
+        }
+        return memo->value[slot];
+    }
+    return evalNode(node, x_lo, x_hi, memo);
+}
+
+Interval evaluateInterval(const ASTNode *node, double x_lo, double x_hi) {
+    IntervalMemo memo;
+    memo.valid = 0;
+    return evalMemo(node, x_lo, x_hi, &memo);
+}
+
+/* ---------- y-limits ------------------------------------------------------ */
+
+int intervalYLimits(ASTNode *const *nodes, int n, double x_min, double x_max,
+                    double *y_min, double *y_max) {
+    if (!(x_max > x_min)) return 0;
+    double lo = INFINITY, hi = -INFINITY;
+    double width = (x_max - x_min) / INTERVAL_PIECES;
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < INTERVAL_PIECES; k++) {
+            double a = x_min + k * width;
+            double b = k + 1 == INTERVAL_PIECES ? x_max : x_min + (k + 1) * width;
+            Interval v = evaluateInterval(nodes[i], a, b);
+            if (v.def == IV_EMPTY || !isfinite(v.lo) || !isfinite(v.hi)) continue;
+            lo = fmin(lo, v.lo);
+            hi = fmax(hi, v.hi);
+        }
+    }
+    if (!(lo <= hi)) return 0;
+    double margin = 0.05 * (hi - lo);
+    if (!(margin > 0)) margin = lo != 0 ? 0.1 * fabs(lo) : 1;
+    *y_min = lo - margin;
+    *y_max = hi + margin;
+    return isfinite(*y_min) && isfinite(*y_max);
+}
@@ -0,0 +1,36 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include "ast.h"
+
+/* Interval evaluation: bounds the values an expression takes for every x
+ * in [x_lo, x_hi] at once, with the same rules as evaluate(), including
+ * where it gives NaN (log and sqrt of negatives, asin/acos outside
+ * [-1, 1], division by |d| < 1e-10).  The bounds hold for every backend,
+ * as they all compute the same values; they may be wider than the exact
+ * range, never narrower. */
+
+typedef enum {
+    IV_DEFINED,     /* no x in the range gives NaN                     */
+    IV_PARTIAL,     /* some may                                        */
+    IV_EMPTY        /* every x gives NaN: nothing there to sample       */
+} IntervalDef;
+
+typedef struct {
+    double      lo, hi;     /* bounds of the values that are not NaN; a
+                               pole makes them infinite */
+    IntervalDef def;
+} Interval;
+
+Interval evaluateInterval(const ASTNode *node, double x_lo, double x_hi);
+
+/* Pieces [x_min, x_max] is cut into for y-limits; pieces around a pole
+ * are left out. */
+#define INTERVAL_PIECES 256
+
+/* y-limits for plotting n (linked) expressions over [x_min, x_max], with a
+ * small margin.  Returns 0 if no piece of any curve has finite bounds. */
+int intervalYLimits(ASTNode *const *nodes, int n, double x_min, double x_max,
+                    double *y_min, double *y_max);
+
+#endif /* INTERVAL_H */
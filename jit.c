@@ -0,0 +1,413 @@
+#include "jit.h"
+#include "symtab.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(NO_JIT)
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+/* Nesting limit for inlined user functions; also catches def f = f + 1. */
+#define MAX_INLINE_DEPTH 64
+
+/* Frame layout (rbp-relative):
+ *   [rbp -  8]          the argument x
+ *   [rbp - 16 - 8*k]    spill slot k for pending left operands
+ *   above the spills    one slot per shared DAG node (memo id)
+ * Every libm call clobbers all xmm registers, so the left operand of a
+ * binary node is spilled whenever the right side is not a leaf. */
+#define X_DISP (-8)
+#define SLOT_DISP(k) (-16 - 8 * (k))
+
+typedef struct {
+    unsigned char *buf;
+    size_t len, cap;
+    int max_slot;       /* highest spill slot used, -1 if none */
+    int shared_base;    /* first slot of the shared-node area */
+    int max_shared;     /* highest memo id stored, -1 if none */
+    unsigned long long stored;  /* memo ids already computed */
+} Emitter;
+
+static void emitBytes(Emitter *e, const void *bytes, size_t n) {
+    if (e->len + n > e->cap) {
+        e->cap = e->cap ? e->cap * 2 : 256;
+        while (e->cap < e->len + n) e->cap *= 2;
+        e->buf = realloc(e->buf, e->cap);
+    }
+    memcpy(e->buf + e->len, bytes, n);
+    e->len += n;
+}
+
+#define EMIT(e, ...) do {                                   \
+        const unsigned char b_[] = { __VA_ARGS__ };        \
+        emitBytes(e, b_, sizeof(b_));                       \
+    } while (0)
+
+static void emitImm32(Emitter *e, int32_t v) { emitBytes(e, &v, 4); }
+
+/* ---------- instruction encoders ------------------------------------------ */
+/* xmm register numbers 0..3 are encoded directly in the ModRM byte. */
+
+static void movsdLoad(Emitter *e, int xmm, int disp) {      /* movsd xmmN, [rbp+disp] */
+    EMIT(e, 0xF2, 0x0F, 0x10, 0x85 | (xmm << 3));
+    emitImm32(e, disp);
+}
+
+static void movsdStore(Emitter *e, int disp, int xmm) {     /* movsd [rbp+disp], xmmN */
+    EMIT(e, 0xF2, 0x0F, 0x11, 0x85 | (xmm << 3));
+    emitImm32(e, disp);
+}
+
+static void loadConst(Emitter *e, int xmm, double value) {  /* mov rax, imm64; movq xmmN, rax */
+    EMIT(e, 0x48, 0xB8);
+    emitBytes(e, &value, 8);
+    EMIT(e, 0x66, 0x48, 0x0F, 0x6E, 0xC0 | (xmm << 3));
+}
+
+static void loadBits(Emitter *e, int xmm, uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, 8);
+    loadConst(e, xmm, value);
+}
+
+/* Scalar/packed SSE2 op `dst op= src` on registers; prefix 0xF2 for *sd,
+ * 0x66 for *pd. */
+static void sseOp(Emitter *e, unsigned char prefix, unsigned char opcode, int dst, int src) {
+    EMIT(e, prefix, 0x0F, opcode, 0xC0 | (dst << 3) | src);
+}
+
+#define ADDSD  0x58
+#define MULSD  0x59
+#define SUBSD  0x5C
+#define MINSD  0x5D
+#define DIVSD  0x5E
+#define MAXSD  0x5F
+#define SQRTSD 0x51
+#define MOVAPD 0x28
+#define ANDPD  0x54
+#define ANDNPD 0x55
+#define ORPD   0x56
+#define XORPD  0x57
+
+static void callAbs(Emitter *e, void *target) {             /* mov rax, imm64; call rax */
+    uint64_t addr = (uint64_t)(uintptr_t)target;
+    EMIT(e, 0x48, 0xB8);
+    emitBytes(e, &addr, 8);
+    EMIT(e, 0xFF, 0xD0);
+}
+
+static void roundsd(Emitter *e, int mode) {                 /* roundsd xmm0, xmm0, mode */
+    EMIT(e, 0x66, 0x0F, 0x3A, 0x0B, 0xC0, (unsigned char)mode);
+}
+
+/* ---------- helpers with the evaluator's domain rules --------------------- */
+
+static double jit_log10(double v) { return (v > 0) ? log10(v) : NAN; }
+static double jit_ln(double v)    { return (v > 0) ? log(v) : NAN; }
+static double jit_sign(double v)  { return (v > 0) ? 1 : (v < 0) ? -1 : v; }
+
+static double (*const libm_funcs[FN_COUNT])(double) = {
+    [FN_SIN] = sin, [FN_COS] = cos, [FN_TAN] = tan, [FN_EXP] = exp,
+    [FN_LOG] = jit_log10, [FN_LN] = jit_ln,
+    [FN_ASIN] = asin, [FN_ACOS] = acos, [FN_ATAN] = atan,
+    [FN_SINH] = sinh, [FN_COSH] = cosh, [FN_TANH] = tanh,
+    [FN_CEIL] = ceil, [FN_FLOOR] = floor, [FN_SIGN] = jit_sign,
+};
+
+/* Batch mode compiles on several threads at once; they all store the
+ * same answer. */
+static int have_sse41(void) {
+    static int cached = -1;
+    int have = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (have < 0) {
+        __builtin_cpu_init();
+        have = __builtin_cpu_supports("sse4.1") != 0;
+        __atomic_store_n(&cached, have, __ATOMIC_RELAXED);
+    }
+    return have;
+}
+
+static int have_fma(void) {
+    static int cached = -1;
+    int have = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (have < 0) {
+        __builtin_cpu_init();
+        have = __builtin_cpu_supports("fma") != 0;
+        __atomic_store_n(&cached, have, __ATOMIC_RELAXED);
+    }
+    return have;
+}
+
+/* ---------- code generation ----------------------------------------------- */
+
+/* Loads a leaf directly into xmmN; returns 0 if node is not a leaf. */
+static int genLeaf(Emitter *e, ASTNode *node, int xmm, int x_disp) {
+    if (!node) {
+        loadConst(e, xmm, 0);
+        return 1;
+    }
+    if (node->type == NODE_NUMBER) {
+        loadConst(e, xmm, node->value);
+        return 1;
+    }
+    if (node->type == NODE_VAR) {
+        movsdLoad(e, xmm, x_disp);
+        return 1;
+    }
+    if (node->type == NODE_IDENTIFIER) {
+        double *val = lookupVariableId(node->name);
+        if (val) {
+            loadConst(e, xmm, *val);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int isLeaf(ASTNode *node) {
+    return !node || node->type == NODE_NUMBER || node->type == NODE_VAR ||
+           (node->type == NODE_IDENTIFIER && lookupVariableId(node->name));
+}
+
+static void useSlot(Emitter *e, int slot) {
+    if (slot > e->max_slot) e->max_slot = slot;
+}
+
+static int gen(Emitter *e, ASTNode *node, int slot, int x_disp, int inline_depth);
+
+/* Leaves the value of node in xmm0.  `slot` is the first free spill slot
+ * and `x_disp` where the current x lives (it moves inside d(...)). */
+static int genValue(Emitter *e, ASTNode *node, int slot, int x_disp, int inline_depth) {
+    if (genLeaf(e, node, 0, x_disp)) return 1;
+
+    switch (node->type) {
+        case NODE_IDENTIFIER: {
+            ASTNode *func = lookupFunctionId(node->name);
+            if (!func || inline_depth >= MAX_INLINE_DEPTH) return 0;
+            return gen(e, func, slot, x_disp, inline_depth + 1);
+        }
+
+        case NODE_OP:
+        case NODE_FUNC2: {
+            if (node->type == NODE_OP && node->op == '~') {
+                if (!gen(e, node->left, slot, x_disp, inline_depth)) return 0;
+                loadBits(e, 1, 0x8000000000000000ULL);
+                sseOp(e, 0x66, XORPD, 0, 1);
+                return 1;
+            }
+
+            if (!gen(e, node->left, slot, x_disp, inline_depth)) return 0;
+            if (!genLeaf(e, node->right, 1, x_disp)) {
+                useSlot(e, slot);
+                movsdStore(e, SLOT_DISP(slot), 0);
+                if (!gen(e, node->right, slot + 1, x_disp, inline_depth)) return 0;
+                sseOp(e, 0x66, MOVAPD, 1, 0);
+                movsdLoad(e, 0, SLOT_DISP(slot));
+            }
+
+            if (node->type == NODE_FUNC2) {
+                if (node->func == FN_MAX) sseOp(e, 0xF2, MAXSD, 0, 1);
+                else if (node->func == FN_MIN) sseOp(e, 0xF2, MINSD, 0, 1);
+                else return 0;
+                return 1;
+            }
+
+            switch (node->op) {
+                case '+': sseOp(e, 0xF2, ADDSD, 0, 1); break;
+                case '-': sseOp(e, 0xF2, SUBSD, 0, 1); break;
+                case '*': sseOp(e, 0xF2, MULSD, 0, 1); break;
+                case '/':
+                    /* xmm2 = (|b| < 1e-10) mask; result = mask ? NaN : a / b */
+                    sseOp(e, 0x66, MOVAPD, 2, 1);
+                    loadBits(e, 3, 0x7FFFFFFFFFFFFFFFULL);
+                    sseOp(e, 0x66, ANDPD, 2, 3);
+                    loadConst(e, 3, 1e-10);
+                    EMIT(e, 0xF2, 0x0F, 0xC2, 0xD3, 0x01);      /* cmpltsd xmm2, xmm3 */
+                    sseOp(e, 0xF2, DIVSD, 0, 1);
+                    sseOp(e, 0x66, MOVAPD, 3, 2);
+                    sseOp(e, 0x66, ANDNPD, 2, 0);
+                    loadConst(e, 0, NAN);
+                    sseOp(e, 0x66, ANDPD, 0, 3);
+                    sseOp(e, 0x66, ORPD, 0, 2);
+                    break;
+                case '^': callAbs(e, (void *)pow); break;
+                default:  return 0;
+            }
+            return 1;
+        }
+
+        case NODE_FUNC: {
+            if (!gen(e, node->left, slot, x_disp, inline_depth)) return 0;
+            if (node->func == FN_SQRT) {
+                /* sqrtsd yields NaN for negative input, as evaluate() does */
+                sseOp(e, 0xF2, SQRTSD, 0, 0);
+                return 1;
+            }
+            if (node->func == FN_ABS) {
+                loadBits(e, 1, 0x7FFFFFFFFFFFFFFFULL);
+                sseOp(e, 0x66, ANDPD, 0, 1);
+                return 1;
+            }
+            if (have_sse41() && node->func == FN_CEIL) {
+                roundsd(e, 0x0A);
+                return 1;
+            }
+            if (have_sse41() && node->func == FN_FLOOR) {
+                roundsd(e, 0x09);
+                return 1;
+            }
+            if (node->func < FN_COUNT && libm_funcs[node->func]) {
+                callAbs(e, (void *)libm_funcs[node->func]);
+                return 1;
+            }
+            return 0;
+        }
+
+        case NODE_FUNC3: {
+            /* fma(a, b, c) with a, b, c in xmm0..2, the libm argument order */
+            if (node->func != FN_FMA) return 0;
+            if (!gen(e, node->left, slot, x_disp, inline_depth)) return 0;
+            if (isLeaf(node->right) && isLeaf(node->arg2)) {
+                genLeaf(e, node->right, 1, x_disp);
+                genLeaf(e, node->arg2, 2, x_disp);
+            } else {
+                useSlot(e, slot + 1);
+                movsdStore(e, SLOT_DISP(slot), 0);
+                if (!gen(e, node->right, slot + 1, x_disp, inline_depth)) return 0;
+                movsdStore(e, SLOT_DISP(slot + 1), 0);
+                if (!gen(e, node->arg2, slot + 2, x_disp, inline_depth)) return 0;
+                sseOp(e, 0x66, MOVAPD, 2, 0);
+                movsdLoad(e, 1, SLOT_DISP(slot + 1));
+                movsdLoad(e, 0, SLOT_DISP(slot));
+            }
+            if (have_fma())
+                EMIT(e, 0xC4, 0xE2, 0xF1, 0xA9, 0xC2);  /* vfmadd213sd xmm0, xmm1, xmm2 */
+            else
+                callAbs(e, (void *)fma);
+            return 1;
+        }
+
+        case NODE_DERIVATIVE: {
+            /* (f(x+h) - f(x-h)) / (2h) with x relocated into spill slots */
+            double h = 1e-5;
+            int xp = slot, xm = slot + 1, fp = slot + 2;
+            useSlot(e, fp);
+            movsdLoad(e, 0, x_disp);
+            loadConst(e, 1, h);
+            sseOp(e, 0xF2, ADDSD, 0, 1);
+            movsdStore(e, SLOT_DISP(xp), 0);
+            movsdLoad(e, 0, x_disp);
+            sseOp(e, 0xF2, SUBSD, 0, 1);
+            movsdStore(e, SLOT_DISP(xm), 0);
+
+            if (!gen(e, node->left, slot + 3, SLOT_DISP(xp), inline_depth)) return 0;
+            movsdStore(e, SLOT_DISP(fp), 0);
+            if (!gen(e, node->left, slot + 3, SLOT_DISP(xm), inline_depth)) return 0;
+            sseOp(e, 0x66, MOVAPD, 1, 0);
+            movsdLoad(e, 0, SLOT_DISP(fp));
+            sseOp(e, 0xF2, SUBSD, 0, 1);
+            loadConst(e, 1, 2*h);
+            sseOp(e, 0xF2, DIVSD, 0, 1);
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+/* Shared DAG nodes are computed once and kept in their frame slot.  Only
+ * the top-level DAG at the real x shares: inlined bodies and d() bodies
+ * evaluated at x +/- h recompute. */
+static int gen(Emitter *e, ASTNode *node, int slot, int x_disp, int inline_depth) {
+    int memo = (node && inline_depth == 0 && x_disp == X_DISP) ? node->memo : -1;
+    if (memo < 0 || memo >= EVAL_MEMO_SLOTS)
+        return genValue(e, node, slot, x_disp, inline_depth);
+
+    unsigned long long bit = 1ULL << memo;
+    int disp = SLOT_DISP(e->shared_base + memo);
+    if (e->stored & bit) {
+        movsdLoad(e, 0, disp);
+        return 1;
+    }
+    if (!genValue(e, node, slot, x_disp, inline_depth)) return 0;
+    movsdStore(e, disp, 0);
+    e->stored |= bit;
+    if (memo > e->max_shared) e->max_shared = memo;
+    return 1;
+}
+
+/* Emits the whole function; the spill area must be known before the
+ * shared area can be placed above it, so jitCompile() runs this twice. */
+static int genFunction(Emitter *e, ASTNode *node, int shared_base) {
+    e->len = 0;
+    e->max_slot = -1;
+    e->max_shared = -1;
+    e->stored = 0;
+    e->shared_base = shared_base;
+
+    EMIT(e, 0x55);                          /* push rbp         */
+    EMIT(e, 0x48, 0x89, 0xE5);              /* mov rbp, rsp     */
+    EMIT(e, 0x48, 0x81, 0xEC);              /* sub rsp, imm32   */
+    size_t frame_patch = e->len;
+    emitImm32(e, 0);
+    movsdStore(e, X_DISP, 0);
+
+    if (!gen(e, node, 0, X_DISP, 0)) return 0;
+
+    EMIT(e, 0xC9);                          /* leave            */
+    EMIT(e, 0xC3);                          /* ret              */
+
+    int top = e->max_shared >= 0 ? shared_base + e->max_shared : e->max_slot;
+    int32_t frame = 8 + 8 * (top + 1);
+    frame = (frame + 15) & ~15;             /* keep calls 16-byte aligned */
+    memcpy(e->buf + frame_patch, &frame, 4);
+    return 1;
+}
+
+JitCode* jitCompile(ASTNode *node) {
+    Emitter e;
+    memset(&e, 0, sizeof(e));
+
+    if (!genFunction(&e, node, 0) || !genFunction(&e, node, e.max_slot + 1)) {
+        free(e.buf);
+        return NULL;
+    }
+
+    void *mem = mmap(NULL, e.len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        free(e.buf);
+        return NULL;
+    }
+    memcpy(mem, e.buf, e.len);
+    free(e.buf);
+    if (mprotect(mem, e.len, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, e.len);
+        return NULL;
+    }
+
+    JitCode *code = malloc(sizeof(JitCode));
+    code->mem = mem;
+    code->size = e.len;
+    code->fn = (JitFunc)mem;
+    return code;
+}
+
+void jitFree(JitCode *code) {
+    if (!code) return;
+    munmap(code->mem, code->size);
+    free(code);
+}
+
+#else /* JIT not available on this target */
+
+JitCode* jitCompile(ASTNode *node) {
+    (void)node;
+    return NULL;
+}
+
+void jitFree(JitCode *code) {
+    (void)code;
+}
+
+#endif
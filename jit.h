@@ -0,0 +1,23 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+#include "ast.h"
+
+/* Native code for one expression: fn(x) evaluates the AST at x. */
+typedef double (*JitFunc)(double x);
+
+typedef struct {
+    void   *mem;        /* mmap'd executable buffer */
+    size_t  size;
+    JitFunc fn;
+} JitCode;
+
+/* ---- compilation -------------------------------------------------------- */
+/* Returns NULL when the JIT is not built in (non-x86-64 or -DNO_JIT) or the
+ * expression uses something it cannot translate; callers then fall back to
+ * the interpreter. */
+JitCode* jitCompile(ASTNode *node);
+void     jitFree(JitCode *code);
+
+#endif /* JIT_H */
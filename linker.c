@@ -0,0 +1,139 @@
+#include "linker.h"
+#include "symtab.h"
+
+/* Distinct names reported per link; later ones are still bound to NaN. */
+#define MAX_REPORTED 16
+
+typedef struct {
+    ASTNode *body;      /* the definition in functions[] */
+    ASTNode *bound;     /* its linked body, NULL while being linked */
+    int      uses_x;
+} BoundFunc;
+
+typedef struct {
+    BoundFunc *funcs;   /* at most func_count entries */
+    int        n_funcs;
+    int        reported[MAX_REPORTED];     /* interned names */
+    int        n_reported;
+    LinkDep   *deps;        /* NULL unless the caller asked for them */
+    int        n_deps, deps_cap;
+} Linker;
+
+static void recordDep(Linker *l, int name) {
+    if (!l->deps) return;
+    for (int i = 0; i < l->n_deps; i++)
+        if (l->deps[i].name == name) return;
+    if (l->n_deps == l->deps_cap) {
+        l->deps_cap *= 2;
+        l->deps = realloc(l->deps, l->deps_cap * sizeof(LinkDep));
+    }
+    l->deps[l->n_deps].name = name;
+    l->deps[l->n_deps].generation = symbolGeneration(name);
+    l->n_deps++;
+}
+
+static void reportOnce(Linker *l, int name, const char *message) {
+    for (int i = 0; i < l->n_reported; i++)
+        if (l->reported[i] == name) return;
+    if (l->n_reported < MAX_REPORTED)
+        l->reported[l->n_reported++] = name;
+    fprintf(stderr, "\033[1;31mError: %s '%s'\033[0m\n", message, symbolName(name));
+}
+
+static ASTNode* bindNode(Linker *l, ASTNode *node, int *uses_x);
+
+/* Links a function body on first use; later call sites share it. */
+static ASTNode* bindFunction(Linker *l, int name, ASTNode *body, int *uses_x) {
+    BoundFunc *f = NULL;
+    for (int i = 0; i < l->n_funcs; i++)
+        if (l->funcs[i].body == body) f = &l->funcs[i];
+
+    if (f && !f->bound) {
+        reportOnce(l, name, "Recursive definition of");
+        *uses_x = 0;
+        return createNumberNode(NAN);
+    }
+    if (!f) {
+        f = &l->funcs[l->n_funcs++];
+        f->body = body;
+        f->bound = bindNode(l, body, &f->uses_x);
+    }
+    f->bound->refs++;
+    *uses_x = f->uses_x;
+    return f->bound;
+}
+
+static ASTNode* bindNode(Linker *l, ASTNode *node, int *uses_x) {
+    *uses_x = 0;
+    if (!node) return NULL;
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            return createNumberNode(node->value);
+
+        case NODE_VAR:
+            *uses_x = 1;
+            return createVarNode();
+
+        case NODE_IDENTIFIER: {
+            recordDep(l, node->name);
+            double *val = lookupVariableId(node->name);
+            if (val) return createNumberNode(*val);
+            ASTNode *body = lookupFunctionId(node->name);
+            if (body) return bindFunction(l, node->name, body, uses_x);
+            reportOnce(l, node->name, "Undefined identifier");
+            return createNumberNode(NAN);
+        }
+
+        default:
+            break;
+    }
+
+    int ux_left, ux_right, ux_arg2;
+    ASTNode *left = bindNode(l, node->left, &ux_left);
+    ASTNode *right = bindNode(l, node->right, &ux_right);
+    ASTNode *arg2 = bindNode(l, node->arg2, &ux_arg2);
+    *uses_x = ux_left || ux_right || ux_arg2;
+
+    ASTNode *n;
+    switch (node->type) {
+        case NODE_OP:         n = createOpNode(node->op, left, right); break;
+        case NODE_FUNC:       n = createFuncNode(node->func, left); break;
+        case NODE_FUNC2:      n = createFunc2Node(node->func, left, right); break;
+        case NODE_FUNC3:      n = createFunc3Node(node->func, left, right, arg2); break;
+        case NODE_DERIVATIVE: n = createDerivative(node->func, left); break;
+        default:              n = createNumberNode(0); break;
+    }
+
+    // Hoist: a subtree without x has the same value at every sample
+    if (!*uses_x) {
+        double value = evaluate(n, 0);
+        freeAST(n);
+        return createNumberNode(value);
+    }
+    return n;
+}
+
+ASTNode* linkASTDeps(ASTNode *node, LinkDep **deps, int *n_deps) {
+    Linker *l = calloc(1, sizeof(Linker));
+    l->funcs = calloc(func_count + 1, sizeof(BoundFunc));
+    if (deps) {
+        l->deps_cap = 8;
+        l->deps = malloc(l->deps_cap * sizeof(LinkDep));
+    }
+    int uses_x;
+    ASTNode *linked = bindNode(l, node, &uses_x);
+    for (int i = 0; i < l->n_funcs; i++)
+        freeAST(l->funcs[i].bound);     /* drop the linker's reference */
+    if (deps) {
+        *deps = l->deps;
+        *n_deps = l->n_deps;
+    }
+    free(l->funcs);
+    free(l);
+    return hashConsAST(linked);
+}
+
+ASTNode* linkAST(ASTNode *node) {
+    return linkASTDeps(node, NULL, NULL);
+}
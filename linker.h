@@ -0,0 +1,30 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "ast.h"
+
+/* Binds an expression for one sweep.  Returns a new DAG in which
+ *   - variables are replaced by the current value of their slot,
+ *   - each user function is linked once and its body shared by every
+ *     call site (computed once per sample through its memo slot),
+ *   - undefined names and recursive definitions are reported once and
+ *     evaluate to NaN,
+ *   - every subtree that does not depend on x is evaluated once and
+ *     replaced by its value.
+ * The result contains no NODE_IDENTIFIER, so the backends never consult
+ * the symbol table while sampling.  node is left untouched; free the
+ * result with freeAST(). */
+ASTNode* linkAST(ASTNode *node);
+
+/* A name the linked tree was bound against, and its symbolGeneration()
+ * at the time. */
+typedef struct {
+    int                name;
+    unsigned long long generation;
+} LinkDep;
+
+/* linkAST() that also returns every name it looked up, in the bodies of
+ * the functions it linked too, as a malloc'd array in *deps. */
+ASTNode* linkASTDeps(ASTNode *node, LinkDep **deps, int *n_deps);
+
+#endif /* LINKER_H */
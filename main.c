@@ -1,29 +1,95 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <poll.h>
+#include <unistd.h>
 #include "ast.h"
 #include "symtab.h"
-#include "commands.h"
+#include "parser.h"
 #include "tac.h"
-
-typedef struct yy_buffer_state * YY_BUFFER_STATE;
-extern YY_BUFFER_STATE yy_scan_string(const char *str);
-extern void yy_delete_buffer(YY_BUFFER_STATE buffer);
-extern int yyparse();
-extern ASTNode *root;
-extern void yyrestart(FILE *input_file);
-
-int cmd_let=0, cmd_def=0, cmd_ast=0, cmd_vars=0, cmd_funcs=0, cmd_show=0;
-char show_func_name[50];
-int  error_occurred = 0;
+#include "simplify.h"
+#include "inliner.h"
+#include "sampler.h"
+#include "plotter.h"
+#include "adaptive.h"
+#include "decimate.h"
+#include "viewport.h"
+#include "samplecache.h"
+#include "depgraph.h"
+#include "interval.h"
+#include "linker.h"
+#include "cexport.h"
+#include "native.h"
+#include "batch.h"
+#include "stats.h"
+#include "pipeline.h"
 
 // Multi-function storage
 #define MAX_MULTI_FUNCTIONS 10
 ASTNode *multi_functions[MAX_MULTI_FUNCTIONS];
-char multi_func_names[MAX_MULTI_FUNCTIONS][100];
+ASTArena *multi_arenas[MAX_MULTI_FUNCTIONS];  // one per expression, dropped by clear
+char *multi_func_names[MAX_MULTI_FUNCTIONS];
 int multi_func_count = 0;
 int multi_mode = 0;  // 0 = single (advanced features), 1 = multi (simple plotting)
 
+// Dependency tracking: stored expression i is depgraph expression i, and
+// the last single-mode plot comes after them.  When a let or def changes a
+// name they use, autoreplot redraws the plot that is showing.
+#define DEP_SINGLE_PLOT MAX_MULTI_FUNCTIONS
+char *single_plot_input;
+
+typedef enum {
+    SHOWN_NONE,
+    SHOWN_SINGLE,
+    SHOWN_MULTI
+} ShownPlot;
+
+ShownPlot shown_plot = SHOWN_NONE;
+int autoreplot = 1;
+
+// Optimized three-address code of the last single-mode plot and of each
+// stored expression, for 'tac'
+TacProgram *single_tac;
+TacProgram *multi_tac[MAX_MULTI_FUNCTIONS];
+
+static const char *backend_names[] = {"ast", "vm", "batch", "jit", "tac", "native"};
+
+// Points sampled per round before they are written out
+#define SWEEP_WINDOW (1L << 20)
+
+// Where plot samples go: inline through the gnuplot pipe, or into binary
+// sample files (data.bin, data0.bin, ...) that gnuplot then reads
+typedef enum {
+    OUTPUT_PIPE,
+    OUTPUT_PAIRS,   // x y x y ...
+    OUTPUT_COLUMNS  // all x, then all y
+} OutputMode;
+
+static const char *output_names[] = {"pipe", "pairs", "columns"};
+OutputMode output_mode = OUTPUT_PIPE;
+
+// Uniform sweeps evaluate every step; adaptive sampling refines where the
+// curve bends and splits it at poles and undefined regions
+typedef enum {
+    SAMPLING_UNIFORM,
+    SAMPLING_ADAPTIVE
+} SamplingMode;
+
+static const char *sampling_names[] = {"uniform", "adaptive"};
+SamplingMode sampling_mode = SAMPLING_UNIFORM;
+
+// Curves are reduced to what this many pixel columns can show before they
+// reach gnuplot.  Twice a large plot window, so columns whose edges miss
+// the pixel edges move a line by a pixel at most.
+static const char *decimate_names[] = {"off", "m4", "lttb"};
+DecimateMode decimate_mode = DECIMATE_M4;
+long decimate_width = 4000;
+
+// The y-axis of a plot spans the interval bounds of its curves, which
+// leave out poles, or whatever gnuplot makes of the data
+static const char *ylimits_names[] = {"data", "bounds"};
+int ylimits_bounds = 1;
+
 void print_banner() {
     printf("\n");
     printf("╔═══════════════════════════════════════════════════════════╗\n");
@@ -42,9 +108,19 @@ void print_banner() {
     printf("  \033[1;32mMulti mode\033[0m:  Collect multiple expressions → type 'plot' to overlay\n");
     printf("\n\033[1;36mCommands:\033[0m\n");
     printf("  \033[1;32mmode\033[0m        - Toggle between single/multi mode\n");
+    printf("  \033[1;32mbackend\033[0m     - Select evaluator: batch, jit, tac, native, vm or ast\n");
+    printf("  \033[1;32moutput\033[0m      - Send samples through the pipe or to binary files\n");
+    printf("  \033[1;32msampling\033[0m    - Sample on the uniform grid or adaptively\n");
+    printf("  \033[1;32mdecimate\033[0m    - Reduce curves to the plot width: m4, lttb or off\n");
+    printf("  \033[1;32mcache\033[0m       - Sample cache: <MB>, off, clear, save or load [file]\n");
+    printf("  \033[1;32mautoreplot\033[0m  - Redraw after let/def changes what is shown: on or off\n");
+    printf("  \033[1;32mylimits\033[0m     - y-axis from interval bounds or from the data\n");
     printf("  \033[1;32mvars\033[0m        - List all variables (single mode)\n");
     printf("  \033[1;32mfuncs\033[0m       - List all functions (single mode)\n");
-    printf("  \033[1;32mtac\033[0m         - Show Three-Address Code (single mode & mulit mode) \n");
+    printf("  \033[1;32mtac\033[0m         - Show optimized Three-Address Code; 'tac dump [file]' writes it\n");
+    printf("  \033[1;32mexport\033[0m      - Write defs as C: 'export [params] <file.c|file.so> [<def> ...]'\n");
+    printf("  \033[1;32mload\033[0m        - Load a library built by export, for 'backend native'\n");
+    printf("  \033[1;32mstats\033[0m       - Time per phase and counters; 'stats trace [file]' writes a Chrome trace\n");
     printf("  \033[1;32mshow <name>\033[0m - Display function AST (single mode)\n");
     printf("  \033[1;32mlist\033[0m        - Show stored expressions (multi mode)\n");
     printf("  \033[1;32mplot\033[0m        - Plot all stored expressions (multi mode)\n");
@@ -73,54 +149,303 @@ void list_multi_functions() {
     printf("\n");
 }
 
-void plot_single_function(ASTNode *node, double x_min, double x_max, double step) {
-    FILE *f = fopen("data.txt", "w");
-    if (!f) {
-        fprintf(stderr, "Error: Cannot create data file\n");
-        return;
+// A plot in flight.  Its samplers are linked on the REPL thread, which
+// owns the symbol table and the node arenas; compiling, sampling and
+// drawing happen in the pipeline.  The settings are copied, so changing
+// them at the prompt does not touch a plot being built.
+typedef struct {
+    int          n;
+    Sampler      samplers[MAX_MULTI_FUNCTIONS];
+    Curve        curves[MAX_MULTI_FUNCTIONS];
+    long         points[MAX_MULTI_FUNCTIONS];
+    double       x_min, x_max, step;
+    OutputMode   output;
+    SamplingMode sampling;
+    DecimateMode decimate;
+    long         width;
+    int          y_bounds;
+    ShownPlot    shown, shown_before;
+    int          plotted;
+    FILE        *out;           // what the plot reports, printed when it is collected
+    char        *report;
+    size_t       report_len;
+} PlotJob;
+
+// One plot is in flight at a time; a new one cancels it first
+PlotJob plot_job;
+
+// Backs a curve with a sample file when the output mode asks for one, and
+// sets up decimation.  Adaptive samples are not evenly spaced, so they are
+// always written as pairs.
+void prepare_curve(PlotJob *job, Curve *c, const char *path, long points) {
+    if (job->output != OUTPUT_PIPE) {
+        SampleLayout layout = job->output == OUTPUT_COLUMNS && job->sampling == SAMPLING_UNIFORM
+                            ? SAMPLES_COLUMNS : SAMPLES_PAIRS;
+        if (!curveOpenFile(c, path, layout, points, job->x_min, job->step)) {
+            fprintf(job->out, "Warning: cannot write %s, sending samples through the pipe\n", path);
+        }
     }
+    curveDecimate(c, job->decimate, job->width, job->x_min, job->x_max);
+}
+
+// Finishes decimation and says how much it saved
+void report_decimation(PlotJob *job, Curve *c, long points) {
+    STATS_START(start);
+    curveFlush(c);
+    STATS_PHASE(PHASE_WRITE, start);
+    if (c->n < points) {
+        fprintf(job->out, "[Decimated to %ld points for %ld columns (%s)]\n",
+                c->n, job->width, decimate_names[job->decimate]);
+    }
+}
 
-    int points = 0;
-    int has_error = 0;
-    for (double x = x_min; x <= x_max; x += step) {
-        double y = evaluate(node, x);
-        if (!isnan(y) && !isinf(y)) {
-            fprintf(f, "%lf %lf\n", x, y);
-            points++;
+// The linked tree holds the values of the variables an expression reads,
+// so its hash changes with them
+SampleKey sample_key(const Sampler *s, CachedKind kind,
+                     double x_min, double x_max, double step) {
+    SampleKey key = {hashAST(s->node), kind, x_min, x_max, kind == CACHED_UNIFORM ? step : 0};
+    return key;
+}
+
+// Fills curve i with adaptive samples; returns the evaluations spent (0
+// when they came from the cache) and sets its points
+long sample_adaptive(PlotJob *job, int i, const char *path) {
+    const Sampler *s = &job->samplers[i];
+    Curve *c = &job->curves[i];
+    SampleKey key = sample_key(s, CACHED_ADAPTIVE, job->x_min, job->x_max, job->step);
+    AdaptiveSamples samples = {NULL, 0, 0};
+    long cached_n;
+    const double *cached = sampleCacheFind(&key, &cached_n, &samples.evaluations);
+    if (cached) {
+        samples.xy = (double *)cached;
+        samples.n = cached_n / 2;
+    } else {
+        STATS_START(sample_start);
+        sampleAdaptive(s, job->x_min, job->x_max, &samples);
+        STATS_PHASE(PHASE_SAMPLE, sample_start);
+        if (pipelineCancelled()) {
+            freeAdaptiveSamples(&samples);
+            return 0;
+        }
+    }
+    STATS_START(write_start);
+    prepare_curve(job, c, path, samples.n);
+    job->points[i] = 0;
+    for (long k = 0; k < samples.n; k++) {
+        double x = samples.xy[2 * k], y = samples.xy[2 * k + 1];
+        if (isnan(x)) {
+            curveBreak(c);
         } else {
-            has_error = 1;
+            curveAdd(c, x, y);
+            job->points[i]++;
         }
     }
-    fclose(f);
+    STATS_PHASE(PHASE_WRITE, write_start);
+    if (cached) return 0;
+    sampleCacheStore(&key, samples.xy, 2 * samples.n, samples.evaluations);
+    return samples.evaluations;
+}
 
-    if (points == 0) {
-        fprintf(stderr, "\033[1;31mError: No valid points to plot\033[0m\n");
-        return;
+// Fills curve i over the uniform sweep and sets its finite points.  A
+// sweep found in the cache is replayed; otherwise, if it fits the budget,
+// it is sampled whole and cached, else a window at a time.  Returns 1 if
+// it came from the cache.
+int sweep_curve(PlotJob *job, int i) {
+    const Sampler *s = &job->samplers[i];
+    Curve *c = &job->curves[i];
+    double x_min = job->x_min, step = job->step;
+    long total = sweepPoints(x_min, job->x_max, step);
+    SampleKey key = sample_key(s, CACHED_UNIFORM, x_min, job->x_max, step);
+    long cached_n;
+    const double *cached = sampleCacheFind(&key, &cached_n, NULL);
+    job->points[i] = 0;
+    if (cached && cached_n == total) {
+        for (long j = 0; j < total; j++) {
+            if (!isnan(cached[j]) && !isinf(cached[j])) job->points[i]++;
+            curveAdd(c, x_min + (double)j * step, cached[j]);
+        }
+        return 1;
     }
 
-    if (has_error) {
-        printf("\n\033[1;33mWarning: Some points skipped due to undefined values (NaN/Inf)\033[0m\n");
+    int keep = sampleCacheFits(total);
+    long window = keep ? total : total < SWEEP_WINDOW ? total + 1 : SWEEP_WINDOW;
+    double *ys = malloc((window > 0 ? window : 1) * sizeof(double));
+    for (long first = 0; first < total; first += SWEEP_WINDOW) {
+        long count = total - first < SWEEP_WINDOW ? total - first : SWEEP_WINDOW;
+        double *window_ys = keep ? ys + first : ys;
+        STATS_START(sample_start);
+        sampleSweep(s, 1, x_min, step, first, count, &window_ys);
+        STATS_PHASE(PHASE_SAMPLE, sample_start);
+        if (pipelineCancelled()) break;
+        STATS_START(write_start);
+        for (long j = 0; j < count; j++) {
+            double y = window_ys[j];
+            if (!isnan(y) && !isinf(y)) job->points[i]++;
+            curveAdd(c, x_min + (double)(first + j) * step, y);
+        }
+        STATS_PHASE(PHASE_WRITE, write_start);
+    }
+    if (keep && !pipelineCancelled()) {
+        sampleCacheStore(&key, ys, total, total);
+    } else {
+        free(ys);
     }
+    return 0;
+}
+
+// Worker: compiles the samplers, then samples the curves one after the
+// other.  Each finished curve is published, so the first curves of a
+// multi-function plot are drawn while the others are still sampled.
+void plot_job_work(void *ctx) {
+    PlotJob *job = ctx;
+    STATS_START(compile_start);
+    for (int i = 0; i < job->n; i++) compileSampler(&job->samplers[i]);
+    STATS_PHASE(PHASE_COMPILE, compile_start);
 
-    printf("\n[Generated %d data points from %.2f to %.2f]\n", points, x_min, x_max);
-    printf("Launching gnuplot...\n");
+    int single = job->shown == SHOWN_SINGLE;
+    int adaptive = job->sampling == SAMPLING_ADAPTIVE;
+    long total = adaptive ? 0 : sweepPoints(job->x_min, job->x_max, job->step);
+    for (int i = 0; i < job->n && !pipelineCancelled(); i++) {
+        char filename[30];
+        if (single) {
+            sprintf(filename, "data.bin");
+        } else {
+            sprintf(filename, "data%d.bin", i);
+        }
+        long evaluations = 0;
+        int cached = 0;
+        if (adaptive) {
+            evaluations = sample_adaptive(job, i, filename);
+        } else {
+            prepare_curve(job, &job->curves[i], filename, total);
+            cached = sweep_curve(job, i);
+        }
+        if (pipelineCancelled()) return;
+
+        long points = job->points[i];
+        if (single && points == 0) {
+            fprintf(job->out, "\033[1;31mError: No valid points to plot\033[0m\n");
+            return;
+        }
+        if (single && !adaptive && points < total) {
+            fprintf(job->out, "\n\033[1;33mWarning: Some points skipped due to undefined values (NaN/Inf)\033[0m\n");
+        }
+        if (single && adaptive && evaluations) {
+            fprintf(job->out, "\n[Generated %ld data points from %.2f to %.2f, %ld evaluations]\n",
+                    points, job->x_min, job->x_max, evaluations);
+        } else if (single) {
+            fprintf(job->out, "\n[%s %ld data points from %.2f to %.2f]\n",
+                    adaptive || cached ? "Reused cached" : "Generated", points,
+                    job->x_min, job->x_max);
+        }
+        if (single) {
+            report_decimation(job, &job->curves[i], points);
+        } else {
+            curveFlush(&job->curves[i]);
+        }
+        pipelinePublish(i + 1, i + 1 == job->n);
+    }
+}
 
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd),
-        "gnuplot -p -e \""
-        "set title 'f(x) Plot' font ',14'; "
-        "set xlabel 'x' font ',12'; "
-        "set ylabel 'f(x)' font ',12'; "
-        "set grid; "
-        "set key top left; "
-        "plot 'data.txt' with lines linewidth 2 linecolor rgb '#0072BD' title 'f(x)'"
-        "\"");
-    
-    int ret = system(cmd);
-    if (ret != 0) {
-        fprintf(stderr, "Warning: gnuplot command failed. Is gnuplot installed?\n");
+// Render thread: draws the first `frame` curves, with the y-axis fixed to
+// their bounds over the range unless the limits follow the data
+void plot_job_render(void *ctx, int frame) {
+    PlotJob *job = ctx;
+    STATS_START(start);
+    double y_min = NAN, y_max = NAN;
+    if (job->y_bounds) {
+        ASTNode *nodes[MAX_MULTI_FUNCTIONS];
+        for (int i = 0; i < frame; i++) nodes[i] = job->samplers[i].node;
+        intervalYLimits(nodes, frame, job->x_min, job->x_max, &y_min, &y_max);
     }
-    printf("\n");
+    const char *title = job->shown == SHOWN_SINGLE ? "f(x) Plot" : "Multiple Functions Plot";
+    plotterLog(job->out);
+    job->plotted = plotCurvesRange(title, job->curves, frame, NAN, NAN, y_min, y_max);
+    plotterLog(NULL);
+    STATS_PHASE(PHASE_RENDER, start);
+}
+
+// REPL thread: prints what the plot reported, and hands the samplers of a
+// plot that is showing to the viewport
+void plot_job_finish(void *ctx, int cancelled) {
+    PlotJob *job = ctx;
+    fclose(job->out);
+    if (cancelled) {
+        printf("\033[2m[Plot cancelled]\033[0m\n");
+    } else {
+        fwrite(job->report, 1, job->report_len, stdout);
+    }
+    free(job->report);
+
+    int shown = !cancelled && job->plotted;
+    if (shown) {
+        const char *title = job->shown == SHOWN_SINGLE ? "f(x) Plot" : "Multiple Functions Plot";
+        viewportTrack(title, job->samplers, job->curves, job->n, job->decimate, job->width,
+                      job->y_bounds);
+        shown_plot = job->shown;
+    } else {
+        for (int i = 0; i < job->n; i++) releaseSampler(&job->samplers[i]);
+        if (shown_plot == job->shown) shown_plot = job->shown_before;
+    }
+    if (shown && job->shown == SHOWN_MULTI) {
+        printf("Plot complete!\n\n");
+    } else if (!cancelled) {
+        printf("\n");
+    }
+    for (int i = 0; i < job->n; i++) curveFree(&job->curves[i]);
+    job->n = 0;
+}
+
+// On a terminal, plots are built in the background and the prompt comes
+// back at once; otherwise each plot is waited for, so output stays in order
+int interactive = 0;
+
+// Cancels the plot in flight and sets up the next one with the current
+// settings
+PlotJob* begin_plot(ShownPlot shown, double x_min, double x_max, double step) {
+    pipelineCancel();
+    PlotJob *job = &plot_job;
+    memset(job, 0, sizeof(*job));
+    job->x_min = x_min;
+    job->x_max = x_max;
+    job->step = step;
+    job->output = output_mode;
+    job->sampling = sampling_mode;
+    job->decimate = decimate_mode;
+    job->width = decimate_width;
+    job->y_bounds = ylimits_bounds;
+    job->shown = shown;
+    job->out = open_memstream(&job->report, &job->report_len);
+    return job;
+}
+
+// Links the next sampler of a plot.  It is kept for re-sampling on zoom,
+// after the command's arena is gone, so its tree goes to the process arena.
+void add_plot_sampler(PlotJob *job, ASTNode *node, const char *title, const char *color) {
+    STATS_START(start);
+    ASTArena *prev = arenaSwitch(NULL);
+    linkSampler(&job->samplers[job->n], node);
+    arenaSwitch(prev);
+    STATS_PHASE(PHASE_COMPILE, start);
+    Curve *c = &job->curves[job->n++];
+    snprintf(c->title, sizeof(c->title), "%s", title);
+    c->color = color;
+}
+
+// The plot counts as showing while it is built, so a let or def that
+// changes it redraws it
+void submit_plot(PlotJob *job) {
+    job->shown_before = shown_plot;
+    shown_plot = job->shown;
+    PipelineJob stages = {plot_job_work, plot_job_render, plot_job_finish, job};
+    pipelineSubmit(&stages);
+    if (!interactive) pipelineWait();
+}
+
+void plot_single_function(ASTNode *node, double x_min, double x_max, double step) {
+    PlotJob *job = begin_plot(SHOWN_SINGLE, x_min, x_max, step);
+    add_plot_sampler(job, node, "f(x)", "#0072BD");
+    submit_plot(job);
 }
 
 void plot_all_multi_functions(double x_min, double x_max, double step) {
@@ -128,78 +453,330 @@ void plot_all_multi_functions(double x_min, double x_max, double step) {
         printf("No functions to plot!\n");
         return;
     }
+    PlotJob *job = begin_plot(SHOWN_MULTI, x_min, x_max, step);
+    STATS_START(start);
+    STATS_BEGIN("plot", start);
+
+    // Define colors for different functions
+    const char *colors[] = {"#0072BD", "#D95319", "#EDB120", "#7E2F8E", 
+                           "#77AC30", "#4DBEEE", "#A2142F"};
 
-    // Generate data files for each function
     for (int i = 0; i < multi_func_count; i++) {
-        char filename[30];
-        sprintf(filename, "data%d.txt", i);
-        FILE *f = fopen(filename, "w");
-        if (!f) {
-            fprintf(stderr, "Error: Cannot create %s\n", filename);
-            continue;
+        char title[128];
+        snprintf(title, sizeof(title), "f%d: %.100s", i, multi_func_names[i]);
+        add_plot_sampler(job, multi_functions[i], title, colors[i % 7]);
+    }
+    printf("\nPlotting %d function%s...\n", 
+           multi_func_count, multi_func_count > 1 ? "s" : "");
+    submit_plot(job);
+}
+
+// -1 if there is no backend of that name
+int find_backend(const char *name) {
+    for (int i = 0; i <= BACKEND_NATIVE; i++) {
+        if (strcmp(name, backend_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+void set_backend(const char *arg) {
+    if (*arg == '\0') {
+        printf("Evaluation backend: \033[1;33m%s\033[0m\n", backend_names[backend]);
+        return;
+    }
+    int i = find_backend(arg);
+    if (i >= 0) {
+        backend = (Backend)i;
+        printf("Evaluation backend set to \033[1;33m%s\033[0m\n", arg);
+        if (backend == BACKEND_NATIVE && nativeCount() == 0) {
+            printf("No library is loaded yet; see 'export' and 'load'.\n");
         }
-        for (double x = x_min; x <= x_max; x += step) {
-            double y = evaluate(multi_functions[i], x);
-            if (!isnan(y) && !isinf(y)) {
-                fprintf(f, "%lf %lf\n", x, y);
-            }
+        return;
+    }
+    printf("Unknown backend '%s'. Use 'backend batch', 'jit', 'tac', 'native', 'vm' or 'ast'.\n", arg);
+}
+
+void set_output(const char *arg) {
+    if (*arg == '\0') {
+        printf("Sample output: \033[1;33m%s\033[0m\n", output_names[output_mode]);
+        return;
+    }
+    for (int i = 0; i <= OUTPUT_COLUMNS; i++) {
+        if (strcmp(arg, output_names[i]) == 0) {
+            output_mode = (OutputMode)i;
+            printf("Sample output set to \033[1;33m%s\033[0m\n", arg);
+            return;
         }
-        fclose(f);
     }
+    printf("Unknown output '%s'. Use 'output pipe', 'pairs' or 'columns'.\n", arg);
+}
 
-    printf("\nLaunching gnuplot with %d function%s...\n", 
-           multi_func_count, multi_func_count > 1 ? "s" : "");
+void set_sampling(const char *arg) {
+    if (*arg == '\0') {
+        printf("Sampling: \033[1;33m%s\033[0m\n", sampling_names[sampling_mode]);
+        return;
+    }
+    for (int i = 0; i <= SAMPLING_ADAPTIVE; i++) {
+        if (strcmp(arg, sampling_names[i]) == 0) {
+            sampling_mode = (SamplingMode)i;
+            printf("Sampling set to \033[1;33m%s\033[0m\n", arg);
+            return;
+        }
+    }
+    printf("Unknown sampling '%s'. Use 'sampling uniform' or 'adaptive'.\n", arg);
+}
 
-    // Build gnuplot command
-    FILE *gp = popen("gnuplot -persist", "w");
-    if (!gp) {
-        fprintf(stderr, "Error: Cannot launch gnuplot\n");
+void set_decimate(const char *arg) {
+    char name[16];
+    long width = decimate_width;
+    if (sscanf(arg, "%15s %ld", name, &width) < 1) {
+        printf("Decimation: \033[1;33m%s\033[0m, %ld columns\n",
+               decimate_names[decimate_mode], decimate_width);
+        return;
+    }
+    if (width < 1) {
+        printf("The width must be a positive number of columns.\n");
         return;
     }
+    for (int i = 0; i <= DECIMATE_LTTB; i++) {
+        if (strcmp(name, decimate_names[i]) == 0) {
+            decimate_mode = (DecimateMode)i;
+            decimate_width = width;
+            printf("Decimation set to \033[1;33m%s\033[0m, %ld columns\n", name, width);
+            return;
+        }
+    }
+    printf("Unknown decimation '%s'. Use 'decimate m4 [width]', 'lttb [width]' or 'off'.\n", name);
+}
 
-    fprintf(gp, "set title 'Multiple Functions Plot' font ',14'\n");
-    fprintf(gp, "set xlabel 'x' font ',12'\n");
-    fprintf(gp, "set ylabel 'f(x)' font ',12'\n");
-    fprintf(gp, "set grid\n");
-    fprintf(gp, "set key top left\n");
-    
-    // Define colors for different functions
-    const char *colors[] = {"#0072BD", "#D95319", "#EDB120", "#7E2F8E", 
-                           "#77AC30", "#4DBEEE", "#A2142F"};
-    
-    fprintf(gp, "plot ");
+// Default file for 'cache save' and 'cache load'
+#define SAMPLE_CACHE_FILE "samples.cache"
+
+void set_cache(const char *arg) {
+    char verb[16], path[256] = SAMPLE_CACHE_FILE;
+    double mb;
+    SampleCacheStats stats;
+    if (sscanf(arg, "%15s %255s", verb, path) < 1) {
+        sampleCacheStats(&stats);
+        printf("Sample cache: \033[1;33m%ld\033[0m entries, %.1f of %g MB, %ld hits, %ld misses\n",
+               stats.entries, stats.bytes / 1048576.0, stats.budget / 1048576.0,
+               stats.hits, stats.misses);
+        return;
+    }
+    if (strcmp(verb, "off") == 0) {
+        sampleCacheSetBudget(0);
+        printf("Sample cache \033[1;33moff\033[0m\n");
+    } else if (strcmp(verb, "clear") == 0) {
+        sampleCacheClear();
+        printf("Sample cache cleared.\n");
+    } else if (strcmp(verb, "save") == 0) {
+        sampleCacheStats(&stats);
+        if (sampleCacheSave(path)) {
+            printf("Saved %ld cached curves to %s\n", stats.entries, path);
+        }
+    } else if (strcmp(verb, "load") == 0) {
+        if (sampleCacheLoad(path)) {
+            sampleCacheStats(&stats);
+            printf("Loaded %s, %ld cached curves now\n", path, stats.entries);
+        }
+    } else if (sscanf(verb, "%lf", &mb) == 1 && mb >= 0) {
+        sampleCacheSetBudget((size_t)(mb * 1048576.0));
+        printf("Sample cache budget set to \033[1;33m%g MB\033[0m\n", mb);
+    } else {
+        printf("Unknown cache command '%s'. Use 'cache <MB>', 'off', 'clear', 'save [file]' or 'load [file]'.\n", verb);
+    }
+}
+
+void set_autoreplot(const char *arg) {
+    if (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0) {
+        autoreplot = strcmp(arg, "on") == 0;
+    } else if (*arg != '\0') {
+        printf("Unknown setting '%s'. Use 'autoreplot on' or 'off'.\n", arg);
+        return;
+    }
+    printf("Autoreplot: \033[1;33m%s\033[0m\n", autoreplot ? "on" : "off");
+}
+
+TacProgram* build_tac(const ASTNode *node) {
+    TacProgram *p = tacLower(node);
+    tacOptimize(p);
+    return p;
+}
+
+// The code of the last plot in single mode, of every stored expression in
+// multi mode
+void write_tac(FILE *out) {
+    if (!multi_mode) {
+        if (single_tac) tacPrint(single_tac, out);
+        return;
+    }
     for (int i = 0; i < multi_func_count; i++) {
-        fprintf(gp, "'data%d.txt' with lines linewidth 2 linecolor rgb '%s' title 'f%d: %s'",
-                i, colors[i % 7], i, multi_func_names[i]);
-        if (i < multi_func_count - 1) {
-            fprintf(gp, ", ");
+        fprintf(out, "# f%d: %s\n", i, multi_func_names[i]);
+        tacPrint(multi_tac[i], out);
+    }
+}
+
+void show_tac(void) {
+    TacProgram **progs = multi_mode ? multi_tac : &single_tac;
+    int n = multi_mode ? multi_func_count : single_tac != NULL;
+    if (n == 0) {
+        printf("No expression yet.\n");
+        return;
+    }
+    write_tac(stdout);
+    TacStats total = {0};
+    int ops = 0;
+    for (int i = 0; i < n; i++) {
+        total.lowered += progs[i]->stats.lowered;
+        total.folded += progs[i]->stats.folded;
+        total.merged += progs[i]->stats.merged;
+        total.dead += progs[i]->stats.dead;
+        ops += tacOperations(progs[i]);
+    }
+    printf("[%d operations, %d before optimization: %d folded, %d merged, %d dead]\n",
+           ops, total.lowered, total.folded, total.merged, total.dead);
+}
+
+// Default file for 'tac dump'
+#define TAC_FILE "tac.txt"
+
+void run_tac_command(const char *arg) {
+    char verb[16], path[256] = TAC_FILE;
+    if (sscanf(arg, "%15s %255s", verb, path) < 1) {
+        show_tac();
+        return;
+    }
+    if (strcmp(verb, "dump") != 0) {
+        printf("Unknown tac command '%s'. Use 'tac' or 'tac dump [file]'.\n", verb);
+        return;
+    }
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    write_tac(f);
+    fclose(f);
+    printf("Wrote three-address code to %s\n", path);
+}
+
+#define MAX_EXPORT_FUNCTIONS 64
+
+// export [params] <file> [<def> ...]: writes the named defs, or all of
+// them, as C.  Variables are folded in as constants unless 'params' asks
+// for them as arguments.  A .so file name builds the library as well.
+void run_export(char *arg) {
+    int params = strncmp(arg, "params ", 7) == 0;
+    if (params) arg += 7;
+    char *path = strtok(arg, " ");
+    if (!path) {
+        printf("Usage: export [params] <file.c|file.so> [<def> ...]\n");
+        return;
+    }
+    const char *names[MAX_EXPORT_FUNCTIONS];
+    int n = 0;
+    for (char *name; (name = strtok(NULL, " ")) && n < MAX_EXPORT_FUNCTIONS; ) {
+        if (!lookupFunction(name)) {
+            printf("\033[1;31mError: '%s' is not a function\033[0m\n", name);
+            return;
+        }
+        names[n++] = name;
+    }
+    if (n == 0) {
+        while (n < func_count && n < MAX_EXPORT_FUNCTIONS) {
+            names[n] = functions[n].name;
+            n++;
+        }
+    }
+    if (n == 0) {
+        printf("No functions to export; define some with 'def'.\n");
+        return;
+    }
+
+    // The same pipeline a plot of the name goes through, so that a loaded
+    // library matches what the samplers see
+    ASTArena *scratch = arenaCreate();
+    ASTArena *previous = arenaSwitch(scratch);
+    ExportFunc funcs[MAX_EXPORT_FUNCTIONS];
+    TacProgram *progs[MAX_EXPORT_FUNCTIONS];
+    for (int i = 0; i < n; i++) {
+        ASTNode *node = createIdentifierNode(names[i]);
+        node = hashConsAST(simplifyAST(optimizeAST(inlineAST(node))));
+        if (!params) node = linkAST(node);
+        progs[i] = build_tac(node);
+        funcs[i].name = names[i];
+        funcs[i].tac = progs[i];
+    }
+    arenaSwitch(previous);
+    arenaDestroy(scratch);
+
+    char c_path[256];
+    size_t len = strlen(path);
+    int shared = len > 3 && strcmp(path + len - 3, ".so") == 0;
+    snprintf(c_path, sizeof(c_path), "%.*s%s", (int)(shared ? len - 3 : len), path,
+             shared ? ".c" : "");
+    if (exportSource(c_path, funcs, n)) {
+        printf("Wrote %d function%s to %s\n", n, n > 1 ? "s" : "", c_path);
+        if (shared && compileShared(c_path, path)) {
+            printf("Built %s; 'load %s' to sample with it\n", path, path);
         }
     }
-    fprintf(gp, "\n");
-    
-    fflush(gp);
-    pclose(gp);
-    printf("Plot complete!\n\n");
+    for (int i = 0; i < n; i++) tacFree(progs[i]);
+}
+
+void run_load(const char *path) {
+    if (*path == '\0') {
+        printf("Usage: load <file.so>\n");
+        return;
+    }
+    int n = nativeLoad(path);
+    if (n > 0) {
+        printf("Loaded %d function%s from %s", n, n > 1 ? "s" : "", path);
+        printf(backend == BACKEND_NATIVE ? "\n" : "; 'backend native' samples with them\n");
+    }
+}
+
+void set_ylimits(const char *arg) {
+    if (*arg == '\0') {
+        printf("y-limits: \033[1;33m%s\033[0m\n", ylimits_names[ylimits_bounds]);
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (strcmp(arg, ylimits_names[i]) == 0) {
+            ylimits_bounds = i;
+            printf("y-limits set to \033[1;33m%s\033[0m\n", arg);
+            return;
+        }
+    }
+    printf("Unknown y-limits '%s'. Use 'ylimits bounds' or 'data'.\n", arg);
 }
 
 void clear_multi_functions() {
+    pipelineCancel();
     for (int i = 0; i < multi_func_count; i++) {
-        freeAST(multi_functions[i]);
+        tacFree(multi_tac[i]);
+        multi_tac[i] = NULL;
+        free(multi_func_names[i]);
+        multi_func_names[i] = NULL;
+        arenaDestroy(multi_arenas[i]);
+        depgraphForget(i);
     }
+    if (shown_plot == SHOWN_MULTI) shown_plot = SHOWN_NONE;
     multi_func_count = 0;
     printf("All stored functions cleared.\n");
 }
 
 void toggle_mode() {
+    pipelineCancel();
     multi_mode = !multi_mode;
-    tac_reset();
-    FILE *f = fopen("tac.txt", "w");
-    fclose(f);
+    // The plot left in the window no longer follows definitions
+    depgraphForget(DEP_SINGLE_PLOT);
+    shown_plot = SHOWN_NONE;
     printf("\n");
     if (multi_mode) {
         printf("★ Switched to \033[1;33mMULTI-FUNCTION\033[0m mode\n");
         printf("  → Enter multiple expressions, then type 'plot' to overlay them\n");
-        printf("  → Commands: list, plot, tac, clear\n");
+        printf("  → Commands: list, plot, tac, clear, let, def\n");
     } else {
         printf("★ Switched to \033[1;33mSINGLE-FUNCTION\033[0m mode\n");
         printf("  → Use advanced features: let, def, vars, funcs, show, ast, tac\n");
@@ -214,70 +791,316 @@ void toggle_mode() {
     printf("\n");
 }
 
+void print_syntax_error(const Statement *s) {
+    fprintf(stderr, "Error: %s\n", s->error);
+    printf("\033[1;31mSyntax error. Please try again.\033[0m\n");
+}
+
 ASTNode* parse_expression_from_string(const char *input) {
-    char expr_with_newline[260];
-    snprintf(expr_with_newline, sizeof(expr_with_newline), "%s\n", input);
-    
-    YY_BUFFER_STATE buffer = yy_scan_string(expr_with_newline);
-    root = NULL;
-    error_occurred = 0;
-    
-    int result = yyparse();
-    yy_delete_buffer(buffer);
-
-    if (error_occurred) {
-        printf("\033[1;31mSyntax error. Please try again.\033[0m\n");
+    Statement s;
+    if (!parseStatement(input, &s)) {
+        print_syntax_error(&s);
         return NULL;
     }
+    freeStatement(&s);
 
-    if (result != 0 || !root) {
+    if (s.kind != STMT_EXPR) {
         printf("\033[1;31mParse error. Please try again.\033[0m\n");
         return NULL;
     }
 
+    if (!validateAST(s.node)) {
+        freeAST(s.node);
+        return NULL;
+    }
+
+    return s.node;
+}
+
+// Carries out a single-mode statement other than an expression to plot
+void run_statement(Statement *s) {
+    switch (s->kind) {
+        case STMT_VARS:
+            listVariables();
+            break;
+        case STMT_FUNCS:
+            listFunctions();
+            break;
+        case STMT_SHOW:
+            showFunction(s->name);
+            break;
+        case STMT_LET: {
+            ASTNode *value = inlineAST(s->node);     // expands d()
+            double val = evaluate(value, 0);
+            storeVariable(s->name, val);
+            printf("Variable '\033[1;33m%s\033[0m' = %.4f\n", s->name, val);
+            freeAST(value);
+            break;
+        }
+        case STMT_DEF:
+            storeFunction(s->name, persistAST(s->node));
+            printf("Function '\033[1;33m%s\033[0m' defined\n", s->name);
+            break;
+        case STMT_AST: {
+            ASTNode *optimized = hashConsAST(simplifyAST(optimizeAST(inlineAST(s->node))));
+            printf("\n\033[1;36m╔════════════════════════════════════════╗\033[0m\n");
+            printf("\033[1;36m║  Abstract Syntax Tree (optimized)      ║\033[0m\n");
+            printf("\033[1;36m╚════════════════════════════════════════╝\033[0m\n\n");
+            printASTPretty(optimized, "", 0);
+            printf("\n");
+            freeAST(optimized);
+            break;
+        }
+        case STMT_TAC:
+            show_tac();
+            break;
+        case STMT_QUIT:
+            pipelineCancel();
+            viewportRelease();
+            closePlotter();
+            exit(0);
+        default:
+            break;
+    }
+}
+
+// Parses one single-mode line (let, def, vars, funcs, show, ast or an
+// expression) and plots it if it was an expression.
+void run_single_command(const char *input, double x_min, double x_max, double step) {
+    STATS_START(parse_start);
+    Statement s;
+    if (!parseStatement(input, &s)) {
+        print_syntax_error(&s);
+        return;
+    }
+    if (s.kind != STMT_EXPR) {
+        run_statement(&s);
+        freeStatement(&s);
+        return;
+    }
+    ASTNode *root = s.node;
+
+    // We got an expression (not a command): plot it, and note the names
+    // it uses so a later let or def can redraw it
+    free(single_plot_input);
+    single_plot_input = strdup(input);
+    STATS_BEGIN(single_plot_input, parse_start);
+    STATS_PHASE(PHASE_PARSE, parse_start);
+    depgraphTrack(DEP_SINGLE_PLOT, root);
+    STATS_START(optimize_start);
+    root = optimizeAST(inlineAST(root));
+
     if (!validateAST(root)) {
         freeAST(root);
-        return NULL;
+        STATS_END();
+        return;
+    }
+    root = hashConsAST(simplifyAST(root));
+    STATS_PHASE(PHASE_OPTIMIZE, optimize_start);
+
+    STATS_START(tac_start);
+    tacFree(single_tac);
+    single_tac = build_tac(root);
+    STATS_PHASE(PHASE_TAC, tac_start);
+
+    plot_single_function(root, x_min, x_max, step);
+    freeAST(root);
+    STATS_END();
+}
+
+// Nodes built for a single-mode line are released together afterwards;
+// def bodies are moved out of the arena by run_statement().  input may be
+// single_plot_input, which the line replaces, so it is copied first.
+void run_scratch_command(const char *input, double x_min, double x_max, double step) {
+    char *line = strdup(input);
+    ASTArena *scratch = arenaCreate();
+    arenaSwitch(scratch);
+    run_single_command(line, x_min, x_max, step);
+    arenaDestroy(scratch);
+    free(line);
+}
+
+// Parses and optimizes stored expression `slot` in an arena of its own and
+// tracks the names it uses.  Returns 0 if it does not parse.
+int build_multi_function(int slot, const char *input) {
+    ASTArena *arena = arenaCreate();
+    arenaSwitch(arena);
+    STATS_START(parse_start);
+    ASTNode *parsed_node = parse_expression_from_string(input);
+    if (!parsed_node) {
+        arenaDestroy(arena);
+        return 0;  // Error already printed
+    }
+    STATS_BEGIN(input, parse_start);
+    STATS_PHASE(PHASE_PARSE, parse_start);
+    depgraphTrack(slot, parsed_node);
+    STATS_START(optimize_start);
+    parsed_node = hashConsAST(simplifyAST(optimizeAST(inlineAST(parsed_node))));
+    STATS_PHASE(PHASE_OPTIMIZE, optimize_start);
+    arenaSwitch(NULL);
+    STATS_START(tac_start);
+    tacFree(multi_tac[slot]);
+    multi_tac[slot] = build_tac(parsed_node);
+    STATS_PHASE(PHASE_TAC, tac_start);
+    if (slot < multi_func_count) {
+        arenaDestroy(multi_arenas[slot]);
+    }
+    if (input != multi_func_names[slot]) {
+        free(multi_func_names[slot]);
+        multi_func_names[slot] = strdup(input);
+    }
+    multi_functions[slot] = parsed_node;
+    multi_arenas[slot] = arena;
+    STATS_END();
+    return 1;
+}
+
+// After a let or def: stored expressions that use a changed name are
+// rebuilt, since def bodies were inlined into them, and the plot showing
+// any changed expression is redrawn.  Curves that did not change come
+// from the sample cache.
+void refresh_stale(double x_min, double x_max, double step) {
+    int stale[DEPGRAPH_MAX_EXPRS];
+    int n = depgraphTakeStale(stale, DEPGRAPH_MAX_EXPRS);
+    int multi_stale = 0, single_stale = 0;
+    for (int k = 0; k < n; k++) {
+        if (stale[k] == DEP_SINGLE_PLOT) {
+            single_stale = 1;
+        } else if (stale[k] < multi_func_count) {
+            if (!multi_stale) printf("Changed:");
+            printf(" f%d", stale[k]);
+            build_multi_function(stale[k], multi_func_names[stale[k]]);
+            multi_stale++;
+        }
+    }
+    if (multi_stale) printf("\n");
+
+    int redraw = (shown_plot == SHOWN_MULTI && multi_stale) ||
+                 (shown_plot == SHOWN_SINGLE && single_stale);
+    if (!redraw) return;
+    if (!autoreplot) {
+        printf("\033[1;33mThe plot is out of date\033[0m (autoreplot is off)\n");
+    } else if (shown_plot == SHOWN_MULTI) {
+        plot_all_multi_functions(x_min, x_max, step);
+    } else {
+        printf("Redrawing %s\n", single_plot_input);
+        run_scratch_command(single_plot_input, x_min, x_max, step);
     }
+}
 
-    return root;
+void print_prompt() {
+    if (multi_mode && multi_func_count < MAX_MULTI_FUNCTIONS) {
+        printf("f%d(x) = ", multi_func_count);
+    } else {
+        printf("\033[1;32m>\033[0m ");
+    }
+    fflush(stdout);
+}
+
+// On a terminal, the prompt waits for input with poll().  Meanwhile it
+// reports a plot that finished in the background, and once none is in
+// flight, follows zooming and panning in the plot window.
+void wait_for_input() {
+    if (!interactive) return;
+    struct pollfd p[2] = {{STDIN_FILENO, POLLIN, 0}, {pipelineFd(), POLLIN, 0}};
+    for (;;) {
+        int busy = pipelineBusy();
+        if (!busy && !viewportActive()) return;
+        int ready = poll(p, 2, busy ? -1 : VIEW_POLL_MS);
+        if (ready < 0 || p[0].revents) return;
+        if (p[1].revents) {
+            printf("\n");
+            pipelineCollect();
+            print_prompt();
+        } else if (ready == 0) {
+            viewportPoll();
+        }
+    }
+}
+
+int is_number(const char *s) {
+    char *end;
+    strtod(s, &end);
+    return end != s && *end == '\0';
+}
+
+void print_usage(void) {
+    fprintf(stderr, "Usage: ./graph_compiler [<min> <max> [<step>]]\n"
+                    "       ./graph_compiler --batch [script|-] [--out <dir>] [--summary]\n"
+                    "                        [--backend <name>] [<min> <max> [<step>]]\n");
 }
 
 int main(int argc, char *argv[]) {
     double x_min = -10.0;
     double x_max = 10.0;
     double step = 0.1;
+    BatchOptions batch = {0};
+    int batch_mode = 0;
 
-    // Parse command line arguments for range
-    if (argc >= 3) {
-        x_min = atof(argv[1]);
-        x_max = atof(argv[2]);
+    // Options, then the range: <min> <max> [<step>]
+    double range[3];
+    int n_range = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--batch") == 0) {
+            batch_mode = 1;
+            if (next && strncmp(next, "--", 2) != 0 && !is_number(next)) batch.script = argv[++i];
+        } else if (strcmp(arg, "--out") == 0 && next) {
+            batch.out_dir = argv[++i];
+        } else if (strcmp(arg, "--summary") == 0) {
+            batch.summary = 1;
+        } else if (strcmp(arg, "--backend") == 0 && next && find_backend(next) >= 0) {
+            backend = (Backend)find_backend(argv[++i]);
+        } else if (is_number(arg) && n_range < 3) {
+            range[n_range++] = atof(arg);
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (n_range == 1) {
+        print_usage();
+        return 2;
+    }
+    if (n_range >= 2) {
+        x_min = range[0];
+        x_max = range[1];
+    }
+    if (n_range == 3) {
+        step = range[2];
     }
-    if (argc >= 4) {
-        step = atof(argv[3]);
+
+    if (batch_mode) {
+        if (!(step > 0) || !(x_max >= x_min)) {
+            fprintf(stderr, "The range needs <min> <= <max> and a positive step.\n");
+            return 2;
+        }
+        batch.x_min = x_min;
+        batch.x_max = x_max;
+        batch.step = step;
+        return runBatch(&batch) ? 1 : 0;
     }
 
+    // Unbuffered, so poll() sees every line that has not been read yet
+    interactive = isatty(STDIN_FILENO);
+    if (interactive) setvbuf(stdin, NULL, _IONBF, 0);
+
     print_banner();
     printf("Plot range: [%.2f, %.2f] with step %.3f\n", x_min, x_max, step);
     printf("(Use: ./graph_compiler <min> <max> <step> to change)\n\n");
     print_mode_status();
     printf("\n");
 
+    char *input = NULL;
+    size_t input_cap = 0;
     while (1) {
-        // Print appropriate prompt based on mode
-        if (multi_mode) {
-            if (multi_func_count < MAX_MULTI_FUNCTIONS) {
-                printf("f%d(x) = ", multi_func_count);
-            } else {
-                printf("\033[1;32m>\033[0m ");
-            }
-        } else {
-            printf("\033[1;32m>\033[0m ");
-        }
-        fflush(stdout);
-        
-        char input[256];
-        if (!fgets(input, sizeof(input), stdin)) {
+        // A plot that finished while the last command ran reports first
+        pipelineCollect();
+        print_prompt();
+        wait_for_input();
+
+        if (getline(&input, &input_cap, stdin) < 0) {
             break;
         }
 
@@ -292,6 +1115,8 @@ int main(int argc, char *argv[]) {
         // ===== COMMON COMMANDS =====
         if (strcmp(input, "quit") == 0 || strcmp(input, "exit") == 0) {
             clear_multi_functions();
+            viewportRelease();
+            closePlotter();
             printf("Goodbye!\n");
             break;
         }
@@ -301,6 +1126,64 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
+        if (strcmp(input, "backend") == 0 || strncmp(input, "backend ", 8) == 0) {
+            set_backend(input[7] ? input + 8 : "");
+            continue;
+        }
+
+        if (strcmp(input, "output") == 0 || strncmp(input, "output ", 7) == 0) {
+            set_output(input[6] ? input + 7 : "");
+            continue;
+        }
+
+        if (strcmp(input, "sampling") == 0 || strncmp(input, "sampling ", 9) == 0) {
+            set_sampling(input[8] ? input + 9 : "");
+            continue;
+        }
+
+        if (strcmp(input, "decimate") == 0 || strncmp(input, "decimate ", 9) == 0) {
+            set_decimate(input[8] ? input + 9 : "");
+            continue;
+        }
+
+        // The plot in flight uses the sample cache and the loaded exports
+        if (strcmp(input, "cache") == 0 || strncmp(input, "cache ", 6) == 0) {
+            pipelineWait();
+            set_cache(input[5] ? input + 6 : "");
+            continue;
+        }
+
+        if (strcmp(input, "autoreplot") == 0 || strncmp(input, "autoreplot ", 11) == 0) {
+            set_autoreplot(input[10] ? input + 11 : "");
+            continue;
+        }
+
+        if (strcmp(input, "tac") == 0 || strncmp(input, "tac ", 4) == 0) {
+            run_tac_command(input[3] ? input + 4 : "");
+            continue;
+        }
+
+        if (strcmp(input, "export") == 0 || strncmp(input, "export ", 7) == 0) {
+            run_export(input[6] ? input + 7 : input + 6);
+            continue;
+        }
+
+        if (strcmp(input, "load") == 0 || strncmp(input, "load ", 5) == 0) {
+            pipelineWait();
+            run_load(input[4] ? input + 5 : "");
+            continue;
+        }
+
+        if (strcmp(input, "stats") == 0 || strncmp(input, "stats ", 6) == 0) {
+            statsCommand(input[5] ? input + 6 : "");
+            continue;
+        }
+
+        if (strcmp(input, "ylimits") == 0 || strncmp(input, "ylimits ", 8) == 0) {
+            set_ylimits(input[7] ? input + 8 : "");
+            continue;
+        }
+
         // ===== MULTI-MODE COMMANDS =====
         if (multi_mode) {
             if (strcmp(input, "list") == 0) {
@@ -318,56 +1201,33 @@ int main(int argc, char *argv[]) {
                 continue;
             }
 
-            if (strcmp(input, "tac") == 0) {
-                FILE *f = fopen("tac.txt", "r");
-                if (!f){
-                    perror("Error opening file");
-                }
-                else{
-                    int c;
-                    while ((c = fgetc(f)) != EOF){
-                    putchar(c);
-                    }
-                    fclose(f);
-                }
+            // Definitions are shared with single mode; stored expressions
+            // that use them are rebuilt
+            if (strncmp(input, "let ", 4) == 0 || strncmp(input, "def ", 4) == 0) {
+                run_scratch_command(input, x_min, x_max, step);
+                refresh_stale(x_min, x_max, step);
                 continue;
             }
 
             // Multi-mode: Check for invalid commands
             if (strcmp(input, "vars") == 0 || strcmp(input, "funcs") == 0 || 
-                strncmp(input, "show ", 5) == 0 || strncmp(input, "let ", 4) == 0 || 
-                strncmp(input, "def ", 4) == 0 || strncmp(input, "ast ", 4) == 0) {
+                strncmp(input, "show ", 5) == 0 || strncmp(input, "ast ", 4) == 0) {
                 printf("\033[1;33mCommand '%s' only available in single-function mode.\033[0m\n", input);
                 printf("Type 'mode' to switch.\n");
                 continue;
             }
 
-            // Parse and store expression in multi-mode
-            ASTNode *parsed_node = parse_expression_from_string(input);
-            if (!parsed_node) {
-                continue;  // Error already printed
-            }
-
             if (multi_func_count >= MAX_MULTI_FUNCTIONS) {
                 printf("Maximum functions (%d) reached! Type 'plot', 'clear', or 'quit'.\n", 
                        MAX_MULTI_FUNCTIONS);
-                freeAST(parsed_node);
                 continue;
             }
             
-            FILE *tacOut = fopen("tac.txt", "a");
-            if (!tacOut) {
-                perror("tac.txt");
-                freeAST(root);
+            // Parse, optimize and store
+            int stored = build_multi_function(multi_func_count, input);
+            if (!stored) {
                 continue;
             }
-            generateTAC(root, tacOut);
-            fclose(tacOut);
-
-            // Optimize and store
-            parsed_node = optimizeAST(parsed_node);
-            strcpy(multi_func_names[multi_func_count], input);
-            multi_functions[multi_func_count] = parsed_node;
             multi_func_count++;
 
             printf("\033[1;32m✓\033[0m Function f%d(x) added. ", multi_func_count - 1);
@@ -393,48 +1253,13 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
-        // Use standard parser for single mode (supports let, def, vars, funcs, show, ast)
-        root = NULL;
-        error_occurred = 0;
-
-        // Need to feed input through parser
-        YY_BUFFER_STATE buffer = yy_scan_string(strcat(input, "\n"));
-        int result = yyparse();
-        yy_delete_buffer(buffer);
-
-        if (error_occurred) {
-            printf("\033[1;31mSyntax error. Please try again.\033[0m\n");
-            continue;
-        }
-
-        if (result != 0) {
-            continue;
-        }
-
-        // If we got an expression (not a command), plot it
-        if (root) {
-            root = optimizeAST(root);
-            
-            if (!validateAST(root)) {
-                freeAST(root);
-                continue;
-            }
-
-            
-            tac_reset();
-            FILE *tacOut = fopen("tac.txt", "w");
-            if (!tacOut) {
-                perror("tac.txt");
-                freeAST(root);
-                continue;
-            }
-            generateTAC(root, tacOut);
-            fclose(tacOut);
-
-            plot_single_function(root, x_min, x_max, step);
-            freeAST(root);
-        }
+        run_scratch_command(input, x_min, x_max, step);
+        refresh_stale(x_min, x_max, step);
     }
 
+    free(input);
+    pipelineCancel();
+    viewportRelease();
+    closePlotter();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include "native.h"
+#include "symtab.h"
+#include "tac.h"
+
+#define NATIVE_MAX_LIBS 32
+
+typedef struct {
+    char                path[256];
+    dev_t               dev;
+    ino_t               ino;
+    const NativeExport *exports;
+    int                 count;
+} NativeLib;
+
+static NativeLib libs[NATIVE_MAX_LIBS];
+static int       n_libs;
+
+int nativeLoad(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return 0;
+    }
+    // dlopen() hands back the library it already has for a path, so a
+    // rebuilt file cannot replace the loaded one
+    for (int i = 0; i < n_libs; i++) {
+        if (strcmp(libs[i].path, path) != 0) continue;
+        if (libs[i].dev == st.st_dev && libs[i].ino == st.st_ino) {
+            printf("%s is already loaded.\n", path);
+        } else {
+            fprintf(stderr, "\033[1;31mError: %s changed since it was loaded; "
+                            "export to a new file name to load it again\033[0m\n", path);
+        }
+        return 0;
+    }
+    if (n_libs == NATIVE_MAX_LIBS) {
+        fprintf(stderr, "\033[1;31mError: at most %d libraries can be loaded\033[0m\n",
+                NATIVE_MAX_LIBS);
+        return 0;
+    }
+
+    // Without a slash dlopen() would search the library path instead
+    char local[264];
+    snprintf(local, sizeof(local), "%s%s", strchr(path, '/') ? "" : "./", path);
+    void *handle = dlopen(local, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "\033[1;31mError: %s\033[0m\n", dlerror());
+        return 0;
+    }
+    const int *version = dlsym(handle, "gc_export_version");
+    const int *count = dlsym(handle, "gc_export_count");
+    const NativeExport *exports = dlsym(handle, "gc_exports");
+    if (!version || !count || !exports || *version != NATIVE_ABI_VERSION) {
+        fprintf(stderr, "\033[1;31mError: %s was not built by this version of export\033[0m\n",
+                path);
+        dlclose(handle);
+        return 0;
+    }
+
+    NativeLib *lib = &libs[n_libs++];
+    snprintf(lib->path, sizeof(lib->path), "%s", path);
+    lib->dev = st.st_dev;
+    lib->ino = st.st_ino;
+    lib->exports = exports;
+    lib->count = *count;
+    return lib->count;
+}
+
+int nativeCount(void) {
+    int n = 0;
+    for (int i = 0; i < n_libs; i++) n += libs[i].count;
+    return n;
+}
+
+/* The most recently loaded function with this hash.  Linked code has no
+ * names, so only functions exported with constants can match it. */
+static const NativeExport* find(unsigned long long hash) {
+    for (int i = n_libs - 1; i >= 0; i--) {
+        for (int k = 0; k < libs[i].count; k++) {
+            const NativeExport *e = &libs[i].exports[k];
+            if (e->hash == hash) return e;
+        }
+    }
+    return NULL;
+}
+
+static unsigned long long codeHash(const ASTNode *node) {
+    TacProgram *p = tacLower(node);
+    tacOptimize(p);
+    unsigned long long h = tacHash(p);
+    tacFree(p);
+    return h;
+}
+
+const NativeExport* nativeMatch(const ASTNode *node, const ASTNode *linked, double **params) {
+    *params = NULL;
+    if (n_libs == 0) return NULL;
+    const NativeExport *e = find(codeHash(node));
+    if (e) {
+        // Variables are read once per sweep, as the linker does
+        *params = malloc(e->n_params * sizeof(double));
+        for (int i = 0; i < e->n_params; i++) {
+            double *v = lookupVariable(e->params[i]);
+            if (!v) {
+                free(*params);
+                *params = NULL;
+                e = NULL;
+                break;
+            }
+            (*params)[i] = *v;
+        }
+        if (e) return e;
+    }
+    return find(codeHash(linked));
+}
@@ -0,0 +1,35 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include "ast.h"
+
+/* Functions loaded from shared libraries built by `export`.  A library
+ * lists its functions in a table, gc_exports; an expression is sampled
+ * natively when its optimized code hashes like one of them.  Libraries
+ * stay loaded for the rest of the run, since samplers may still use them. */
+
+/* Layout of the table entries; cexport.c writes the same struct. */
+#define NATIVE_ABI_VERSION 1
+
+typedef void (*NativeEval)(const double *xs, double *ys, long n, const double *params);
+
+typedef struct {
+    const char         *name;
+    unsigned long long  hash;       /* tacHash() of the exported code */
+    int                 n_params;   /* variables passed in, 0 if folded in */
+    const char *const  *params;
+    NativeEval          eval;
+} NativeExport;
+
+/* Returns how many functions were loaded, 0 on failure (with the reason
+ * printed). */
+int nativeLoad(const char *path);
+int nativeCount(void);
+
+/* Looks for a loaded function that computes node: one exported with
+ * parameters matches the expression as written and gets the current
+ * values of its variables in *params (malloc'ed); one exported with
+ * constants matches the linked tree.  Returns NULL if there is none. */
+const NativeExport* nativeMatch(const ASTNode *node, const ASTNode *linked, double **params);
+
+#endif /* NATIVE_H */
@@ -0,0 +1,43 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "ast.h"
+
+/* One line of input, parsed.  The parser only builds the statement; what
+ * it does (storing a let or def, listing, printing a tree) is up to the
+ * caller, so the REPL, batch mode and the benchmark each run it their own
+ * way.
+ *
+ * Each call has a scanner and a parse of its own, and identifiers are
+ * interned under the symbol table's lock, so threads may parse at the same
+ * time.  Nodes come from the calling thread's current arena (see
+ * arenaSwitch()): a thread other than the main one must select an arena
+ * of its own before parsing, never the process-wide one. */
+
+typedef enum {
+    STMT_NONE,          /* blank line                                     */
+    STMT_EXPR,          /* an expression: node                            */
+    STMT_LET,           /* let name = node                                */
+    STMT_DEF,           /* def name = node                                */
+    STMT_AST,           /* ast node                                       */
+    STMT_VARS,
+    STMT_FUNCS,
+    STMT_SHOW,          /* show name                                      */
+    STMT_TAC,
+    STMT_QUIT
+} StatementKind;
+
+typedef struct {
+    StatementKind kind;
+    ASTNode      *node;         /* in the current arena */
+    char         *name;         /* malloc'd, freed by freeStatement() */
+    char          error[64];    /* why parseStatement() failed */
+} Statement;
+
+/* Parses text, one line with or without its newline.  Returns 1 and fills
+ * s, or 0 with s->error set; nodes built before the error are left to the
+ * arena. */
+int  parseStatement(const char *text, Statement *s);
+void freeStatement(Statement *s);
+
+#endif /* PARSER_H */
@@ -0,0 +1,202 @@
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pipeline.h"
+#include "sampler.h"
+#include "stats.h"
+
+typedef enum {
+    JOB_NONE,
+    JOB_RUNNING,
+    JOB_DONE        /* waiting to be collected */
+} JobState;
+
+static struct {
+    int              started;       /* 1: threads, -1: they failed, run inline */
+    pthread_mutex_t  lock;
+    pthread_cond_t   work, render, changed;
+    PipelineJob      job;
+    JobState         state;
+    int              cancelled;
+    unsigned long    submitted;     /* bumped for every job */
+    void            *record;        /* the job's stats record */
+
+    /* render stage */
+    int              frame;         /* waiting to be drawn, -1: none */
+    int              rendering;
+    double           last_frame;    /* statsNow() when one was last published */
+
+    int              fds[2];        /* a byte per job done */
+} line = { .fds = {-1, -1} };
+
+/* ---------- stages ---------------------------------------------------------- */
+
+static void* workerMain(void *arg) {
+    (void)arg;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&line.lock);
+    for (;;) {
+        while (line.submitted == seen) pthread_cond_wait(&line.work, &line.lock);
+        seen = line.submitted;
+        PipelineJob job = line.job;
+        STATS_ATTACH(line.record);
+        pthread_mutex_unlock(&line.lock);
+
+        job.work(job.ctx);
+
+        /* done once the final frame is drawn; a cancelled job only waits
+         * for the frame being drawn */
+        pthread_mutex_lock(&line.lock);
+        while ((line.frame >= 0 && !line.cancelled) || line.rendering)
+            pthread_cond_wait(&line.changed, &line.lock);
+        line.frame = -1;
+        STATS_END();
+        line.state = JOB_DONE;
+        ssize_t wrote = write(line.fds[1], "", 1);     /* wakes a poll() on pipelineFd() */
+        (void)wrote;
+        pthread_cond_broadcast(&line.changed);
+    }
+    return NULL;
+}
+
+static void* renderMain(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&line.lock);
+    for (;;) {
+        while (line.frame < 0) pthread_cond_wait(&line.render, &line.lock);
+        int frame = line.frame;
+        PipelineJob job = line.job;
+        line.frame = -1;
+        line.rendering = 1;
+        STATS_ATTACH(line.record);
+        pthread_mutex_unlock(&line.lock);
+
+        job.render(job.ctx, frame);
+
+        pthread_mutex_lock(&line.lock);
+        STATS_ATTACH(NULL);
+        line.rendering = 0;
+        pthread_cond_broadcast(&line.changed);
+    }
+    return NULL;
+}
+
+/* Starts both stages on first use.  Without threads, jobs run to the end
+ * when they are submitted. */
+static void startPipeline(void) {
+    if (line.started) return;
+    pthread_mutex_init(&line.lock, NULL);
+    pthread_cond_init(&line.work, NULL);
+    pthread_cond_init(&line.render, NULL);
+    pthread_cond_init(&line.changed, NULL);
+    line.frame = -1;
+    line.started = -1;
+    if (pipe(line.fds) != 0) return;
+    fcntl(line.fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(line.fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(line.fds[1], F_SETFD, FD_CLOEXEC);
+
+    pthread_t worker, renderer;
+    if (pthread_create(&worker, NULL, workerMain, NULL) != 0) return;
+    pthread_detach(worker);
+    if (pthread_create(&renderer, NULL, renderMain, NULL) != 0) return;    /* the worker idles */
+    pthread_detach(renderer);
+    line.started = 1;
+}
+
+/* ---------- jobs ------------------------------------------------------------ */
+
+void pipelineSubmit(const PipelineJob *job) {
+    startPipeline();
+    pipelineCancel();
+    if (line.started < 0) {
+        line.job = *job;
+        line.state = JOB_RUNNING;
+        job->work(job->ctx);
+        STATS_END();
+        line.state = JOB_DONE;
+        pipelineCollect();
+        return;
+    }
+    pthread_mutex_lock(&line.lock);
+    line.job = *job;
+    line.record = STATS_RECORD();
+    STATS_ATTACH(NULL);
+    line.state = JOB_RUNNING;
+    line.cancelled = 0;
+    line.frame = -1;
+    line.last_frame = statsNow();
+    line.submitted++;
+    pthread_cond_signal(&line.work);
+    pthread_mutex_unlock(&line.lock);
+}
+
+void pipelinePublish(int frame, int final) {
+    if (line.started < 0) {
+        if (final) line.job.render(line.job.ctx, frame);
+        return;
+    }
+    pthread_mutex_lock(&line.lock);
+    double now = statsNow();
+    if (!line.cancelled && (final || now - line.last_frame >= PIPELINE_FRAME_MS * 1e-3)) {
+        line.frame = frame;
+        line.last_frame = now;
+        pthread_cond_signal(&line.render);
+    }
+    pthread_mutex_unlock(&line.lock);
+}
+
+int pipelineCancelled(void) {
+    return __atomic_load_n(&line.cancelled, __ATOMIC_SEQ_CST);
+}
+
+void pipelineCancel(void) {
+    if (line.started <= 0) return;
+    pthread_mutex_lock(&line.lock);
+    if (line.state == JOB_RUNNING) {
+        __atomic_store_n(&line.cancelled, 1, __ATOMIC_SEQ_CST);
+        line.frame = -1;
+        sampleCancel(1);
+        while (line.state == JOB_RUNNING) pthread_cond_wait(&line.changed, &line.lock);
+        sampleCancel(0);
+    }
+    pthread_mutex_unlock(&line.lock);
+    pipelineCollect();
+}
+
+void pipelineWait(void) {
+    if (line.started <= 0) return;
+    pthread_mutex_lock(&line.lock);
+    while (line.state == JOB_RUNNING) pthread_cond_wait(&line.changed, &line.lock);
+    pthread_mutex_unlock(&line.lock);
+    pipelineCollect();
+}
+
+int pipelineCollect(void) {
+    if (!line.started) return 0;
+    if (line.started > 0) pthread_mutex_lock(&line.lock);
+    int done = line.state == JOB_DONE;
+    PipelineJob job = line.job;
+    int cancelled = line.cancelled;
+    if (done) {
+        char byte;
+        line.state = JOB_NONE;
+        line.cancelled = 0;
+        while (read(line.fds[0], &byte, 1) > 0) {}
+    }
+    if (line.started > 0) pthread_mutex_unlock(&line.lock);
+    if (done) job.finish(job.ctx, cancelled);
+    return done;
+}
+
+int pipelineBusy(void) {
+    if (line.started <= 0) return 0;
+    pthread_mutex_lock(&line.lock);
+    int busy = line.state != JOB_NONE;
+    pthread_mutex_unlock(&line.lock);
+    return busy;
+}
+
+int pipelineFd(void) {
+    return line.fds[0];
+}
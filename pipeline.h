@@ -0,0 +1,52 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/* Plots are built off the REPL thread.  The REPL parses, optimizes and
+ * links an expression, since the symbol table and the node arenas are
+ * its own, and submits the rest as a job: a worker thread compiles the
+ * samplers and samples the curves, and hands them to a render thread
+ * that draws them.  The prompt is back as soon as the job is submitted.
+ *
+ * One job is in flight at a time.  Submitting another cancels it: the
+ * sweep in progress skips its remaining chunks and no further frame is
+ * drawn.  A finished job is collected on the REPL thread, which runs its
+ * finish step, so results are reported and kept where the REPL owns them.
+ *
+ * A job may publish frames as it goes, e.g. one per finished curve of a
+ * multi-function plot.  The render thread draws the latest frame when it
+ * is free, so a fast job is drawn once and a slow one shows its first
+ * curves while the others are still being sampled. */
+
+typedef struct {
+    void  (*work)(void *ctx);                   /* worker thread */
+    void  (*render)(void *ctx, int frame);      /* render thread */
+    void  (*finish)(void *ctx, int cancelled);  /* REPL thread */
+    void   *ctx;
+} PipelineJob;
+
+/* Intermediate frames come at most this often; the last one always. */
+#define PIPELINE_FRAME_MS 100
+
+/* Cancels the job in flight, then starts this one.  The stats record open
+ * on the calling thread goes with the job and is closed when it ends. */
+void pipelineSubmit(const PipelineJob *job);
+
+/* From the job's work: hands frame to the render thread.  The final frame
+ * is drawn before the job counts as done. */
+void pipelinePublish(int frame, int final);
+/* From the job's work: 1 once the job is cancelled. */
+int  pipelineCancelled(void);
+
+/* These run on the REPL thread.  Cancel stops the job in flight and
+ * waits for it; wait lets it finish.  Both run its finish step. */
+void pipelineCancel(void);
+void pipelineWait(void);
+/* Runs the finish step of a job that is done; returns 1 if there was one. */
+int  pipelineCollect(void);
+/* 1 while a job has not been collected. */
+int  pipelineBusy(void);
+/* Readable when a job is done, for poll() next to stdin; -1 before the
+ * first job. */
+int  pipelineFd(void);
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include "plotter.h"
+#include "stats.h"
+
+static FILE *gp = NULL;
+static int   reply_fd = -1;         /* read end of gnuplot's `set print` pipe */
+static char  reply[256];            /* a partial line of gnuplot's replies */
+static int   reply_len;
+static __thread FILE *log_out;      /* see plotterLog() */
+
+int curveOpenFile(Curve *c, const char *path, SampleLayout layout,
+                  long capacity, double x_min, double step) {
+    SampleFile *f = malloc(sizeof(SampleFile));
+    if (!sampleFileCreate(f, path, layout, capacity, x_min, step)) {
+        free(f);
+        return 0;
+    }
+    c->file = f;
+    return 1;
+}
+
+/* Stores a point that is kept; a NaN x is a break. */
+static void storePoint(void *ctx, double x, double y) {
+    Curve *c = ctx;
+    if (c->file) {
+        if (isnan(x)) {
+            sampleFileBreak(c->file);
+        } else {
+            sampleFileAdd(c->file, x, y);
+        }
+        c->n = c->file->count;
+        return;
+    }
+    if (isnan(x) && (c->n == 0 || isnan(c->xy[2 * c->n - 2]))) return;
+    if (c->n == c->cap) {
+        c->cap = c->cap ? c->cap * 2 : 1024;
+        c->xy = realloc(c->xy, c->cap * 2 * sizeof(double));
+    }
+    c->xy[2 * c->n] = x;
+    c->xy[2 * c->n + 1] = y;
+    c->n++;
+}
+
+static int isColumnsFile(const Curve *c) {
+    return c->file && c->file->layout == SAMPLES_COLUMNS;
+}
+
+void curveDecimate(Curve *c, DecimateMode mode, long width, double x_min, double x_max) {
+    if (mode == DECIMATE_OFF || isColumnsFile(c)) return;
+    c->dec = malloc(sizeof(Decimator));
+    decimatorInit(c->dec, mode, width, x_min, x_max, storePoint, c);
+}
+
+void curveAdd(Curve *c, double x, double y) {
+    if (isColumnsFile(c)) {
+        sampleFileAdd(c->file, x, y);
+        c->n = c->file->count;
+        return;
+    }
+    if (isnan(y) || isinf(y)) return;
+    if (c->dec) {
+        decimatorAdd(c->dec, x, y);
+    } else {
+        storePoint(c, x, y);
+    }
+}
+
+void curveBreak(Curve *c) {
+    if (c->dec) {
+        decimatorBreak(c->dec);
+    } else {
+        storePoint(c, NAN, NAN);
+    }
+}
+
+void curveFlush(Curve *c) {
+    if (!c->dec) return;
+    decimatorFinish(c->dec);
+    free(c->dec);
+    c->dec = NULL;
+}
+
+void curveFree(Curve *c) {
+    curveFlush(c);
+    if (c->file) {
+        if (c->file->map) sampleFileFinish(c->file);
+        free(c->file);
+        c->file = NULL;
+    }
+    free(c->xy);
+    c->xy = NULL;
+    c->n = c->cap = 0;
+}
+
+static FILE* openPlotter(void) {
+    if (gp) return gp;
+    /* a gnuplot that failed to start shows up as a broken pipe on write */
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(log_out ? log_out : stdout, "Launching gnuplot...\n");
+
+    // gnuplot inherits the write end of a pipe and sends its `print`
+    // output there; only gnuplot keeps it open
+    int fds[2] = {-1, -1};
+    if (pipe(fds) == 0) {
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    }
+    gp = popen("gnuplot -persist", "w");
+    if (fds[1] >= 0) close(fds[1]);
+    if (!gp) {
+        fprintf(stderr, "Error: Cannot launch gnuplot\n");
+        if (fds[0] >= 0) close(fds[0]);
+        return NULL;
+    }
+    reply_fd = fds[0];
+    reply_len = 0;
+    if (reply_fd >= 0) fprintf(gp, "set print '/dev/fd/%d'\n", fds[1]);
+    return gp;
+}
+
+void plotterLog(FILE *log) {
+    log_out = log;
+}
+
+void closePlotter(void) {
+    if (!gp) return;
+    pclose(gp);
+    gp = NULL;
+    if (reply_fd >= 0) close(reply_fd);
+    reply_fd = -1;
+}
+
+int plotterView(double *x_min, double *x_max) {
+    if (!gp || reply_fd < 0) return 0;
+    fprintf(gp, "print sprintf('view %%.17g %%.17g', GPVAL_X_MIN, GPVAL_X_MAX)\n");
+    fflush(gp);
+
+    // Keep the last complete answer; older ones are stale
+    int found = 0;
+    struct pollfd p = {reply_fd, POLLIN, 0};
+    while (poll(&p, 1, found ? 0 : PLOTTER_REPLY_MS) > 0) {
+        ssize_t got = read(reply_fd, reply + reply_len, sizeof(reply) - 1 - reply_len);
+        if (got <= 0) break;
+        reply_len += got;
+        reply[reply_len] = '\0';
+        char *line = reply, *end;
+        while ((end = strchr(line, '\n'))) {
+            *end = '\0';
+            double a, b;
+            if (sscanf(line, "view %lf %lf", &a, &b) == 2) {
+                *x_min = a;
+                *x_max = b;
+                found = 1;
+            }
+            line = end + 1;
+        }
+        reply_len -= line - reply;
+        memmove(reply, line, reply_len);
+        if (reply_len == sizeof(reply) - 1) reply_len = 0;    /* not a reply of ours */
+    }
+    return found;
+}
+
+int plotCurves(const char *title, Curve *curves, int n_curves) {
+    return plotCurvesRange(title, curves, n_curves, NAN, NAN, NAN, NAN);
+}
+
+int plotCurvesRange(const char *title, Curve *curves, int n_curves,
+                    double x_min, double x_max, double y_min, double y_max) {
+    // File-backed curves must be complete on disk before gnuplot reads them
+    int non_empty = 0;
+    for (int i = 0; i < n_curves; i++) {
+        curveFlush(&curves[i]);
+        SampleFile *f = curves[i].file;
+        if (f && f->map && !sampleFileFinish(f)) curves[i].n = 0;
+        non_empty += curves[i].n > 0;
+    }
+    if (non_empty == 0) return 0;
+
+    FILE *out = openPlotter();
+    if (!out) return 0;
+
+    fprintf(out, "set title '%s' font ',14'\n", title);
+    fprintf(out, "set xlabel 'x' font ',12'\n");
+    fprintf(out, "set ylabel 'f(x)' font ',12'\n");
+    fprintf(out, "set grid\n");
+    fprintf(out, "set key top left\n");
+    if (x_min < x_max) {
+        fprintf(out, "set xrange [%.17g:%.17g]\n", x_min, x_max);
+    } else {
+        fprintf(out, "set autoscale x\n");
+    }
+    if (y_min < y_max) {
+        fprintf(out, "set yrange [%.17g:%.17g]\n", y_min, y_max);
+    } else {
+        fprintf(out, "set autoscale y\n");
+    }
+
+    // One source per curve: a sample file, or '-' whose records follow
+    // the command in order
+    int plotted = 0;
+    fprintf(out, "plot ");
+    for (int i = 0; i < n_curves; i++) {
+        Curve *c = &curves[i];
+        if (c->n == 0) continue;
+        fprintf(out, "%s", plotted++ ? ", " : "");
+        if (!c->file) {
+            fprintf(out, "'-' binary record=(%ld) format='%%float64%%float64' using 1:2", c->n);
+        } else if (c->file->layout == SAMPLES_PAIRS) {
+            fprintf(out, "'%s' binary skip=%d record=(%ld) format='%%float64%%float64' "
+                         "endian=little using 1:2",
+                    c->file->path, SAMPLE_HEADER_SIZE, c->n);
+        } else {
+            // the y column alone; x follows from the point index
+            fprintf(out, "'%s' binary skip=%ld record=(%ld) format='%%float64' "
+                         "endian=little using (%.17g + $0 * %.17g):1",
+                    c->file->path, SAMPLE_HEADER_SIZE + c->n * (long)sizeof(double), c->n,
+                    c->file->x_min, c->file->step);
+        }
+        fprintf(out, " with lines linewidth 2 linecolor rgb '%s' title '%s'", c->color, c->title);
+    }
+    fprintf(out, "\n");
+    for (int i = 0; i < n_curves; i++) {
+        if (curves[i].n == 0 || curves[i].file) continue;
+        fwrite(curves[i].xy, 2 * sizeof(double), curves[i].n, out);
+        STATS_COUNT(COUNTER_BYTES, curves[i].n * 2 * (long)sizeof(double));
+    }
+    fflush(out);
+
+    if (ferror(out)) {
+        fprintf(stderr, "Warning: gnuplot command failed. Is gnuplot installed?\n");
+        closePlotter();
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,69 @@
+#ifndef PLOTTER_H
+#define PLOTTER_H
+
+#include <stdio.h>
+#include "samplefile.h"
+#include "decimate.h"
+
+/* One gnuplot process serves the whole session.  Curves are streamed to it
+ * over the pipe as inline binary records (two float64 per point), or,
+ * when they are backed by a sample file, gnuplot reads that file with
+ * matching binary format specifiers.  No number is formatted as text. */
+
+typedef struct {
+    double     *xy;         /* x0 y0 x1 y1 ... (in-memory curves) */
+    long        n, cap;     /* points */
+    char        title[128];
+    const char *color;      /* gnuplot rgb string, e.g. "#0072BD" */
+    SampleFile *file;       /* NULL: samples are kept in xy */
+    Decimator  *dec;        /* NULL: every point is kept */
+} Curve;
+
+/* Sends the curve's samples to a sample file instead of memory; capacity
+ * is the number of points that will be added.  Returns 0 on failure, and
+ * the curve stays in memory. */
+int  curveOpenFile(Curve *c, const char *path, SampleLayout layout,
+                   long capacity, double x_min, double step);
+
+/* Reduces the points added from here on to what `width` pixel columns
+ * over [x_min, x_max] can show.  Call after curveOpenFile(); COLUMNS files
+ * are not decimated, as their x values follow from the point index. */
+void curveDecimate(Curve *c, DecimateMode mode, long width, double x_min, double x_max);
+
+/* Adds a point.  NaN and Inf are dropped, except by COLUMNS files, which
+ * keep one entry per sweep point. */
+void curveAdd(Curve *c, double x, double y);
+
+/* Ends the current line segment: gnuplot does not connect the points on
+ * either side of a NaN pair.  Ignored by COLUMNS files. */
+void curveBreak(Curve *c);
+
+/* Passes on the points a decimator still holds; n is final afterwards.
+ * plotCurves() does this for every curve. */
+void curveFlush(Curve *c);
+void curveFree(Curve *c);
+
+/* Draws the curves in one plot, replacing the previous one.  Starts
+ * gnuplot on first use; returns 0 if it is not available. */
+int  plotCurves(const char *title, Curve *curves, int n_curves);
+
+/* The same with the axes fixed to [x_min, x_max] and [y_min, y_max]
+ * instead of autoscaled; an empty range (e.g. NaN) autoscales its axis. */
+int  plotCurvesRange(const char *title, Curve *curves, int n_curves,
+                     double x_min, double x_max, double y_min, double y_max);
+
+/* Asks gnuplot for the x-range the plot window shows now, after any
+ * zooming or panning with the mouse.  gnuplot answers through a pipe it
+ * inherited; returns 0 if no answer came within PLOTTER_REPLY_MS. */
+#define PLOTTER_REPLY_MS 100
+int  plotterView(double *x_min, double *x_max);
+
+/* Where this thread's plots say what they do, such as starting gnuplot;
+ * NULL: stdout.  The render thread reports into the plot's job, so
+ * nothing is written over the prompt. */
+void plotterLog(FILE *log);
+
+/* Ends the session's gnuplot process; plot windows stay open. */
+void closePlotter(void);
+
+#endif /* PLOTTER_H */
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "samplecache.h"
+
+#define CACHE_BUCKETS 1024  /* power of two */
+
+#define CACHE_MAGIC   "GCSCACHE"
+#define CACHE_VERSION 1
+
+typedef struct Entry {
+    SampleKey     key;
+    double       *values;
+    long          n;
+    long          evaluations;
+    struct Entry *chain;            /* next in the hash bucket */
+    struct Entry *newer, *older;    /* LRU list */
+} Entry;
+
+/* One entry in a cache file, followed by its n values */
+typedef struct {
+    unsigned long long expr;
+    unsigned int       kind;
+    unsigned int       reserved;
+    double             x_min, x_max, step;
+    long long          n, evaluations;
+} EntryRecord;
+
+static Entry  *buckets[CACHE_BUCKETS];
+static Entry  *newest, *oldest;
+static long    n_entries;
+static size_t  used;
+static size_t  budget = SAMPLE_CACHE_BUDGET;
+static long    hits, misses;
+
+static size_t bucketOf(const SampleKey *k) {
+    unsigned long long h = k->expr;
+    const double *d[3] = {&k->x_min, &k->x_max, &k->step};
+    for (int i = 0; i < 3; i++) {
+        unsigned long long bits;
+        memcpy(&bits, d[i], sizeof(bits));
+        h = (h ^ bits) * 1099511628211ULL;
+    }
+    h = (h ^ (unsigned long long)k->kind) * 1099511628211ULL;
+    return (size_t)(h ^ (h >> 29)) & (CACHE_BUCKETS - 1);
+}
+
+static int sameKey(const SampleKey *a, const SampleKey *b) {
+    return a->expr == b->expr && a->kind == b->kind &&
+           a->x_min == b->x_min && a->x_max == b->x_max && a->step == b->step;
+}
+
+static size_t entryBytes(long n) {
+    return (size_t)n * sizeof(double);
+}
+
+static void unlinkLRU(Entry *e) {
+    if (e->newer) e->newer->older = e->older; else newest = e->older;
+    if (e->older) e->older->newer = e->newer; else oldest = e->newer;
+}
+
+static void pushNewest(Entry *e) {
+    e->newer = NULL;
+    e->older = newest;
+    if (newest) newest->newer = e; else oldest = e;
+    newest = e;
+}
+
+static Entry* findEntry(const SampleKey *key) {
+    for (Entry *e = buckets[bucketOf(key)]; e; e = e->chain)
+        if (sameKey(&e->key, key)) return e;
+    return NULL;
+}
+
+static void dropEntry(Entry *e) {
+    Entry **p = &buckets[bucketOf(&e->key)];
+    while (*p != e) p = &(*p)->chain;
+    *p = e->chain;
+    unlinkLRU(e);
+    used -= entryBytes(e->n);
+    n_entries--;
+    free(e->values);
+    free(e);
+}
+
+static void evictTo(size_t bytes) {
+    while (oldest && used > bytes) dropEntry(oldest);
+}
+
+const double* sampleCacheFind(const SampleKey *key, long *n, long *evaluations) {
+    Entry *e = findEntry(key);
+    if (!e) {
+        misses++;
+        return NULL;
+    }
+    hits++;
+    unlinkLRU(e);
+    pushNewest(e);
+    *n = e->n;
+    if (evaluations) *evaluations = e->evaluations;
+    return e->values;
+}
+
+int sampleCacheFits(long n) {
+    return n > 0 && entryBytes(n) <= budget;
+}
+
+void sampleCacheStore(const SampleKey *key, double *values, long n, long evaluations) {
+    if (!sampleCacheFits(n)) {
+        free(values);
+        return;
+    }
+    Entry *old = findEntry(key);
+    if (old) dropEntry(old);
+    evictTo(budget - entryBytes(n));
+
+    Entry *e = malloc(sizeof(Entry));
+    e->key = *key;
+    e->values = values;
+    e->n = n;
+    e->evaluations = evaluations;
+    size_t b = bucketOf(key);
+    e->chain = buckets[b];
+    buckets[b] = e;
+    pushNewest(e);
+    used += entryBytes(n);
+    n_entries++;
+}
+
+void sampleCacheSetBudget(size_t bytes) {
+    budget = bytes;
+    evictTo(budget);
+}
+
+void sampleCacheClear(void) {
+    evictTo(0);
+}
+
+void sampleCacheStats(SampleCacheStats *stats) {
+    stats->entries = n_entries;
+    stats->bytes = used;
+    stats->budget = budget;
+    stats->hits = hits;
+    stats->misses = misses;
+}
+
+/* ---------- persistence ---------- */
+
+int sampleCacheSave(const char *path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        perror(tmp);
+        return 0;
+    }
+    unsigned int version = CACHE_VERSION;
+    int ok = fwrite(CACHE_MAGIC, 8, 1, f) == 1 && fwrite(&version, sizeof(version), 1, f) == 1;
+    // Oldest first, so a load leaves the same recency order
+    for (Entry *e = oldest; ok && e; e = e->newer) {
+        EntryRecord r = {e->key.expr, e->key.kind, 0, e->key.x_min, e->key.x_max,
+                         e->key.step, e->n, e->evaluations};
+        ok = fwrite(&r, sizeof(r), 1, f) == 1 &&
+             fwrite(e->values, sizeof(double), (size_t)e->n, f) == (size_t)e->n;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        perror(path);
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+int sampleCacheLoad(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    char magic[8];
+    unsigned int version;
+    if (fread(magic, 8, 1, f) != 1 || memcmp(magic, CACHE_MAGIC, 8) != 0 ||
+        fread(&version, sizeof(version), 1, f) != 1 || version != CACHE_VERSION) {
+        fprintf(stderr, "%s: not a sample cache file\n", path);
+        fclose(f);
+        return 0;
+    }
+    EntryRecord r;
+    int ok = 1;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (r.n <= 0 || r.kind > CACHED_ADAPTIVE) {
+            ok = 0;
+            break;
+        }
+        double *values = malloc(entryBytes((long)r.n));
+        if (!values || fread(values, sizeof(double), (size_t)r.n, f) != (size_t)r.n) {
+            free(values);
+            ok = 0;
+            break;
+        }
+        SampleKey key = {r.expr, (CachedKind)r.kind, r.x_min, r.x_max, r.step};
+        sampleCacheStore(&key, values, (long)r.n, (long)r.evaluations);
+    }
+    if (!ok) fprintf(stderr, "%s: truncated sample cache file\n", path);
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,56 @@
+#ifndef SAMPLECACHE_H
+#define SAMPLECACHE_H
+
+#include <stddef.h>
+
+/* Cache of sampled curves, so plotting an unchanged expression again only
+ * costs the rendering.  A curve is keyed by hashAST() of its linked tree,
+ * which holds the values of the variables it reads, together with how it
+ * was sampled.  Entries are dropped least recently used first when the
+ * cache grows beyond its memory budget. */
+
+typedef enum {
+    CACHED_UNIFORM,     /* y of every point of the sweep                    */
+    CACHED_ADAPTIVE     /* x y pairs; a NaN pair marks a break (step is 0)  */
+} CachedKind;
+
+typedef struct {
+    unsigned long long expr;
+    CachedKind         kind;
+    double             x_min, x_max, step;
+} SampleKey;
+
+typedef struct {
+    long   entries;
+    size_t bytes, budget;
+    long   hits, misses;
+} SampleCacheStats;
+
+#define SAMPLE_CACHE_BUDGET (256UL << 20)
+
+/* Returns the cached values for a key and sets *n (and *evaluations, if
+ * not NULL, to what sampling them cost), or NULL on a miss.  The values
+ * stay valid until the next store. */
+const double* sampleCacheFind(const SampleKey *key, long *n, long *evaluations);
+
+/* Whether n values fit the budget at all. */
+int  sampleCacheFits(long n);
+
+/* Takes ownership of n malloc'ed values for a key; they are freed at once
+ * if they do not fit the budget. */
+void sampleCacheStore(const SampleKey *key, double *values, long n, long evaluations);
+
+/* Evicts down to the new budget; 0 turns the cache off. */
+void sampleCacheSetBudget(size_t bytes);
+void sampleCacheClear(void);
+void sampleCacheStats(SampleCacheStats *stats);
+
+/* Writes all entries to a file, or adds the entries of one within the
+ * budget.  The values are stored in native byte order, and linked trees
+ * hash differently in other versions of the program, so a file is only
+ * meant for the build that wrote it.  Return 0 and print the reason on
+ * failure. */
+int  sampleCacheSave(const char *path);
+int  sampleCacheLoad(const char *path);
+
+#endif /* SAMPLECACHE_H */
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "samplefile.h"
+#include "stats.h"
+
+static void putU64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void putU32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static inline void putDouble(unsigned char *p, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    bits = __builtin_bswap64(bits);
+#endif
+    memcpy(p, &bits, sizeof(bits));
+}
+
+static size_t mappedSize(long capacity) {
+    return SAMPLE_HEADER_SIZE + (size_t)(capacity > 0 ? capacity : 1) * 2 * sizeof(double);
+}
+
+int sampleFileCreate(SampleFile *f, const char *path, SampleLayout layout,
+                     long capacity, double x_min, double step) {
+    char tmp[160];
+    memset(f, 0, sizeof(*f));
+    f->layout = layout;
+    f->capacity = capacity;
+    f->x_min = x_min;
+    f->step = step;
+    snprintf(f->path, sizeof(f->path), "%s", path);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    f->fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (f->fd < 0) {
+        perror(tmp);
+        return 0;
+    }
+    size_t size = mappedSize(capacity);
+    if (ftruncate(f->fd, (off_t)size) != 0) {
+        perror(tmp);
+        close(f->fd);
+        unlink(tmp);
+        return 0;
+    }
+    f->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+    if (f->map == MAP_FAILED) {
+        perror(tmp);
+        f->map = NULL;
+        close(f->fd);
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+void sampleFileAdd(SampleFile *f, double x, double y) {
+    if (f->count >= f->capacity) return;
+    unsigned char *data = f->map + SAMPLE_HEADER_SIZE;
+    if (f->layout == SAMPLES_PAIRS) {
+        if (isnan(y) || isinf(y)) return;
+        putDouble(data + f->count * 16, x);
+        putDouble(data + f->count * 16 + 8, y);
+    } else {
+        putDouble(data + f->count * 8, x);
+        putDouble(data + (f->capacity + f->count) * 8, isinf(y) ? NAN : y);
+    }
+    f->count++;
+}
+
+void sampleFileBreak(SampleFile *f) {
+    if (f->layout != SAMPLES_PAIRS || f->count >= f->capacity) return;
+    unsigned char *data = f->map + SAMPLE_HEADER_SIZE;
+    putDouble(data + f->count * 16, NAN);
+    putDouble(data + f->count * 16 + 8, NAN);
+    f->count++;
+}
+
+int sampleFileFinish(SampleFile *f) {
+    if (!f->map) return 0;
+    unsigned char *data = f->map + SAMPLE_HEADER_SIZE;
+    // Columns were laid out for the full capacity; close the gap
+    if (f->layout == SAMPLES_COLUMNS && f->count < f->capacity)
+        memmove(data + f->count * 8, data + f->capacity * 8, f->count * 8);
+
+    memset(f->map, 0, SAMPLE_HEADER_SIZE);
+    memcpy(f->map, "GCSAMPLE", 8);
+    putU32(f->map + 8, (uint32_t)f->layout);
+    putU32(f->map + 12, SAMPLE_HEADER_SIZE);
+    putU64(f->map + 16, (uint64_t)f->count);
+    putDouble(f->map + 24, f->x_min);
+    putDouble(f->map + 32, f->step);
+
+    munmap(f->map, mappedSize(f->capacity));
+    f->map = NULL;
+
+    char tmp[160];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", f->path);
+    int ok = ftruncate(f->fd, (off_t)(SAMPLE_HEADER_SIZE + f->count * 2 * sizeof(double))) == 0;
+    close(f->fd);
+    if (!ok || rename(tmp, f->path) != 0) {
+        perror(f->path);
+        unlink(tmp);
+        return 0;
+    }
+    STATS_COUNT(COUNTER_BYTES, SAMPLE_HEADER_SIZE + f->count * 2 * (long)sizeof(double));
+    return 1;
+}
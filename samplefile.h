@@ -0,0 +1,52 @@
+#ifndef SAMPLEFILE_H
+#define SAMPLEFILE_H
+
+/* Binary sample files, written through a memory mapping that is sized for
+ * the whole sweep up front.  Layout (all values little-endian):
+ *
+ *   0   char[8]   "GCSAMPLE"
+ *   8   uint32    layout (SAMPLES_PAIRS or SAMPLES_COLUMNS)
+ *   12  uint32    offset of the data (SAMPLE_HEADER_SIZE)
+ *   16  uint64    count, number of points
+ *   24  float64   x_min of the sweep
+ *   32  float64   step of the sweep
+ *   40            reserved, zero
+ *   64  data      PAIRS:   x0 y0 x1 y1 ...  (finite points only; a NaN
+ *                          pair marks a break in the curve)
+ *                 COLUMNS: x0 x1 ... then y0 y1 ...  (every point of the
+ *                          sweep; y is NaN where the function is undefined)
+ */
+
+#define SAMPLE_HEADER_SIZE 64
+
+typedef enum {
+    SAMPLES_PAIRS,
+    SAMPLES_COLUMNS
+} SampleLayout;
+
+typedef struct {
+    SampleLayout   layout;
+    char           path[128];   /* final name; written as path.tmp first */
+    int            fd;
+    unsigned char *map;
+    long           capacity;    /* points the mapping has room for */
+    long           count;
+    double         x_min, step;
+} SampleFile;
+
+/* Creates path.tmp and maps room for capacity points.  Returns 0 and
+ * prints the reason on failure. */
+int  sampleFileCreate(SampleFile *f, const char *path, SampleLayout layout,
+                      long capacity, double x_min, double step);
+
+/* Appends a point; PAIRS files drop NaN and Inf. */
+void sampleFileAdd(SampleFile *f, double x, double y);
+
+/* Appends a NaN pair to a PAIRS file, so the line is not drawn across it. */
+void sampleFileBreak(SampleFile *f);
+
+/* Writes the header, trims the file to its data and renames it to path,
+ * so a reader never sees a half-written file.  Returns 0 on failure. */
+int  sampleFileFinish(SampleFile *f);
+
+#endif /* SAMPLEFILE_H */
@@ -0,0 +1,340 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "sampler.h"
+#include "linker.h"
+#include "symtab.h"
+#include "interval.h"
+#include "stats.h"
+
+/* Upper bound on pool threads, whatever the core count. */
+#define MAX_SAMPLER_THREADS 256
+
+Backend backend = BACKEND_BATCH;
+
+/* ---------- samplers ------------------------------------------------------ */
+
+void prepareSampler(Sampler *s, ASTNode *node) {
+    linkSampler(s, node);
+    compileSampler(s);
+}
+
+/* Native exports are matched here, against the unlinked tree too, while
+ * node is still alive. */
+void linkSampler(Sampler *s, ASTNode *node) {
+    s->backend = backend;
+    s->generation = symtabGeneration();
+    s->node = linkASTDeps(node, &s->deps, &s->n_deps);
+    s->nodes = countAST(s->node);
+    s->prog = NULL;
+    s->jit = NULL;
+    s->tac = NULL;
+    s->native = NULL;
+    s->params = NULL;
+    if (s->backend == BACKEND_NATIVE) {
+        s->native = nativeMatch(node, s->node, &s->params);
+        if (!s->native) {
+            fprintf(stderr, "\033[1;33mNo loaded export computes this expression, using batch\033[0m\n");
+        }
+    }
+}
+
+void compileSampler(Sampler *s) {
+    if (s->backend == BACKEND_TAC) {
+        s->tac = tacLower(s->node);
+        tacOptimize(s->tac);
+    }
+    if (s->backend == BACKEND_JIT) {
+        s->jit = jitCompile(s->node);
+        if (!s->jit) {
+            fprintf(stderr, "\033[1;33mJIT unavailable for this expression, using the VM\033[0m\n");
+        }
+    }
+    if ((s->backend == BACKEND_VM || s->backend == BACKEND_JIT) && !s->jit) {
+        s->prog = compileProgram(s->node);
+    }
+}
+
+void releaseSampler(Sampler *s) {
+    jitFree(s->jit);
+    freeProgram(s->prog);
+    tacFree(s->tac);
+    free(s->params);
+    free(s->deps);
+    freeAST(s->node);
+}
+
+int samplerCurrent(const Sampler *s) {
+    if (symtabGeneration() == s->generation) return 1;     /* nothing stored at all */
+    for (int i = 0; i < s->n_deps; i++)
+        if (symbolGeneration(s->deps[i].name) != s->deps[i].generation) return 0;
+    return 1;
+}
+
+void evaluatePoints(const Sampler *s, const double *xs, double *ys, int n) {
+    if (s->native) {
+        s->native->eval(xs, ys, n, s->params);
+    } else if (s->jit) {
+        JitFunc fn = s->jit->fn;
+        for (int i = 0; i < n; i++) ys[i] = fn(xs[i]);
+    } else if (s->prog) {
+        for (int i = 0; i < n; i++) ys[i] = runProgram(s->prog, xs[i]);
+    } else if (s->tac) {
+        tacRun(s->tac, xs, ys, n);
+    } else if (s->backend != BACKEND_AST) {
+        evaluateBatch(s->node, xs, ys, n);
+    } else {
+        for (int i = 0; i < n; i++) ys[i] = evaluate(s->node, xs[i]);
+    }
+#ifndef NO_STATS
+    long nonfinite = 0;
+    for (int i = 0; i < n; i++) nonfinite += !isfinite(ys[i]);
+    statsCount(COUNTER_POINTS, n);
+    statsCount(COUNTER_NODES, (long)n * s->nodes);
+    statsCount(COUNTER_NONFINITE, nonfinite);
+#endif
+}
+
+/* ---------- sweeps -------------------------------------------------------- */
+
+long sweepPoints(double x_min, double x_max, double step) {
+    if (!(step > 0) || !(x_max >= x_min)) return 0;
+    /* the slack keeps x_max itself when (x_max - x_min)/step rounds down */
+    return (long)floor((x_max - x_min) / step + 1e-9) + 1;
+}
+
+/* Blocks of a sweep are halved down to this many points to skip the
+ * parts that interval evaluation proves undefined. */
+#define CULL_MIN_POINTS 64
+
+/* Evaluates xs[0..n), which ascend, except for blocks where every point
+ * is NaN: undefined regions cost one interval evaluation per block
+ * instead of a NaN per point.  Only blocks that may be partly undefined
+ * are split.  The ast backend evaluates every point, so it stays a plain
+ * reference for the others. */
+static void evaluateCulled(const Sampler *s, const double *xs, double *ys, int n) {
+    if (s->backend == BACKEND_AST) {
+        evaluatePoints(s, xs, ys, n);
+        return;
+    }
+    Interval v = evaluateInterval(s->node, xs[0], xs[n - 1]);
+    if (v.def == IV_EMPTY) {
+        for (int i = 0; i < n; i++) ys[i] = NAN;
+        STATS_COUNT(COUNTER_NONFINITE, n);
+        return;
+    }
+    if (v.def == IV_DEFINED || n < 2 * CULL_MIN_POINTS) {
+        evaluatePoints(s, xs, ys, n);
+        return;
+    }
+    int half = n / 2;
+    evaluateCulled(s, xs, ys, half);
+    evaluateCulled(s, xs + half, ys + half, n - half);
+}
+
+typedef struct {
+    int  func;          /* index into the sweep's samplers */
+    long start;         /* offset from the sweep's first point */
+    int  count;
+} Task;
+
+static void runTask(const Sampler *samplers, double x_min, double step, long first,
+                    double **ys, const Task *t) {
+    STATS_START(start);
+    double xs[EVAL_BATCH_SIZE];
+    for (int done = 0; done < t->count; done += EVAL_BATCH_SIZE) {
+        int n = t->count - done < EVAL_BATCH_SIZE ? t->count - done : EVAL_BATCH_SIZE;
+        long base = first + t->start + done;
+        for (int i = 0; i < n; i++) xs[i] = x_min + (double)(base + i) * step;
+        evaluateCulled(&samplers[t->func], xs, ys[t->func] + t->start + done, n);
+    }
+    STATS_SPAN("chunk", start);
+}
+
+/* Each worker owns a deque of tasks: it takes work from the front, in
+ * ascending x, and idle workers steal from the back.  Tasks never create
+ * tasks, so a worker that finds every deque empty is done. */
+typedef struct {
+    pthread_mutex_t lock;
+    Task *tasks;
+    int   head, tail;   /* pending tasks are [head, tail) */
+} Deque;
+
+static struct {
+    int              n_workers;     /* including the caller, which is worker 0 */
+    Deque           *deques;
+    pthread_mutex_t  lock;
+    pthread_cond_t   start, done;
+    unsigned long    job;           /* bumped for every parallel sweep */
+    int              running;       /* pool threads still in the current job */
+
+    /* the current job: a sweep, or items for each() when it is set */
+    const Sampler   *samplers;
+    double           x_min, step;
+    long             first;
+    double         **ys;
+    void           (*each)(void *ctx, int item, int worker);
+    void            *ctx;
+    int              n_items, next_item;
+    void            *record;        /* the caller's stats record */
+} pool;
+
+static int cancelled;
+
+void sampleCancel(int cancel) {
+    __atomic_store_n(&cancelled, cancel, __ATOMIC_SEQ_CST);
+}
+
+int sampleCancelled(void) {
+    return __atomic_load_n(&cancelled, __ATOMIC_SEQ_CST);
+}
+
+static int takeTask(int self, Task *out) {
+    Deque *d = &pool.deques[self];
+    pthread_mutex_lock(&d->lock);
+    int found = d->head < d->tail;
+    if (found) *out = d->tasks[d->head++];
+    pthread_mutex_unlock(&d->lock);
+    if (found) return 1;
+
+    for (int k = 1; k < pool.n_workers; k++) {
+        Deque *v = &pool.deques[(self + k) % pool.n_workers];
+        pthread_mutex_lock(&v->lock);
+        found = v->head < v->tail;
+        if (found) *out = v->tasks[--v->tail];
+        pthread_mutex_unlock(&v->lock);
+        if (found) return 1;
+    }
+    return 0;
+}
+
+static void work(int self) {
+    if (pool.each) {
+        int i;
+        while ((i = __atomic_fetch_add(&pool.next_item, 1, __ATOMIC_RELAXED)) < pool.n_items)
+            pool.each(pool.ctx, i, self);
+        return;
+    }
+    Task t;
+    while (!sampleCancelled() && takeTask(self, &t))
+        runTask(pool.samplers, pool.x_min, pool.step, pool.first, pool.ys, &t);
+}
+
+static void* workerMain(void *arg) {
+    int self = (int)(size_t)arg;
+    unsigned long seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.job == seen) pthread_cond_wait(&pool.start, &pool.lock);
+        seen = pool.job;
+        STATS_ATTACH(pool.record);
+        pthread_mutex_unlock(&pool.lock);
+
+        work(self);
+        STATS_ATTACH(NULL);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.running == 0) pthread_cond_signal(&pool.done);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    return NULL;
+}
+
+/* Starts the pool on first use.  Threads that fail to start are simply
+ * not counted. */
+static void startPool(void) {
+    if (pool.n_workers) return;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int want = cores < 1 ? 1 : cores > MAX_SAMPLER_THREADS ? MAX_SAMPLER_THREADS : (int)cores;
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.start, NULL);
+    pthread_cond_init(&pool.done, NULL);
+    pool.deques = calloc(want, sizeof(Deque));
+    pool.n_workers = 1;
+    for (int i = 1; i < want; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, workerMain, (void *)(size_t)i) != 0) break;
+        pthread_detach(thread);
+        pool.n_workers++;
+    }
+    for (int i = 0; i < pool.n_workers; i++)
+        pthread_mutex_init(&pool.deques[i].lock, NULL);
+}
+
+int samplerThreads(void) {
+    startPool();
+    return pool.n_workers;
+}
+
+/* Wakes the pool threads for the job set up in pool, works on it as
+ * worker 0 and returns once every thread is done. */
+static void runJob(void) {
+    pthread_mutex_lock(&pool.lock);
+    pool.record = STATS_RECORD();
+    pool.running = pool.n_workers - 1;
+    pool.job++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    work(0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.running > 0) pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+void sampleEach(void (*each)(void *ctx, int item, int worker), void *ctx, int n_items) {
+    if (n_items <= 0) return;
+    if (n_items == 1 || samplerThreads() == 1) {
+        for (int i = 0; i < n_items; i++) each(ctx, i, 0);
+        return;
+    }
+    pool.each = each;
+    pool.ctx = ctx;
+    pool.n_items = n_items;
+    pool.next_item = 0;
+    runJob();
+    pool.each = NULL;
+}
+
+void sampleSweep(const Sampler *samplers, int n_samplers,
+                 double x_min, double step, long first, long count, double **ys) {
+    if (n_samplers <= 0 || count <= 0) return;
+
+    long chunks = (count + SWEEP_CHUNK - 1) / SWEEP_CHUNK;
+    long n_tasks = chunks * n_samplers;
+    Task *tasks = malloc(n_tasks * sizeof(Task));
+    for (int f = 0; f < n_samplers; f++) {
+        for (long c = 0; c < chunks; c++) {
+            Task *t = &tasks[f * chunks + c];
+            t->func = f;
+            t->start = c * SWEEP_CHUNK;
+            t->count = (int)(count - t->start < SWEEP_CHUNK ? count - t->start : SWEEP_CHUNK);
+        }
+    }
+
+    if (n_tasks == 1 || samplerThreads() == 1) {
+        for (long i = 0; i < n_tasks && !sampleCancelled(); i++)
+            runTask(samplers, x_min, step, first, ys, &tasks[i]);
+        free(tasks);
+        return;
+    }
+
+    /* contiguous runs of tasks per worker, so a worker's own chunks are
+     * neighbours in x and in the output */
+    int workers = pool.n_workers;
+    for (int w = 0; w < workers; w++) {
+        Deque *d = &pool.deques[w];
+        d->tasks = tasks;
+        d->head = (int)(n_tasks * w / workers);
+        d->tail = (int)(n_tasks * (w + 1) / workers);
+    }
+
+    pool.samplers = samplers;
+    pool.x_min = x_min;
+    pool.step = step;
+    pool.first = first;
+    pool.ys = ys;
+    runJob();
+    free(tasks);
+}
@@ -0,0 +1,89 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "ast.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "tac.h"
+#include "native.h"
+#include "linker.h"
+
+/* Evaluation backends for the plot loops */
+typedef enum {
+    BACKEND_AST,    /* tree-walking evaluate(), kept as the reference     */
+    BACKEND_VM,     /* compiled bytecode, one point at a time              */
+    BACKEND_BATCH,  /* evaluateBatch(), one block of points at a time      */
+    BACKEND_JIT,    /* native x86-64 code, falls back to the VM            */
+    BACKEND_TAC,    /* optimized three-address code, a block at a time     */
+    BACKEND_NATIVE  /* a loaded export of the expression, else batch       */
+} Backend;
+
+extern Backend backend;
+
+/* An expression prepared for one sweep with the selected backend.  A
+ * prepared sampler is read-only, so any number of threads may evaluate
+ * it at once. */
+typedef struct {
+    Backend  backend;   /* selected when the sampler was linked */
+    ASTNode *node;      /* linked copy: no symbol lookups while sampling */
+    Program *prog;
+    JitCode *jit;
+    TacProgram *tac;
+    const NativeExport *native;
+    double  *params;    /* values of the native function's variables */
+    int      nodes;     /* distinct nodes of the linked tree, for stats */
+    LinkDep *deps;      /* the names it was linked against */
+    int      n_deps;
+    unsigned long long generation;  /* symtabGeneration() when linked */
+} Sampler;
+
+void prepareSampler(Sampler *s, ASTNode *node);
+void releaseSampler(Sampler *s);
+
+/* prepareSampler() in two steps.  Linking reads the symbol table and
+ * allocates nodes in the current arena, so it belongs to the thread that
+ * parses; compiling for the backend only reads the linked tree and may
+ * run on any thread. */
+void linkSampler(Sampler *s, ASTNode *node);
+void compileSampler(Sampler *s);
+
+/* 1 while no name the sampler was linked against has been stored since;
+ * a stale sampler still works but computes the old definitions. */
+int  samplerCurrent(const Sampler *s);
+
+/* Evaluates n points with the sampler's backend. */
+void evaluatePoints(const Sampler *s, const double *xs, double *ys, int n);
+
+/* ---- sweeps ------------------------------------------------------------- */
+/* A sweep samples x_i = x_min + i*step for 0 <= i < sweepPoints(...).  x
+ * comes from the index, not from a running sum, so every chunk sees the
+ * same x values whichever thread computes it. */
+long sweepPoints(double x_min, double x_max, double step);
+
+/* Points per task handed to a worker. */
+#define SWEEP_CHUNK 4096
+
+/* Fills ys[k][j] with sampler k at x_(first + j), 0 <= j < count, for all
+ * n_samplers samplers.  Chunks of every sampler go to one shared pool of
+ * threads (one per core) that steal work from each other; small sweeps
+ * run on the calling thread.  Results do not depend on the schedule. */
+void sampleSweep(const Sampler *samplers, int n_samplers,
+                 double x_min, double step, long first, long count, double **ys);
+
+/* Threads a sweep uses, counting the caller. */
+int  samplerThreads(void);
+
+/* Calls each(ctx, i, worker) once for every 0 <= i < n_items on the same
+ * pool, items handed out in order to whichever thread is free, and
+ * returns when all are done.  worker < samplerThreads() tells the threads
+ * apart, e.g. to give each an arena of its own; the caller is worker 0.
+ * Like a sweep, not to be called from inside another job. */
+void sampleEach(void (*each)(void *ctx, int item, int worker), void *ctx, int n_items);
+
+/* Stops sweeps from any thread: while set, sweeps skip the chunks they
+ * have not started and adaptive sampling stops refining, leaving their
+ * output incomplete.  For abandoning a plot nobody waits for. */
+void sampleCancel(int cancel);
+int  sampleCancelled(void);
+
+#endif /* SAMPLER_H */
@@ -0,0 +1,480 @@
+#include "simplify.h"
+
+/* Largest integer exponent rewritten as a multiply chain, and the largest
+ * polynomial degree turned into Horner form. */
+#define MAX_POWER_CHAIN   8
+#define MAX_HORNER_DEGREE 16
+
+/* Divisors below this are NaN at run time (see evaluate()); the simplifier
+ * leaves such divisions alone so validateAST() still reports them. */
+#define MIN_DIVISOR 1e-10
+
+static ASTNode* simplify(ASTNode *node);
+
+/* ---------- helpers ------------------------------------------------------- */
+
+static int isNum(ASTNode *n) {
+    return n && n->type == NODE_NUMBER;
+}
+
+static int isOp(ASTNode *n, char op) {
+    return n && n->type == NODE_OP && n->op == op;
+}
+
+static int isConstDivision(ASTNode *n) {
+    return isOp(n, '/') && isNum(n->right) && fabs(n->right->value) >= MIN_DIVISOR;
+}
+
+/* Frees a node whose children have been moved elsewhere. */
+static void freeShell(ASTNode *n) {
+    n->left = n->right = n->arg2 = NULL;
+    freeAST(n);
+}
+
+/* True when n can never evaluate to NaN or +/-Inf for finite x, so that
+ * 0 * n may be folded to 0.  Deliberately conservative: sums and products
+ * can overflow and are never accepted. */
+static int alwaysFinite(ASTNode *n) {
+    if (!n) return 1;
+    switch (n->type) {
+        case NODE_NUMBER: return isfinite(n->value);
+        case NODE_VAR:    return 1;
+        case NODE_OP:     return n->op == '~' && alwaysFinite(n->left);
+        case NODE_FUNC:
+            if (n->func == FN_SIN  || n->func == FN_COS  ||
+                n->func == FN_ATAN || n->func == FN_TANH ||
+                n->func == FN_ABS  || n->func == FN_SIGN ||
+                n->func == FN_CEIL || n->func == FN_FLOOR)
+                return alwaysFinite(n->left);
+            return 0;
+        case NODE_FUNC2:
+            return alwaysFinite(n->left) && alwaysFinite(n->right);
+        default:
+            return 0;
+    }
+}
+
+/* u^n as a multiply chain by repeated squaring; copies of u are merged
+ * again by hashConsAST(), so u itself is still computed once. */
+static ASTNode* powerChain(ASTNode *u, int n) {
+    if (n == 1) return u;
+    ASTNode *half = powerChain(copyAST(u), n / 2);
+    ASTNode *square = createOpNode('*', half, copyAST(half));
+    if (n % 2) return createOpNode('*', square, u);
+    freeAST(u);
+    return square;
+}
+
+/* ---------- chains of + - ~ and * / ~ ------------------------------------- */
+/* A chain is the maximal run of associative operators below a node.  Terms
+ * are recorded by the address of the child pointer holding them, so they
+ * can be simplified in place and the chain left as is when rebuilding it
+ * would not gain anything. */
+
+typedef struct {
+    ASTNode **slot;
+    int       negate;
+} Term;
+
+typedef struct {
+    Term     *terms;
+    int       n_terms, cap_terms;
+    ASTNode **shells;       /* interior nodes of the chain */
+    int       n_shells, cap_shells;
+    int       n_unary;      /* '~' nodes folded into term signs */
+    int       n_recip;      /* constant divisors folded into the factor */
+    double    divisor;      /* product of constant divisors */
+} Chain;
+
+static void addTerm(Chain *c, ASTNode **slot, int negate) {
+    if (c->n_terms == c->cap_terms) {
+        c->cap_terms = c->cap_terms ? c->cap_terms * 2 : 8;
+        c->terms = realloc(c->terms, c->cap_terms * sizeof(Term));
+    }
+    c->terms[c->n_terms].slot = slot;
+    c->terms[c->n_terms].negate = negate;
+    c->n_terms++;
+}
+
+static void addShell(Chain *c, ASTNode *node) {
+    if (c->n_shells == c->cap_shells) {
+        c->cap_shells = c->cap_shells ? c->cap_shells * 2 : 8;
+        c->shells = realloc(c->shells, c->cap_shells * sizeof(ASTNode *));
+    }
+    c->shells[c->n_shells++] = node;
+}
+
+static void freeChain(Chain *c) {
+    free(c->terms);
+    free(c->shells);
+}
+
+static void releaseShells(Chain *c) {
+    for (int i = 0; i < c->n_shells; i++) freeShell(c->shells[i]);
+}
+
+static void collectSum(ASTNode **slot, int negate, Chain *c) {
+    ASTNode *n = *slot;
+    if (isOp(n, '+') || isOp(n, '-')) {
+        addShell(c, n);
+        collectSum(&n->left, negate, c);
+        collectSum(&n->right, n->op == '-' ? !negate : negate, c);
+    } else if (isOp(n, '~')) {
+        addShell(c, n);
+        c->n_unary++;
+        collectSum(&n->left, !negate, c);
+    } else {
+        addTerm(c, slot, negate);
+    }
+}
+
+static void collectProduct(ASTNode **slot, int negate, Chain *c) {
+    ASTNode *n = *slot;
+    if (isOp(n, '*')) {
+        addShell(c, n);
+        collectProduct(&n->left, negate, c);
+        collectProduct(&n->right, negate, c);
+    } else if (isConstDivision(n)) {
+        addShell(c, n);
+        addShell(c, n->right);
+        c->n_recip++;
+        c->divisor *= n->right->value;
+        collectProduct(&n->left, negate, c);
+    } else if (isOp(n, '~')) {
+        addShell(c, n);
+        c->n_unary++;
+        collectProduct(&n->left, !negate, c);
+    } else {
+        addTerm(c, slot, negate);
+    }
+}
+
+/* Simplifies every term in place.  A term that comes back negated has the
+ * '~' moved into its sign; returns 1 if that happened. */
+static int simplifyTerms(Chain *c) {
+    int moved = 0;
+    for (int i = 0; i < c->n_terms; i++) {
+        ASTNode **slot = c->terms[i].slot;
+        *slot = simplify(*slot);
+        while (isOp(*slot, '~')) {
+            ASTNode *inner = (*slot)->left;
+            freeShell(*slot);
+            *slot = inner;
+            c->terms[i].negate = !c->terms[i].negate;
+            moved = 1;
+        }
+    }
+    return moved;
+}
+
+/* ---------- polynomials --------------------------------------------------- */
+
+/* Recognizes c * x^d built from numbers, x, *, ~, ^ with a non-negative
+ * integer exponent, and / by a constant. */
+static int monomial(ASTNode *n, double *coef, int *deg) {
+    double c1, c2;
+    int d1, d2;
+    switch (n->type) {
+        case NODE_NUMBER:
+            *coef = n->value;
+            *deg = 0;
+            return 1;
+        case NODE_VAR:
+            *coef = 1;
+            *deg = 1;
+            return 1;
+        case NODE_OP:
+            switch (n->op) {
+                case '~':
+                    if (!monomial(n->left, &c1, &d1)) return 0;
+                    *coef = -c1;
+                    *deg = d1;
+                    return 1;
+                case '*':
+                    if (!monomial(n->left, &c1, &d1) || !monomial(n->right, &c2, &d2)) return 0;
+                    if (d1 + d2 > MAX_HORNER_DEGREE) return 0;
+                    *coef = c1 * c2;
+                    *deg = d1 + d2;
+                    return 1;
+                case '/':
+                    if (!isConstDivision(n) || !monomial(n->left, &c1, &d1)) return 0;
+                    *coef = c1 / n->right->value;
+                    *deg = d1;
+                    return 1;
+                case '^': {
+                    if (!isNum(n->right)) return 0;
+                    double k = n->right->value;
+                    if (k < 0 || k > MAX_HORNER_DEGREE || k != floor(k)) return 0;
+                    if (!monomial(n->left, &c1, &d1) || d1 * (int)k > MAX_HORNER_DEGREE) return 0;
+                    *coef = pow(c1, k);
+                    *deg = d1 * (int)k;
+                    return 1;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static ASTNode* xPower(int n) {
+    return powerChain(createVarNode(), n);
+}
+
+/* Horner form c_n x^n + ... + c_0 -> fma(fma(c_n, x, c_n-1), x, ...).
+ * Runs of zero coefficients multiply by the matching power of x instead
+ * of by x once per missing term.  Needs at least two nonzero terms. */
+static ASTNode* horner(const double *coef, int deg) {
+    ASTNode *acc = NULL;
+    int k = deg;
+    for (int j = deg - 1; j >= 0; j--) {
+        if (coef[j] == 0) continue;
+        ASTNode *xp = xPower(k - j);
+        ASTNode *cj = createNumberNode(fabs(coef[j]));
+        if (acc) {
+            cj->value = coef[j];
+            acc = createFunc3Node(FN_FMA, acc, xp, cj);
+        } else if (coef[deg] == 1) {
+            acc = createOpNode(coef[j] < 0 ? '-' : '+', xp, cj);
+        } else if (coef[deg] == -1) {
+            cj->value = coef[j];
+            acc = createOpNode('-', cj, xp);
+        } else {
+            cj->value = coef[j];
+            acc = createFunc3Node(FN_FMA, createNumberNode(coef[deg]), xp, cj);
+        }
+        k = j;
+    }
+    if (k > 0) acc = createOpNode('*', acc, xPower(k));
+    return acc;
+}
+
+/* ---------- sums ---------------------------------------------------------- */
+
+static ASTNode* appendTerm(ASTNode *acc, ASTNode *term, int negate) {
+    if (!acc) return negate ? createOpNode('~', term, NULL) : term;
+    return createOpNode(negate ? '-' : '+', acc, term);
+}
+
+static ASTNode* simplifySum(ASTNode *node) {
+    Chain c;
+    memset(&c, 0, sizeof(c));
+    ASTNode *root = node;
+    collectSum(&root, 0, &c);
+    int moved = simplifyTerms(&c);
+
+    /* Split off monomials in x and the plain constants, noting per degree
+     * the signs of the terms and whether one may overflow for finite x */
+    double coef[MAX_HORNER_DEGREE + 1] = {0};
+    char pos[MAX_HORNER_DEGREE + 1] = {0}, neg[MAX_HORNER_DEGREE + 1] = {0};
+    char big[MAX_HORNER_DEGREE + 1] = {0};
+    int *in_poly = calloc(c.n_terms, sizeof(int));      /* degree + 1, 0 if not */
+    int n_const = 0, zero_const = 0;
+    double k = 0;
+    for (int i = 0; i < c.n_terms; i++) {
+        ASTNode *t = *c.terms[i].slot;
+        double mc;
+        int md;
+        if (isNum(t)) {
+            n_const++;
+            if (t->value == 0) zero_const = 1;
+            k += c.terms[i].negate ? -t->value : t->value;
+        }
+        if (monomial(t, &mc, &md)) {
+            in_poly[i] = md + 1;
+            double v = c.terms[i].negate ? -mc : mc;
+            coef[md] += v;
+            if (v >= 0) pos[md] = 1;        /* 0 * x^d counts as both */
+            if (v <= 0) neg[md] = 1;
+            if (md >= 2 || fabs(mc) > 1) big[md] = 1;
+        }
+    }
+    /* x^3 - x^3 is NaN where x^3 overflows, and 2*x^3 - 1.9*x^3 too, so
+     * terms that may overflow are only combined with terms of the same
+     * sign; otherwise their degree stays out of the polynomial. */
+    for (int d = 1; d <= MAX_HORNER_DEGREE; d++) {
+        if (!(big[d] && pos[d] && neg[d])) continue;
+        coef[d] = 0;
+        for (int i = 0; i < c.n_terms; i++)
+            if (in_poly[i] == d + 1) in_poly[i] = 0;
+    }
+    int deg = MAX_HORNER_DEGREE;
+    while (deg > 0 && coef[deg] == 0) deg--;
+    int nonzero = 0;
+    for (int d = 0; d <= deg; d++) nonzero += coef[d] != 0;
+
+    ASTNode *acc = NULL;
+    if (deg >= 1 && nonzero >= 2) {
+        acc = horner(coef, deg);
+        for (int i = 0; i < c.n_terms; i++) {
+            ASTNode *t = *c.terms[i].slot;
+            if (in_poly[i]) freeAST(t);
+            else acc = appendTerm(acc, t, c.terms[i].negate);
+        }
+    } else if (moved || c.n_unary || n_const >= 2 || zero_const) {
+        /* constants are summed and added last; when the chain would start
+         * with a negated term, k - t replaces -t + k */
+        int first = 1;
+        for (int i = 0; i < c.n_terms; i++) {
+            ASTNode *t = *c.terms[i].slot;
+            if (isNum(t)) {
+                freeAST(t);
+                continue;
+            }
+            if (first && c.terms[i].negate && k != 0) {
+                acc = createOpNode('-', createNumberNode(k), t);
+                k = 0;
+            } else {
+                acc = appendTerm(acc, t, c.terms[i].negate);
+            }
+            first = 0;
+        }
+        if (!acc) acc = createNumberNode(k);
+        else if (k != 0) acc = createOpNode(k < 0 ? '-' : '+', acc, createNumberNode(fabs(k)));
+    } else {
+        free(in_poly);
+        freeChain(&c);
+        return root;
+    }
+
+    releaseShells(&c);
+    free(in_poly);
+    freeChain(&c);
+    return acc;
+}
+
+/* ---------- products ------------------------------------------------------ */
+
+static ASTNode* simplifyProduct(ASTNode *node) {
+    Chain c;
+    memset(&c, 0, sizeof(c));
+    c.divisor = 1;
+    ASTNode *root = node;
+    collectProduct(&root, 0, &c);
+    int moved = simplifyTerms(&c);
+
+    int n_const = 0, negate = 0, finite = 1;
+    double k = 1;
+    for (int i = 0; i < c.n_terms; i++) {
+        ASTNode *t = *c.terms[i].slot;
+        if (c.terms[i].negate) negate = !negate;
+        if (isNum(t)) {
+            n_const++;
+            k *= t->value;
+        } else if (!alwaysFinite(t)) {
+            finite = 0;
+        }
+    }
+    if (c.n_recip) k *= 1.0 / c.divisor;
+    if (negate) k = -k;
+
+    if (!moved && !c.n_unary && !c.n_recip && n_const < 2 &&
+        !(n_const == 1 && (k == 0 || k == 1 || k == -1))) {
+        freeChain(&c);
+        return root;
+    }
+
+    /* remaining factors stay in their original order */
+    ASTNode *acc = NULL;
+    for (int i = 0; i < c.n_terms; i++) {
+        ASTNode *t = *c.terms[i].slot;
+        if (isNum(t)) freeAST(t);
+        else acc = acc ? createOpNode('*', acc, t) : t;
+    }
+    releaseShells(&c);
+    freeChain(&c);
+
+    if (!acc) return createNumberNode(k);
+    if (k == 0 && finite) {
+        freeAST(acc);
+        return createNumberNode(0);
+    }
+    if (k == 1) return acc;
+    if (k == -1) return createOpNode('~', acc, NULL);
+    return createOpNode('*', createNumberNode(k), acc);
+}
+
+/* ---------- single nodes -------------------------------------------------- */
+
+static ASTNode* simplifyNeg(ASTNode *node) {
+    node->left = simplify(node->left);
+    ASTNode *u = node->left;
+    if (isNum(u)) {                         /* -c */
+        u->value = -u->value;
+        freeShell(node);
+        return u;
+    }
+    if (isOp(u, '~')) {                     /* --u -> u */
+        ASTNode *inner = u->left;
+        freeShell(u);
+        freeShell(node);
+        return inner;
+    }
+    if (isOp(u, '*') && isNum(u->left)) {   /* -(k*u) -> (-k)*u */
+        u->left->value = -u->left->value;
+        freeShell(node);
+        return u;
+    }
+    return node;
+}
+
+static ASTNode* simplifyPow(ASTNode *node) {
+    node->left = simplify(node->left);
+    node->right = simplify(node->right);
+    if (!isNum(node->right)) return node;
+
+    ASTNode *u = node->left;
+    double k = node->right->value;
+    if (isNum(u)) {
+        double v = pow(u->value, k);
+        freeAST(node);
+        return createNumberNode(v);
+    }
+    if (k == 1) {                           /* pow(u, 1) == u */
+        freeAST(node->right);
+        freeShell(node);
+        return u;
+    }
+    if (k == 0) {                           /* pow(u, 0) == 1, even for NaN */
+        freeAST(node);
+        return createNumberNode(1);
+    }
+    if (k >= 2 && k <= MAX_POWER_CHAIN && k == floor(k)) {
+        if (isOp(u, '~') && fmod(k, 2) == 0) {  /* (-u)^2n == u^2n */
+            ASTNode *inner = u->left;
+            freeShell(u);
+            u = inner;
+        }
+        freeAST(node->right);
+        freeShell(node);
+        return powerChain(u, (int)k);
+    }
+    return node;
+}
+
+static ASTNode* simplify(ASTNode *node) {
+    if (!node) return NULL;
+
+    if (node->type == NODE_OP) {
+        switch (node->op) {
+            case '+':
+            case '-': return simplifySum(node);
+            case '*': return simplifyProduct(node);
+            case '~': return simplifyNeg(node);
+            case '^': return simplifyPow(node);
+            case '/':
+                if (isConstDivision(node)) return simplifyProduct(node);
+                break;
+        }
+    }
+
+    node->left = simplify(node->left);
+    node->right = simplify(node->right);
+    node->arg2 = simplify(node->arg2);
+    return node;
+}
+
+ASTNode* simplifyAST(ASTNode *node) {
+    /* a second folding pass catches functions whose argument became constant */
+    return optimizeAST(simplify(node));
+}
@@ -0,0 +1,23 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include "ast.h"
+
+/* Algebraic simplification and strength reduction, run after
+ * optimizeAST() has folded constants:
+ *   - identities (x*1, x+0, x^1, x^0, --x, 0*f for provably finite f)
+ *   - constants collected across + and * chains (2*x*3 -> 6*x)
+ *   - x/c -> x*(1/c) for constant c
+ *   - u^n -> multiply chain for integer 2 <= n <= 8
+ *   - sums of monomials in x -> Horner form using fma()
+ * Constant divisors that validateAST() rejects are left in place, and
+ * nothing is removed whose value could be NaN or Inf: monomials that may
+ * overflow never cancel each other (x^3 - x^3 stays as it is).  Horner
+ * form does change where a polynomial overflows, at |x| near the limits
+ * of a double: Inf - Inf between terms of different degrees becomes +/-Inf,
+ * and x^d that overflowed before its coefficient scaled it down may now
+ * stay finite.  Takes ownership of node (which must not be hash-consed
+ * yet) and returns the new tree. */
+ASTNode* simplifyAST(ASTNode *node);
+
+#endif /* SIMPLIFY_H */
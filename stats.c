@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "stats.h"
+
+typedef struct {
+    char   label[64];
+    double start;                       /* statsNow() */
+    double phase[PHASE_COUNT];          /* seconds */
+    long   counter[COUNTER_COUNT];
+} StatsRecord;
+
+typedef struct {
+    char   name[40];
+    double start, duration;             /* seconds */
+    int    thread;
+} StatsEvent;
+
+static const char *phase_names[PHASE_COUNT] = {
+    "parse", "optimize", "tac", "compile", "sample", "write", "render"
+};
+
+static StatsRecord  history[STATS_HISTORY];
+static long         n_records;          /* ever opened; history is a ring */
+static __thread StatsRecord *current;
+static StatsRecord  totals;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;   /* phase times */
+
+static StatsEvent   events[STATS_TRACE_EVENTS];
+static long         n_events;           /* claimed, may pass the buffer */
+static int          n_threads;
+static __thread int thread_id;
+
+double statsNow(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* ---------- recording ------------------------------------------------------ */
+
+static void addEvent(const char *name, double start, double duration) {
+    long slot = __atomic_fetch_add(&n_events, 1, __ATOMIC_RELAXED);
+    if (slot >= STATS_TRACE_EVENTS) return;
+    if (!thread_id) thread_id = __atomic_add_fetch(&n_threads, 1, __ATOMIC_RELAXED);
+    StatsEvent *e = &events[slot];
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    e->start = start;
+    e->duration = duration;
+    e->thread = thread_id;
+}
+
+void statsBegin(const char *label, double start) {
+    statsEnd();
+    current = &history[n_records++ % STATS_HISTORY];
+    memset(current, 0, sizeof(*current));
+    snprintf(current->label, sizeof(current->label), "%s", label);
+    current->start = start;
+}
+
+void statsEnd(void) {
+    if (!current) return;
+    addEvent(current->label, current->start, statsNow() - current->start);
+    current = NULL;
+}
+
+void statsPhase(StatsPhase phase, double start) {
+    double duration = statsNow() - start;
+    pthread_mutex_lock(&lock);
+    if (current) current->phase[phase] += duration;
+    totals.phase[phase] += duration;
+    pthread_mutex_unlock(&lock);
+    addEvent(phase_names[phase], start, duration);
+}
+
+/* Sampling threads count into the record of the sweep they work for; it
+ * stays open until the sweep is over. */
+void statsCount(StatsCounter counter, long n) {
+    StatsRecord *r = current;
+    if (r) __atomic_add_fetch(&r->counter[counter], n, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&totals.counter[counter], n, __ATOMIC_RELAXED);
+}
+
+void statsSpan(const char *name, double start) {
+    addEvent(name, start, statsNow() - start);
+}
+
+void* statsRecord(void) {
+    return current;
+}
+
+void statsAttach(void *record) {
+    current = record;
+}
+
+/* ---------- reporting ------------------------------------------------------ */
+
+#ifndef NO_STATS
+
+/* A plot in the background may still be adding to r.  The label is padded
+ * before it is coloured, so the columns line up with the header. */
+static void printRecord(const StatsRecord *r, const char *label, const char *color) {
+    double phase[PHASE_COUNT], total = 0;
+    long c[COUNTER_COUNT];
+    pthread_mutex_lock(&lock);
+    memcpy(phase, r->phase, sizeof(phase));
+    pthread_mutex_unlock(&lock);
+    for (int k = 0; k < COUNTER_COUNT; k++) c[k] = __atomic_load_n(&r->counter[k], __ATOMIC_RELAXED);
+
+    printf("  %s%-24.24s%s", color, label, *color ? "\033[0m" : "");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        printf(" %8.3f", phase[p] * 1e3);
+        total += phase[p];
+    }
+    printf(" %9.3f\n", total * 1e3);
+    printf("  \033[2m%ld points, %ld node evals, %ld NaN/Inf, %ld lookups, "
+           "%.1f KB written, %ld nodes allocated\033[0m\n",
+           c[COUNTER_POINTS], c[COUNTER_NODES], c[COUNTER_NONFINITE], c[COUNTER_LOOKUPS],
+           c[COUNTER_BYTES] / 1024.0, c[COUNTER_NODES_ALLOCATED]);
+}
+
+static void printStats(void) {
+    if (n_records == 0) {
+        printf("No expressions yet.\n");
+        return;
+    }
+    printf("\n\033[1;36mTime per phase (ms):\033[0m\n  %-24s", "");
+    for (int p = 0; p < PHASE_COUNT; p++) printf(" %8s", phase_names[p]);
+    printf(" %9s\n", "total");
+    long first = n_records > STATS_HISTORY ? n_records - STATS_HISTORY : 0;
+    for (long i = first; i < n_records; i++) {
+        const StatsRecord *r = &history[i % STATS_HISTORY];
+        printRecord(r, r->label, "");
+    }
+    printRecord(&totals, "session", "\033[1;33m");
+    printf("\n");
+}
+
+static void writeJsonString(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        if ((unsigned char)*s >= 0x20) fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void writeTrace(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return;
+    }
+    long n = n_events < STATS_TRACE_EVENTS ? n_events : STATS_TRACE_EVENTS;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (long i = 0; i < n; i++) {
+        const StatsEvent *e = &events[i];
+        fprintf(out, "  {\"name\": ");
+        writeJsonString(out, e->name);
+        fprintf(out, ", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}%s\n",
+                e->start * 1e6, e->duration * 1e6, e->thread, i + 1 < n ? "," : "");
+    }
+    fprintf(out, "]}\n");
+    fclose(out);
+    printf("Wrote %ld spans to %s", n, path);
+    if (n_events > n) printf(" (%ld more were dropped; 'stats clear' starts over)", n_events - n);
+    printf("\n");
+}
+#endif
+
+// Default file for 'stats trace'
+#define STATS_TRACE_FILE "trace.json"
+
+void statsCommand(const char *arg) {
+#ifdef NO_STATS
+    (void)arg;
+    printf("Statistics were compiled out (NO_STATS).\n");
+#else
+    char verb[16], path[256] = STATS_TRACE_FILE;
+    if (sscanf(arg, "%15s %255s", verb, path) < 1) {
+        printStats();
+    } else if (strcmp(verb, "clear") == 0) {
+        current = NULL;
+        n_records = 0;
+        n_events = 0;
+        memset(&totals, 0, sizeof(totals));
+        printf("Statistics cleared.\n");
+    } else if (strcmp(verb, "trace") == 0) {
+        writeTrace(path);
+    } else {
+        printf("Unknown stats command '%s'. Use 'stats', 'stats clear' or 'stats trace [file]'.\n",
+               verb);
+    }
+#endif
+}
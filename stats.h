@@ -0,0 +1,86 @@
+#ifndef STATS_H
+#define STATS_H
+
+/* Per-phase timing and counters.  The work for one expression (parsing it,
+ * or plotting it) is a record; `stats` shows the recent records and the
+ * totals of the session, and `stats trace` writes every timed span as a
+ * Chrome trace (chrome://tracing, Perfetto), sampling chunks on the thread
+ * that ran them.
+ *
+ * Instrumented code uses the STATS_ macros, which cost a clock read per
+ * phase and an atomic add per counter update; building with -DNO_STATS
+ * removes them.
+ *
+ * The open record belongs to the thread that opened it.  Work handed to
+ * another thread takes the record along with STATS_RECORD() and
+ * STATS_ATTACH(), so its phases and counts still add up per expression. */
+
+typedef enum {
+    PHASE_PARSE,        /* parseStatement()                               */
+    PHASE_OPTIMIZE,     /* inlining, folding, simplification, hash-consing */
+    PHASE_TAC,          /* TAC lowering and passes                        */
+    PHASE_COMPILE,      /* prepareSampler(): linking, bytecode, JIT       */
+    PHASE_SAMPLE,       /* evaluating the sweep                           */
+    PHASE_WRITE,        /* curves, decimation and sample files            */
+    PHASE_RENDER,       /* y-limits and the plot sent to gnuplot          */
+    PHASE_COUNT
+} StatsPhase;
+
+typedef enum {
+    COUNTER_POINTS,     /* points evaluated                               */
+    COUNTER_NODES,      /* node evaluations: points x nodes of the tree   */
+    COUNTER_NONFINITE,  /* NaN/Inf samples, left out of the curve         */
+    COUNTER_LOOKUPS,    /* symbol table lookups                           */
+    COUNTER_BYTES,      /* sample bytes written to files and gnuplot      */
+    COUNTER_NODES_ALLOCATED,
+    COUNTER_COUNT
+} StatsCounter;
+
+/* Recent records kept for `stats`. */
+#define STATS_HISTORY 16
+
+/* Spans kept for `stats trace`; later ones are dropped. */
+#define STATS_TRACE_EVENTS 16384
+
+double statsNow(void);          /* monotonic seconds */
+
+/* Opens a record for label (closing the open one), timed from start. */
+void statsBegin(const char *label, double start);
+void statsEnd(void);
+
+/* Adds the time since start to a phase of the open record. */
+void statsPhase(StatsPhase phase, double start);
+void statsCount(StatsCounter counter, long n);
+/* A span of this thread since start, for the trace only. */
+void statsSpan(const char *name, double start);
+
+/* The record open on this thread (NULL if none), and the one this thread
+ * times into from now on.  statsEnd() on any thread that has it attached
+ * closes it. */
+void* statsRecord(void);
+void  statsAttach(void *record);
+
+/* The `stats` command: no argument, "clear" or "trace [file]". */
+void statsCommand(const char *arg);
+
+#ifndef NO_STATS
+#define STATS_START(t)          double t = statsNow()
+#define STATS_BEGIN(label, t)   statsBegin(label, t)
+#define STATS_END()             statsEnd()
+#define STATS_PHASE(phase, t)   statsPhase(phase, t)
+#define STATS_COUNT(counter, n) statsCount(counter, n)
+#define STATS_SPAN(name, t)     statsSpan(name, t)
+#define STATS_RECORD()          statsRecord()
+#define STATS_ATTACH(record)    statsAttach(record)
+#else
+#define STATS_START(t)          ((void)0)
+#define STATS_BEGIN(label, t)   ((void)0)
+#define STATS_END()             ((void)0)
+#define STATS_PHASE(phase, t)   ((void)0)
+#define STATS_COUNT(counter, n) ((void)0)
+#define STATS_SPAN(name, t)     ((void)0)
+#define STATS_RECORD()          NULL
+#define STATS_ATTACH(record)    ((void)(record))
+#endif
+
+#endif /* STATS_H */
@@ -1,59 +1,228 @@
+#include <pthread.h>
 #include "symtab.h"
 #include "ast.h"
+#include "depgraph.h"
+#include "stats.h"
 
-Variable variables[MAX_VARS];
-int      var_count = 0;
-Function functions[MAX_FUNCS];
-int      func_count = 0;
+Variable *variables = NULL;
+int       var_count = 0;
+Function *functions = NULL;
+int       func_count = 0;
+
+static int var_cap = 0, func_cap = 0;
+static unsigned long long generation = 0;
+
+/* ---------- interned names ---------------------------------------------- */
+
+typedef struct {
+    char    *name;
+    unsigned hash;
+    int      var;       /* index in variables[], -1 if none */
+    int      func;      /* index in functions[], -1 if none */
+} Symbol;
+
+static Symbol *symbols = NULL;
+static int     sym_count = 0, sym_cap = 0;
+static int    *slots = NULL;        /* symbol id + 1, 0 = empty */
+static size_t  slot_cap = 0;        /* power of two */
+
+static unsigned hashName(const char *name) {
+    unsigned h = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++)
+        h = (h ^ *c) * 16777619u;
+    return h;
+}
+
+static void insertSlot(int id) {
+    size_t i = symbols[id].hash & (slot_cap - 1);
+    while (slots[i]) i = (i + 1) & (slot_cap - 1);
+    slots[i] = id + 1;
+}
+
+static void growSlots(void) {
+    free(slots);
+    slot_cap = slot_cap ? slot_cap * 2 : 64;
+    slots = calloc(slot_cap, sizeof(int));
+    for (int id = 0; id < sym_count; id++) insertSlot(id);
+}
+
+/* One lock over the whole table.  Lookups hold it for reading, so parsers
+ * and evaluators on several threads run side by side; interning a new name
+ * and storing hold it for writing. */
+static pthread_rwlock_t table_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static int findSymbol(const char *name, unsigned hash) {
+    if (!slot_cap) return -1;
+    size_t i = hash & (slot_cap - 1);
+    while (slots[i]) {
+        const Symbol *s = &symbols[slots[i] - 1];
+        if (s->hash == hash && strcmp(s->name, name) == 0) return slots[i] - 1;
+        i = (i + 1) & (slot_cap - 1);
+    }
+    return -1;
+}
+
+/* The caller holds table_lock for writing. */
+static int internLocked(const char *name, unsigned hash) {
+    int id = findSymbol(name, hash);
+    if (id >= 0) return id;
+
+    if ((size_t)(sym_count + 1) * 10 > slot_cap * 7) growSlots();
+    if (sym_count == sym_cap) {
+        sym_cap = sym_cap ? sym_cap * 2 : 64;
+        symbols = realloc(symbols, sym_cap * sizeof(Symbol));
+    }
+    symbols[sym_count].name = strdup(name);
+    symbols[sym_count].hash = hash;
+    symbols[sym_count].var = -1;
+    symbols[sym_count].func = -1;
+    insertSlot(sym_count);
+    return sym_count++;
+}
+
+int internName(const char *name) {
+    unsigned hash = hashName(name);
+    pthread_rwlock_rdlock(&table_lock);
+    int id = findSymbol(name, hash);
+    pthread_rwlock_unlock(&table_lock);
+    if (id >= 0) return id;
+
+    pthread_rwlock_wrlock(&table_lock);
+    id = internLocked(name, hash);      /* another thread may have added it */
+    pthread_rwlock_unlock(&table_lock);
+    return id;
+}
+
+const char* symbolName(int id) {
+    pthread_rwlock_rdlock(&table_lock);
+    const char *name = (id >= 0 && id < sym_count) ? symbols[id].name : NULL;
+    pthread_rwlock_unlock(&table_lock);
+    return name;                        /* names are never freed */
+}
+
+unsigned long long symtabGeneration(void) {
+    pthread_rwlock_rdlock(&table_lock);
+    unsigned long long g = generation;
+    pthread_rwlock_unlock(&table_lock);
+    return g;
+}
+
+unsigned long long symbolGeneration(int id) {
+    unsigned long long g = 0;
+    pthread_rwlock_rdlock(&table_lock);
+    if (id >= 0 && id < sym_count) {
+        if (symbols[id].var >= 0) g = variables[symbols[id].var].generation;
+        if (symbols[id].func >= 0 && functions[symbols[id].func].generation > g)
+            g = functions[symbols[id].func].generation;
+    }
+    pthread_rwlock_unlock(&table_lock);
+    return g;
+}
 
 /* ---------- variables --------------------------------------------------- */
+int variableIndex(const char *name) {
+    unsigned hash = hashName(name);
+    pthread_rwlock_rdlock(&table_lock);
+    int id = findSymbol(name, hash);
+    int i = id >= 0 ? symbols[id].var : -1;
+    pthread_rwlock_unlock(&table_lock);
+    return i;
+}
+
 double* lookupVariable(const char *name) {
-    for (int i = 0; i < var_count; i++) {
-        if (strcmp(variables[i].name, name) == 0) {
-            return &variables[i].value;
-        }
-    }
-    return NULL;
+    STATS_COUNT(COUNTER_LOOKUPS, 1);
+    unsigned hash = hashName(name);
+    pthread_rwlock_rdlock(&table_lock);
+    int id = findSymbol(name, hash);
+    int i = id >= 0 ? symbols[id].var : -1;
+    double *value = i >= 0 ? &variables[i].value : NULL;
+    pthread_rwlock_unlock(&table_lock);
+    return value;
+}
+
+double* lookupVariableId(int id) {
+    STATS_COUNT(COUNTER_LOOKUPS, 1);
+    pthread_rwlock_rdlock(&table_lock);
+    int i = (id >= 0 && id < sym_count) ? symbols[id].var : -1;
+    double *value = i >= 0 ? &variables[i].value : NULL;
+    pthread_rwlock_unlock(&table_lock);
+    return value;
 }
 
 void storeVariable(const char *name, double value) {
-    for (int i = 0; i < var_count; i++) {
-        if (strcmp(variables[i].name, name) == 0) {
-            variables[i].value = value;
-            return;
+    pthread_rwlock_wrlock(&table_lock);
+    int id = internLocked(name, hashName(name));
+    int i = symbols[id].var;
+    if (i < 0) {
+        if (var_count == var_cap) {
+            var_cap = var_cap ? var_cap * 2 : 16;
+            variables = realloc(variables, var_cap * sizeof(Variable));
         }
+        i = symbols[id].var = var_count++;
+        variables[i].name = symbols[id].name;
     }
-    if (var_count < MAX_VARS) {
-        strncpy(variables[var_count].name, name, 49);
-        variables[var_count].name[49] = '\0';
-        variables[var_count].value = value;
-        var_count++;
-    }
+    variables[i].value = value;
+    variables[i].generation = ++generation;
+    pthread_rwlock_unlock(&table_lock);
+    depgraphDefine(id, NULL);
+}
+
+/* ---------- functions --------------------------------------------------- */
+int functionIndex(const char *name) {
+    unsigned hash = hashName(name);
+    pthread_rwlock_rdlock(&table_lock);
+    int id = findSymbol(name, hash);
+    int i = id >= 0 ? symbols[id].func : -1;
+    pthread_rwlock_unlock(&table_lock);
+    return i;
+}
+
+int functionIndexId(int id) {
+    pthread_rwlock_rdlock(&table_lock);
+    int i = (id >= 0 && id < sym_count) ? symbols[id].func : -1;
+    pthread_rwlock_unlock(&table_lock);
+    return i;
 }
 
 ASTNode* lookupFunction(const char *name) {
-    for (int i = 0; i < func_count; i++) {
-        if (strcmp(functions[i].name, name) == 0) {
-            return functions[i].ast;
-        }
-    }
-    return NULL;
+    STATS_COUNT(COUNTER_LOOKUPS, 1);
+    unsigned hash = hashName(name);
+    pthread_rwlock_rdlock(&table_lock);
+    int id = findSymbol(name, hash);
+    int i = id >= 0 ? symbols[id].func : -1;
+    ASTNode *ast = i >= 0 ? functions[i].ast : NULL;
+    pthread_rwlock_unlock(&table_lock);
+    return ast;
+}
+
+ASTNode* lookupFunctionId(int id) {
+    STATS_COUNT(COUNTER_LOOKUPS, 1);
+    pthread_rwlock_rdlock(&table_lock);
+    int i = (id >= 0 && id < sym_count) ? symbols[id].func : -1;
+    ASTNode *ast = i >= 0 ? functions[i].ast : NULL;
+    pthread_rwlock_unlock(&table_lock);
+    return ast;
 }
 
 void storeFunction(const char *name, ASTNode *ast) {
-    for (int i = 0; i < func_count; i++) {
-        if (strcmp(functions[i].name, name) == 0) {
-            freeAST(functions[i].ast);
-            functions[i].ast = ast;
-            return;
+    pthread_rwlock_wrlock(&table_lock);
+    int id = internLocked(name, hashName(name));
+    int i = symbols[id].func;
+    if (i < 0) {
+        if (func_count == func_cap) {
+            func_cap = func_cap ? func_cap * 2 : 16;
+            functions = realloc(functions, func_cap * sizeof(Function));
         }
+        i = symbols[id].func = func_count++;
+        functions[i].name = symbols[id].name;
+        functions[i].ast = NULL;
     }
-    if (func_count < MAX_FUNCS) {
-        strncpy(functions[func_count].name, name, 49);
-        functions[func_count].name[49] = '\0';
-        functions[func_count].ast = ast;
-        func_count++;
-    }
+    ASTNode *old = functions[i].ast;
+    functions[i].ast = ast;
+    functions[i].generation = ++generation;
+    pthread_rwlock_unlock(&table_lock);
+    freeAST(old);
+    depgraphDefine(id, ast);
 }
 
 void listVariables() {
@@ -3,32 +3,59 @@
 
 #include "ast.h"
 
-#define MAX_VARS  100
-#define MAX_FUNCS 50
-
 typedef struct {
-    char   name[50];
-    double value;
+    const char        *name;        /* interned */
+    double             value;
+    unsigned long long generation;  /* symtabGeneration() at the last store */
 } Variable;
 
 typedef struct {
-    char      name[50];
-    ASTNode  *ast;
+    const char        *name;        /* interned */
+    ASTNode           *ast;
+    unsigned long long generation;
 } Function;
 
-/* exported tables (used by parser & evaluator) */
-extern Variable variables[MAX_VARS];
-extern int      var_count;
-extern Function functions[MAX_FUNCS];
-extern int      func_count;
+/* exported tables (used by parser & evaluator).  Entries keep their index
+ * for the whole run, in definition order; the arrays grow on demand, so
+ * pointers into them are only valid until the next store.
+ *
+ * The functions below take a reader/writer lock, so any number of threads
+ * may intern and look up names at once.  The arrays themselves are read
+ * without it: a store (let, def) must not overlap with code that walks
+ * them or holds a pointer into them. */
+extern Variable *variables;
+extern int       var_count;
+extern Function *functions;
+extern int       func_count;
+
+/* ---- interned names ----------------------------------------------------- */
+/* Names live in one open-addressing hash table; equal names share one id
+ * and one string for the rest of the run. */
+int         internName(const char *name);
+const char* symbolName(int id);
 
-/* lookup / store */
+/* ---- lookup / store ----------------------------------------------------- */
 double*   lookupVariable(const char *name);
 void      storeVariable(const char *name, double value);
 ASTNode*  lookupFunction(const char *name);
 void      storeFunction(const char *name, ASTNode *ast);
+int       variableIndex(const char *name);   /* -1 if not defined */
+int       functionIndex(const char *name);
+
+/* The same lookups by interned id, as stored in NODE_IDENTIFIER nodes. */
+double*   lookupVariableId(int id);
+ASTNode*  lookupFunctionId(int id);
+int       functionIndexId(int id);
+
+/* Incremented by every store.  An artifact built at generation g is stale
+ * once any entry it used has generation > g. */
+unsigned long long symtabGeneration(void);
+/* Generation of the entries named id: 0 while the name is undefined, so
+ * defining it later counts as a change too. */
+unsigned long long symbolGeneration(int id);
+
 void      listVariables();
 void      listFunctions();
 void      showFunction(const char *name);
 
-#endif /* SYMTAB_H */
\ No newline at end of file
+#endif /* SYMTAB_H */
@@ -2,218 +2,469 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
+#include "symtab.h"
 #include "tac.h"
 
-static int tempCount = 0;
-static char *derivH = NULL;
-static char *derivXph = NULL;
-static char *derivXmh = NULL;
-static char *derivH2 = NULL;
+/* ---------- building ------------------------------------------------------ */
 
-void tac_reset(void) {
-    tempCount = 0;
-    if (derivH) {
-        free(derivH);
-        derivH = NULL;
-    }
-    if (derivXph) {
-        free(derivXph);
-        derivXph = NULL;
-    }
-    if (derivXmh) {
-        free(derivXmh);
-        derivXmh = NULL;
+static int emit(TacProgram *p, TacOp op, int a, int b, int c) {
+    if (p->n == p->cap) {
+        p->cap = p->cap ? p->cap * 2 : 32;
+        p->code = realloc(p->code, p->cap * sizeof(TacInstr));
     }
+    TacInstr *in = &p->code[p->n];
+    memset(in, 0, sizeof(TacInstr));
+    in->op = op;
+    in->a = a;
+    in->b = b;
+    in->c = c;
+    return p->n++;
 }
 
-static char *newTemp(void) {
-    char buf[32];
-    sprintf(buf, "t%d", tempCount++);
-    return strdup(buf); 
+static int emitConst(TacProgram *p, double value) {
+    int t = emit(p, TAC_CONST, -1, -1, -1);
+    p->code[t].value = value;
+    return t;
 }
 
-/* Forward declarations */
-static char *generateTAC_with_varname(ASTNode *node, FILE *out, const char *varname);
+static int emitCall(TacProgram *p, int func, int a, int b, int c) {
+    int t = emit(p, TAC_CALL, a, b, c);
+    p->code[t].func = func;
+    return t;
+}
 
-char *generateTAC(ASTNode *node, FILE *out) {
-    if (!node) return NULL;
+/* ---------- lowering ------------------------------------------------------ */
+
+/* A shared (hash-consed) node is lowered once per sample point it is
+ * evaluated at: a derivative evaluates its body at x + h and x - h, each
+ * with a memo of its own, as evaluate() does. */
+typedef struct {
+    TacProgram *p;
+    int         x;                          /* temp holding the point */
+    int         shared[EVAL_MEMO_SLOTS];    /* temps of shared nodes, -1 until lowered */
+} Lowering;
+
+static int lowerNode(Lowering *l, const ASTNode *node);
+
+static int lowerAt(TacProgram *p, const ASTNode *node, int x) {
+    Lowering l;
+    l.p = p;
+    l.x = x;
+    for (int i = 0; i < EVAL_MEMO_SLOTS; i++) l.shared[i] = -1;
+    return lowerNode(&l, node);
+}
 
+static int lowerValue(Lowering *l, const ASTNode *node) {
+    TacProgram *p = l->p;
     switch (node->type) {
-        case NODE_NUMBER: {
-            char *buf = malloc(64);
-            snprintf(buf, 64, "%.10g", node->value);
-            return buf;
-        }
+        case NODE_NUMBER:
+            return emitConst(p, node->value);
 
-        case NODE_VAR: {
-            return strdup("x");
-        }
+        case NODE_VAR:
+            return l->x;
 
         case NODE_IDENTIFIER: {
-            return strdup(node->name);
+            int t = emit(p, TAC_NAME, -1, -1, -1);
+            p->code[t].name = node->name;
+            return t;
         }
 
         case NODE_OP: {
-            if (node->op == '~') { /* unary minus */
-                char *v = generateTAC(node->left, out);
-                char *t = newTemp();
-                fprintf(out, "%s = - %s\n", t, v);
-                free(v);
-                return t;
-            } else {
-                char *L = generateTAC(node->left, out);
-                char *R = generateTAC(node->right, out);
-                char *t = newTemp();
-                fprintf(out, "%s = %s %c %s\n", t, L, node->op, R);
-                free(L);
-                free(R);
-                return t;
+            int a = lowerNode(l, node->left);
+            if (node->op == '~') return emit(p, TAC_NEG, a, -1, -1);
+            int b = lowerNode(l, node->right);
+            switch (node->op) {
+                case '+': return emit(p, TAC_ADD, a, b, -1);
+                case '-': return emit(p, TAC_SUB, a, b, -1);
+                case '*': return emit(p, TAC_MUL, a, b, -1);
+                case '/': return emit(p, TAC_DIV, a, b, -1);
+                case '^': return emit(p, TAC_POW, a, b, -1);
             }
+            break;
         }
 
-        case NODE_FUNC: {
-            char *arg = generateTAC(node->left, out);
-            char *t = newTemp();
-            fprintf(out, "%s = %s(%s)\n", t, node->func, arg);
-            free(arg);
-            return t;
-        }
+        case NODE_FUNC:
+            return emitCall(p, node->func, lowerNode(l, node->left), -1, -1);
 
         case NODE_FUNC2: {
-            char *a1 = generateTAC(node->left, out);
-            char *a2 = generateTAC(node->right, out);
-            char *t = newTemp();
-            fprintf(out, "%s = %s(%s, %s)\n", t, node->func, a1, a2);
-            free(a1);
-            free(a2);
-            return t;
+            int a = lowerNode(l, node->left);
+            int b = lowerNode(l, node->right);
+            return emitCall(p, node->func, a, b, -1);
+        }
+
+        case NODE_FUNC3: {
+            int a = lowerNode(l, node->left);
+            int b = lowerNode(l, node->right);
+            int c = lowerNode(l, node->arg2);
+            return emitCall(p, node->func, a, b, c);
         }
 
         case NODE_DERIVATIVE: {
-            /* Initialize derivative helpers only once */
-            if (!derivH) {
-                derivH = newTemp();
-                fprintf(out, "%s = 1e-5\n", derivH);
+            // (f(x + h) - f(x - h)) / (2h), as derivative() computes it
+            double h = 1e-5;
+            int th = emitConst(p, h);
+            int upper = lowerAt(p, node->left, emit(p, TAC_ADD, l->x, th, -1));
+            int lower = lowerAt(p, node->left, emit(p, TAC_SUB, l->x, th, -1));
+            int diff = emit(p, TAC_SUB, upper, lower, -1);
+            return emit(p, TAC_DIV, diff, emitConst(p, 2*h), -1);
+        }
+    }
+    return emitConst(p, 0);
+}
 
-                derivXph = newTemp();
-                fprintf(out, "%s = x + %s\n", derivXph, derivH);
+static int lowerNode(Lowering *l, const ASTNode *node) {
+    if (!node) return emitConst(l->p, 0);
+    int slot = node->memo;
+    if (slot < 0 || slot >= EVAL_MEMO_SLOTS) return lowerValue(l, node);
+    if (l->shared[slot] < 0) l->shared[slot] = lowerValue(l, node);
+    return l->shared[slot];
+}
 
-                derivXmh = newTemp();
-                fprintf(out, "%s = x - %s\n", derivXmh, derivH);
+TacProgram* tacLower(const ASTNode *node) {
+    TacProgram *p = calloc(1, sizeof(TacProgram));
+    p->result = lowerAt(p, node, emit(p, TAC_X, -1, -1, -1));
+    p->stats.lowered = tacOperations(p);
+    return p;
+}
 
-                derivH2 = newTemp();
-                fprintf(out, "%s = 2 * %s\n", derivH2, derivH);
-            }
+int tacOperations(const TacProgram *p) {
+    int n = 0;
+    for (int i = 0; i < p->n; i++) n += p->code[i].op >= TAC_COPY;
+    return n;
+}
 
-            char *arg1 = generateTAC_with_varname(node->left, out, derivXph);
-            char *arg2 = generateTAC_with_varname(node->left, out, derivXmh);
+void tacFree(TacProgram *p) {
+    if (!p) return;
+    free(p->code);
+    free(p);
+}
 
-            char *tdiff = newTemp();
-            fprintf(out, "%s = %s - %s\n", tdiff, arg1, arg2);
+/* ---------- semantics ----------------------------------------------------- */
+
+/* The value of an arithmetic or CALL instruction, exactly as evaluate()
+ * computes the node it came from.  Constant propagation folds with it. */
+static double apply(const TacInstr *in, double a, double b, double c) {
+    switch (in->op) {
+        case TAC_COPY: return a;
+        case TAC_NEG:  return -a;
+        case TAC_ADD:  return a + b;
+        case TAC_SUB:  return a - b;
+        case TAC_MUL:  return a * b;
+        case TAC_DIV:  return (fabs(b) < 1e-10) ? NAN : a / b;
+        case TAC_POW:  return pow(a, b);
+        case TAC_CALL: break;
+        default:       return 0;
+    }
+    switch (in->func) {
+        case FN_SIN:   return sin(a);
+        case FN_COS:   return cos(a);
+        case FN_TAN:   return tan(a);
+        case FN_EXP:   return exp(a);
+        case FN_LOG:   return (a > 0) ? log10(a) : NAN;
+        case FN_SQRT:  return (a >= 0) ? sqrt(a) : NAN;
+        case FN_ABS:   return fabs(a);
+        case FN_LN:    return (a > 0) ? log(a) : NAN;
+        case FN_ASIN:  return asin(a);
+        case FN_ACOS:  return acos(a);
+        case FN_ATAN:  return atan(a);
+        case FN_SINH:  return sinh(a);
+        case FN_COSH:  return cosh(a);
+        case FN_TANH:  return tanh(a);
+        case FN_CEIL:  return ceil(a);
+        case FN_FLOOR: return floor(a);
+        case FN_SIGN:  return (a > 0) ? 1 : (a < 0) ? -1 : a;
+        case FN_MAX:   return (a > b) ? a : b;
+        case FN_MIN:   return (a < b) ? a : b;
+        case FN_FMA:   return fma(a, b, c);
+    }
+    return 0;
+}
 
-            char *tout = newTemp();
-            fprintf(out, "%s = %s / %s\n", tout, tdiff, derivH2);
+static int isPure(const TacInstr *in) {
+    return in->op >= TAC_COPY;
+}
 
-            free(arg1);
-            free(arg2);
-            free(tdiff);
+/* ---------- passes -------------------------------------------------------- */
 
-            return tout;
-        }
+/* Operands read through copies; copies point backwards, so resolving in
+ * program order leaves every copy pointing at a non-copy. */
+static int resolve(const TacProgram *p, int t) {
+    return (t >= 0 && p->code[t].op == TAC_COPY) ? p->code[t].a : t;
+}
 
-        default:
-            return NULL;
+static void copyPropagation(TacProgram *p) {
+    for (int i = 0; i < p->n; i++) {
+        TacInstr *in = &p->code[i];
+        in->a = resolve(p, in->a);
+        in->b = resolve(p, in->b);
+        in->c = resolve(p, in->c);
     }
+    p->result = resolve(p, p->result);
 }
 
-static char *generateTAC_with_varname(ASTNode *node, FILE *out, const char *varname) {
-    if (!node) return NULL;
+static int constOperand(const TacProgram *p, int t) {
+    return t < 0 || p->code[t].op == TAC_CONST;
+}
 
-    switch (node->type) {
-        case NODE_NUMBER: {
-            char *buf = malloc(64);
-            snprintf(buf, 64, "%.10g", node->value);
-            return buf;
-        }
+static double operandValue(const TacProgram *p, int t) {
+    return t < 0 ? 0 : p->code[t].value;
+}
 
-        case NODE_VAR: {
-            return strdup(varname);
-        }
+static int constantPropagation(TacProgram *p) {
+    int folded = 0;
+    for (int i = 0; i < p->n; i++) {
+        TacInstr *in = &p->code[i];
+        if (!isPure(in) || in->op == TAC_COPY) continue;
+        if (!constOperand(p, in->a) || !constOperand(p, in->b) || !constOperand(p, in->c))
+            continue;
+        double v = apply(in, operandValue(p, in->a), operandValue(p, in->b),
+                         operandValue(p, in->c));
+        memset(in, 0, sizeof(TacInstr));
+        in->op = TAC_CONST;
+        in->a = in->b = in->c = -1;
+        in->value = v;
+        folded++;
+    }
+    return folded;
+}
 
-        case NODE_IDENTIFIER: {
-            return strdup(node->name);
-        }
+static unsigned long long instrHash(const TacInstr *in) {
+    unsigned long long h = in->op * 31 + in->func;
+    if (in->op == TAC_CONST) {
+        unsigned long long bits;
+        memcpy(&bits, &in->value, sizeof(bits));
+        h = h * 1000003 ^ bits;
+    } else if (in->op == TAC_NAME) {
+        h = h * 1000003 ^ (unsigned)in->name;
+    }
+    h = (h * 1000003 ^ (unsigned)in->a) * 1000003 ^ (unsigned)in->b;
+    h = h * 1000003 ^ (unsigned)in->c;
+    return h ^ (h >> 29);
+}
 
-        case NODE_OP: {
-            if (node->op == '~') {
-                char *v = generateTAC_with_varname(node->left, out, varname);
-                char *t = newTemp();
-                fprintf(out, "%s = - %s\n", t, v);
-                free(v);
-                return t;
-            } else {
-                char *L = generateTAC_with_varname(node->left, out, varname);
-                char *R = generateTAC_with_varname(node->right, out, varname);
-                char *t = newTemp();
-                fprintf(out, "%s = %s %c %s\n", t, L, node->op, R);
-                free(L);
-                free(R);
-                return t;
-            }
-        }
+static int sameValue(const TacInstr *x, const TacInstr *y) {
+    if (x->op != y->op || x->func != y->func) return 0;
+    if (x->a != y->a || x->b != y->b || x->c != y->c) return 0;
+    if (x->op == TAC_CONST) return memcmp(&x->value, &y->value, sizeof(double)) == 0;
+    if (x->op == TAC_NAME) return x->name == y->name;
+    return 1;
+}
 
-        case NODE_FUNC: {
-            char *arg = generateTAC_with_varname(node->left, out, varname);
-            char *t = newTemp();
-            fprintf(out, "%s = %s(%s)\n", t, node->func, arg);
-            free(arg);
-            return t;
+/* An instruction that computes what an earlier one did becomes a copy of
+ * it.  Operands of + and * (and of the product in fma) are put in order
+ * first, as IEEE addition and multiplication commute exactly; max and min
+ * do not, because of NaN. */
+static int valueNumbering(TacProgram *p) {
+    int size = 64;
+    while (size < 2 * p->n) size *= 2;
+    int *table = malloc(size * sizeof(int));
+    for (int i = 0; i < size; i++) table[i] = -1;
+
+    int merged = 0;
+    for (int i = 0; i < p->n; i++) {
+        TacInstr *in = &p->code[i];
+        in->a = resolve(p, in->a);
+        in->b = resolve(p, in->b);
+        in->c = resolve(p, in->c);
+        if (in->op == TAC_COPY) continue;
+        int commutes = in->op == TAC_ADD || in->op == TAC_MUL ||
+                       (in->op == TAC_CALL && in->func == FN_FMA);
+        if (commutes && in->a > in->b) {
+            int t = in->a;
+            in->a = in->b;
+            in->b = t;
+        }
+        unsigned long long h = instrHash(in);
+        int k = (int)(h & (size - 1));
+        while (table[k] >= 0 && !sameValue(&p->code[table[k]], in)) k = (k + 1) & (size - 1);
+        if (table[k] < 0) {
+            table[k] = i;
+            continue;
         }
+        int first = table[k];
+        merged += in->op > TAC_COPY;
+        memset(in, 0, sizeof(TacInstr));
+        in->op = TAC_COPY;
+        in->a = first;
+        in->b = in->c = -1;
+    }
+    free(table);
+    p->result = resolve(p, p->result);
+    return merged;
+}
 
-        case NODE_FUNC2: {
-            char *a1 = generateTAC_with_varname(node->left, out, varname);
-            char *a2 = generateTAC_with_varname(node->right, out, varname);
-            char *t = newTemp();
-            fprintf(out, "%s = %s(%s, %s)\n", t, node->func, a1, a2);
-            free(a1);
-            free(a2);
-            return t;
+/* Drops what the result does not depend on and renumbers the rest. */
+static int deadCodeElimination(TacProgram *p) {
+    char *live = calloc(p->n, 1);
+    int *renamed = malloc(p->n * sizeof(int));
+    live[p->result] = 1;
+    for (int i = p->n - 1; i >= 0; i--) {
+        if (!live[i]) continue;
+        const TacInstr *in = &p->code[i];
+        if (in->a >= 0) live[in->a] = 1;
+        if (in->b >= 0) live[in->b] = 1;
+        if (in->c >= 0) live[in->c] = 1;
+    }
+    int n = 0, dead = 0;
+    for (int i = 0; i < p->n; i++) {
+        if (!live[i]) {
+            dead += p->code[i].op > TAC_COPY;
+            continue;
         }
+        TacInstr in = p->code[i];
+        if (in.a >= 0) in.a = renamed[in.a];
+        if (in.b >= 0) in.b = renamed[in.b];
+        if (in.c >= 0) in.c = renamed[in.c];
+        renamed[i] = n;
+        p->code[n++] = in;
+    }
+    p->result = renamed[p->result];
+    p->n = n;
+    free(live);
+    free(renamed);
+    return dead;
+}
 
-        case NODE_DERIVATIVE: {
-            if (!derivH) {
-                derivH = newTemp();
-                fprintf(out, "%s = 1e-5\n", derivH);
-
-                char *vph = newTemp();
-                fprintf(out, "%s = %s + %s\n", vph, varname, derivH);
-                derivXph = vph;
-
-                char *vmh = newTemp();
-                fprintf(out, "%s = %s - %s\n", vmh, varname, derivH);
-                derivXmh = vmh;
-                
-                derivH2 = newTemp();
-                fprintf(out, "%s = 2 * %s\n", derivH2, derivH);
-            }
+void tacOptimize(TacProgram *p) {
+    p->stats.folded += constantPropagation(p);
+    copyPropagation(p);
+    p->stats.merged += valueNumbering(p);
+    copyPropagation(p);
+    p->stats.dead += deadCodeElimination(p);
+}
 
-            char *arg1 = generateTAC_with_varname(node->left, out, derivXph);
-            char *arg2 = generateTAC_with_varname(node->left, out, derivXmh);
+unsigned long long tacHash(const TacProgram *p) {
+    unsigned long long h = 1469598103934665603ULL;
+#define MIX(v) (h = (h ^ (unsigned long long)(v)) * 1099511628211ULL)
+    for (int i = 0; i < p->n; i++) {
+        const TacInstr *in = &p->code[i];
+        MIX(in->op);
+        MIX(in->func);
+        MIX(in->a);
+        MIX(in->b);
+        MIX(in->c);
+        if (in->op == TAC_CONST) {
+            unsigned long long bits;
+            memcpy(&bits, &in->value, sizeof(bits));
+            MIX(bits);
+        } else if (in->op == TAC_NAME) {
+            for (const char *s = symbolName(in->name); *s; s++) MIX((unsigned char)*s);
+        }
+    }
+    MIX(p->result);
+#undef MIX
+    return h;
+}
 
-            char *tdiff = newTemp();
-            fprintf(out, "%s = %s - %s\n", tdiff, arg1, arg2);
+/* ---------- execution ----------------------------------------------------- */
 
-            char *tout = newTemp();
-            fprintf(out, "%s = %s / %s\n", tout, tdiff, derivH2);
+static void runName(int name, const double *xs, double *out, int n) {
+    double *val = lookupVariableId(name);
+    if (val) {
+        for (int j = 0; j < n; j++) out[j] = *val;
+        return;
+    }
+    ASTNode *func = lookupFunctionId(name);
+    if (func) {
+        for (int j = 0; j < n; j++) out[j] = evaluate(func, xs[j]);
+        return;
+    }
+    fprintf(stderr, "\033[1;31mError: Undefined identifier '%s'\033[0m\n", symbolName(name));
+    for (int j = 0; j < n; j++) out[j] = NAN;
+}
 
-            free(arg1);
-            free(arg2);
-            free(tdiff);
+void tacRun(const TacProgram *p, const double *xs, double *ys, int n) {
+    if (n <= 0) return;
+    double *regs = malloc((size_t)p->n * TAC_BLOCK * sizeof(double));
+    // Constants fill their columns once for every block
+    for (int i = 0; i < p->n; i++) {
+        if (p->code[i].op != TAC_CONST) continue;
+        double *r = regs + (size_t)i * TAC_BLOCK;
+        for (int j = 0; j < TAC_BLOCK; j++) r[j] = p->code[i].value;
+    }
 
-            return tout;
+    for (int start = 0; start < n; start += TAC_BLOCK) {
+        int m = n - start < TAC_BLOCK ? n - start : TAC_BLOCK;
+        const double *x = xs + start;
+        for (int i = 0; i < p->n; i++) {
+            const TacInstr *in = &p->code[i];
+            double *r = regs + (size_t)i * TAC_BLOCK;
+            const double *a = in->a >= 0 ? regs + (size_t)in->a * TAC_BLOCK : NULL;
+            const double *b = in->b >= 0 ? regs + (size_t)in->b * TAC_BLOCK : NULL;
+            const double *c = in->c >= 0 ? regs + (size_t)in->c * TAC_BLOCK : NULL;
+            switch (in->op) {
+                case TAC_CONST: break;
+                case TAC_X:    memcpy(r, x, m * sizeof(double)); break;
+                case TAC_NAME: runName(in->name, x, r, m); break;
+                case TAC_COPY: memcpy(r, a, m * sizeof(double)); break;
+                case TAC_NEG:  for (int j = 0; j < m; j++) r[j] = -a[j]; break;
+                case TAC_ADD:  for (int j = 0; j < m; j++) r[j] = a[j] + b[j]; break;
+                case TAC_SUB:  for (int j = 0; j < m; j++) r[j] = a[j] - b[j]; break;
+                case TAC_MUL:  for (int j = 0; j < m; j++) r[j] = a[j] * b[j]; break;
+                default:
+                    for (int j = 0; j < m; j++)
+                        r[j] = apply(in, a ? a[j] : 0, b ? b[j] : 0, c ? c[j] : 0);
+            }
         }
+        memcpy(ys + start, regs + (size_t)p->result * TAC_BLOCK, m * sizeof(double));
+    }
+    free(regs);
+}
+
+/* ---------- printing ------------------------------------------------------ */
+
+/* Constants, x and names are written where they are used; the other temps
+ * are numbered t1, t2, ... in program order. */
+static void printOperand(const TacProgram *p, const int *numbers, int t, FILE *out) {
+    const TacInstr *in = &p->code[t];
+    switch (in->op) {
+        case TAC_CONST: fprintf(out, "%.10g", in->value); break;
+        case TAC_X:     fprintf(out, "x"); break;
+        case TAC_NAME:  fprintf(out, "%s", symbolName(in->name)); break;
+        default:        fprintf(out, "t%d", numbers[t]);
+    }
+}
 
-        default:
-            return NULL;
+void tacPrint(const TacProgram *p, FILE *out) {
+    static const char ops[] = { [TAC_ADD] = '+', [TAC_SUB] = '-', [TAC_MUL] = '*',
+                                [TAC_DIV] = '/', [TAC_POW] = '^' };
+    int *numbers = malloc(p->n * sizeof(int));
+    int next = 1;
+    for (int i = 0; i < p->n; i++) {
+        const TacInstr *in = &p->code[i];
+        if (in->op == TAC_CONST || in->op == TAC_X || in->op == TAC_NAME) continue;
+        numbers[i] = next++;
+        fprintf(out, "t%d = ", numbers[i]);
+        switch (in->op) {
+            case TAC_COPY:
+                printOperand(p, numbers, in->a, out);
+                break;
+            case TAC_NEG:
+                fprintf(out, "-");
+                printOperand(p, numbers, in->a, out);
+                break;
+            case TAC_CALL:
+                fprintf(out, "%s(", builtinName(in->func));
+                printOperand(p, numbers, in->a, out);
+                if (in->b >= 0) {
+                    fprintf(out, ", ");
+                    printOperand(p, numbers, in->b, out);
+                }
+                if (in->c >= 0) {
+                    fprintf(out, ", ");
+                    printOperand(p, numbers, in->c, out);
+                }
+                fprintf(out, ")");
+                break;
+            default:
+                printOperand(p, numbers, in->a, out);
+                fprintf(out, " %c ", ops[in->op]);
+                printOperand(p, numbers, in->b, out);
+        }
+        fprintf(out, "\n");
     }
-}
\ No newline at end of file
+    fprintf(out, "result = ");
+    printOperand(p, numbers, p->result, out);
+    fprintf(out, "\n");
+    free(numbers);
+}
@@ -4,8 +4,74 @@
 #include <stdio.h>
 #include "ast.h"
 
-void tac_reset(void);
+/* Three-address code: a program is an array of instructions in SSA form,
+ * where temp i is the value instruction i defines and every operand is a
+ * temp defined before it.  Lowered from an AST, optimized in place and
+ * run directly, with the same results as evaluate(). */
 
-char *generateTAC(ASTNode *node, FILE *out);
+typedef enum {
+    TAC_CONST,      /* value                                        */
+    TAC_X,          /* the sample point                             */
+    TAC_NAME,       /* variable or def `name`, looked up when run   */
+    TAC_COPY,       /* a                                            */
+    TAC_NEG,        /* -a                                           */
+    TAC_ADD,        /* a + b                                        */
+    TAC_SUB,        /* a - b                                        */
+    TAC_MUL,        /* a * b                                        */
+    TAC_DIV,        /* a / b, NaN for |b| < 1e-10                   */
+    TAC_POW,        /* a ^ b                                        */
+    TAC_CALL        /* builtin func(a), func(a, b) or func(a, b, c) */
+} TacOp;
+
+typedef struct {
+    unsigned char op;       /* TacOp */
+    unsigned char func;     /* BuiltinFunc, for CALL */
+    int           a, b, c;  /* operand temps, -1 if unused */
+    union {
+        double    value;    /* for CONST */
+        int       name;     /* for NAME: interned id, see symbolName() */
+    };
+} TacInstr;
+
+/* What tacOptimize() did, in operations: instructions other than
+ * constants, x and names, which are loads. */
+typedef struct {
+    int lowered;            /* operations before the passes   */
+    int folded;             /* constant propagation           */
+    int merged;             /* global value numbering         */
+    int dead;               /* dead-code elimination          */
+} TacStats;
+
+typedef struct {
+    TacInstr *code;         /* one allocation for the whole program */
+    int       n, cap;
+    int       result;       /* temp holding the value */
+    TacStats  stats;
+} TacProgram;
+
+TacProgram* tacLower(const ASTNode *node);
+
+int tacOperations(const TacProgram *p);
+
+/* Runs constant propagation, copy propagation, global value numbering and
+ * dead-code elimination.  Only folds what evaluate() would compute the
+ * same way at run time, so results stay bit for bit the same. */
+void tacOptimize(TacProgram *p);
+
+/* Hash of the instructions, with names hashed by their text, so the same
+ * code hashes the same in every run. */
+unsigned long long tacHash(const TacProgram *p);
+
+/* Points run a block at a time, each temp a column of the register file. */
+#define TAC_BLOCK 64
+
+/* Evaluates n points.  A program without NAME instructions (one lowered
+ * from a linked tree) may be run by any number of threads at once. */
+void tacRun(const TacProgram *p, const double *xs, double *ys, int n);
+
+/* Prints one instruction per line as `tN = a op b`, with constants, x and
+ * names written in place, then `result = tN`. */
+void tacPrint(const TacProgram *p, FILE *out);
+void tacFree(TacProgram *p);
 
 #endif
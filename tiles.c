@@ -0,0 +1,109 @@
+#include "tiles.h"
+
+#define TILE_BUCKETS 8192   /* power of two */
+
+typedef struct Tile {
+    unsigned long long expr;
+    int                level;
+    long               index;
+    struct Tile       *chain;           /* next in the hash bucket */
+    struct Tile       *newer, *older;   /* LRU list */
+    double             y[TILE_POINTS];
+} Tile;
+
+static Tile *buckets[TILE_BUCKETS];
+static Tile *newest, *oldest;
+static long  n_tiles;
+
+static size_t bucketOf(unsigned long long expr, int level, long index) {
+    unsigned long long h = expr;
+    h = (h ^ (unsigned long long)level) * 1099511628211ULL;
+    h = (h ^ (unsigned long long)index) * 1099511628211ULL;
+    return (size_t)(h ^ (h >> 29)) & (TILE_BUCKETS - 1);
+}
+
+static void unlinkLRU(Tile *t) {
+    if (t->newer) t->newer->older = t->older; else newest = t->older;
+    if (t->older) t->older->newer = t->newer; else oldest = t->newer;
+}
+
+static void pushNewest(Tile *t) {
+    t->newer = NULL;
+    t->older = newest;
+    if (newest) newest->newer = t; else oldest = t;
+    newest = t;
+}
+
+static Tile* findTile(unsigned long long expr, int level, long index) {
+    for (Tile *t = buckets[bucketOf(expr, level, index)]; t; t = t->chain)
+        if (t->expr == expr && t->level == level && t->index == index) return t;
+    return NULL;
+}
+
+static void removeFromBucket(Tile *t) {
+    Tile **p = &buckets[bucketOf(t->expr, t->level, t->index)];
+    while (*p != t) p = &(*p)->chain;
+    *p = t->chain;
+}
+
+/* A tile for the key, recycling the least recently used one when full. */
+static Tile* newTile(unsigned long long expr, int level, long index) {
+    Tile *t;
+    if (n_tiles >= TILE_CACHE_TILES) {
+        t = oldest;
+        unlinkLRU(t);
+        removeFromBucket(t);
+    } else {
+        t = malloc(sizeof(Tile));
+        n_tiles++;
+    }
+    t->expr = expr;
+    t->level = level;
+    t->index = index;
+    size_t b = bucketOf(expr, level, index);
+    t->chain = buckets[b];
+    buckets[b] = t;
+    pushNewest(t);
+    return t;
+}
+
+int tileLevel(double x_min, double x_max, long points) {
+    if (!(x_max > x_min)) return 0;
+    double level = ceil(log2((double)points / (x_max - x_min)));
+    if (level > 900) return 900;
+    if (level < -900) return -900;
+    return (int)level;
+}
+
+void tilesFetch(const Sampler *s, unsigned long long expr, int level,
+                long first, long count, const double **tiles) {
+    for (long k = 0; k < count; k++) {
+        Tile *t = findTile(expr, level, first + k);
+        if (t) {
+            unlinkLRU(t);
+            pushNewest(t);
+        }
+        tiles[k] = t ? t->y : NULL;
+    }
+
+    // Sample each run of missing tiles with one sweep: x = i * 2^-level
+    double step = ldexp(1.0, -level);
+    for (long k = 0; k < count; ) {
+        if (tiles[k]) {
+            k++;
+            continue;
+        }
+        long end = k;
+        while (end < count && !tiles[end]) end++;
+        long n = (end - k) * TILE_POINTS;
+        double *ys = malloc(n * sizeof(double));
+        sampleSweep(s, 1, 0.0, step, (first + k) * TILE_POINTS, n, &ys);
+        for (long j = k; j < end; j++) {
+            Tile *t = newTile(expr, level, first + j);
+            memcpy(t->y, ys + (j - k) * TILE_POINTS, sizeof(t->y));
+            tiles[j] = t->y;
+        }
+        free(ys);
+        k = end;
+    }
+}
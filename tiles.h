@@ -0,0 +1,28 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include "sampler.h"
+
+/* Multi-resolution tile cache.  At zoom level L the x-axis is sampled at
+ * x_i = i * 2^-L, and a tile holds TILE_POINTS consecutive samples: tile k
+ * covers i in [k*TILE_POINTS, (k+1)*TILE_POINTS).  Every x is an exact
+ * binary fraction, so a tile computed for one view matches the samples
+ * any later view would compute, and panning only samples the tiles that
+ * come into sight.  Tiles are keyed by (expression, level, index), where
+ * the expression key is hashAST() of the linked tree: it covers the
+ * values of the variables, so a `let` moves an expression to new tiles.
+ * The least recently used tiles are dropped beyond TILE_CACHE_TILES. */
+
+#define TILE_POINTS      512
+#define TILE_CACHE_TILES 4096
+
+/* Level whose spacing puts at least `points` samples in [x_min, x_max]. */
+int  tileLevel(double x_min, double x_max, long points);
+
+/* Points to tiles first .. first+count-1 of an expression at a level in
+ * tiles[], sampling those that are not cached.  count must not exceed
+ * TILE_CACHE_TILES; the pointers stay valid until the next call. */
+void tilesFetch(const Sampler *s, unsigned long long expr, int level,
+                long first, long count, const double **tiles);
+
+#endif /* TILES_H */
@@ -0,0 +1,251 @@
+#include <math.h>
+#include <string.h>
+#include "vecmath.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+/* ---------- scalar element operations (shared by all paths) ------------- */
+
+#define S_ADD(a, b)   ((a) + (b))
+#define S_SUB(a, b)   ((a) - (b))
+#define S_MUL(a, b)   ((a) * (b))
+#define S_DIV(a, b)   ((fabs(b) < 1e-10) ? NAN : (a) / (b))
+#define S_MAX(a, b)   (((a) > (b)) ? (a) : (b))
+#define S_MIN(a, b)   (((a) < (b)) ? (a) : (b))
+#define S_NEG(a)      (-(a))
+#define S_ABS(a)      fabs(a)
+#define S_SQRT(a)     (((a) >= 0) ? sqrt(a) : NAN)
+#define S_CEIL(a)     ceil(a)
+#define S_FLOOR(a)    floor(a)
+
+#ifdef HAVE_X86_SIMD
+
+/* Sweeps evaluate on several threads at once; they all store the same
+ * answer. */
+static int use_avx2(void) {
+    static int cached = -1;
+    int use = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (use < 0) {
+        __builtin_cpu_init();
+        use = __builtin_cpu_supports("avx2") != 0;
+        __atomic_store_n(&cached, use, __ATOMIC_RELAXED);
+    }
+    return use;
+}
+
+static int use_fma(void) {
+    static int cached = -1;
+    int use = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (use < 0) {
+        __builtin_cpu_init();
+        use = use_avx2() && __builtin_cpu_supports("fma") != 0;
+        __atomic_store_n(&cached, use, __ATOMIC_RELAXED);
+    }
+    return use;
+}
+
+/* ---------- AVX2 element operations -------------------------------------- */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256d avx_div(__m256d a, __m256d b) {
+    __m256d absb = _mm256_andnot_pd(_mm256_set1_pd(-0.0), b);
+    __m256d tiny = _mm256_cmp_pd(absb, _mm256_set1_pd(1e-10), _CMP_LT_OQ);
+    return _mm256_blendv_pd(_mm256_div_pd(a, b), _mm256_set1_pd(NAN), tiny);
+}
+AVX2 static inline __m256d avx_neg(__m256d a) {
+    return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));
+}
+AVX2 static inline __m256d avx_abs(__m256d a) {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+}
+AVX2 static inline __m256d avx_sqrt(__m256d a) {
+    /* sqrt of a negative lane is already NaN; -0.0 stays -0.0 as in sqrt() */
+    return _mm256_sqrt_pd(a);
+}
+AVX2 static inline __m256d avx_ceil(__m256d a) {
+    return _mm256_round_pd(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+}
+AVX2 static inline __m256d avx_floor(__m256d a) {
+    return _mm256_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+
+/* ---------- SSE2 element operations -------------------------------------- */
+
+static inline __m128d sse_div(__m128d a, __m128d b) {
+    __m128d absb = _mm_andnot_pd(_mm_set1_pd(-0.0), b);
+    __m128d tiny = _mm_cmplt_pd(absb, _mm_set1_pd(1e-10));
+    __m128d q    = _mm_div_pd(a, b);
+    return _mm_or_pd(_mm_and_pd(tiny, _mm_set1_pd(NAN)), _mm_andnot_pd(tiny, q));
+}
+static inline __m128d sse_neg(__m128d a) {
+    return _mm_xor_pd(a, _mm_set1_pd(-0.0));
+}
+static inline __m128d sse_abs(__m128d a) {
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+}
+
+/* _mm*_max_pd(a, b) returns b unless a > b, which is exactly S_MAX; the same
+ * holds for min, so NaN propagation matches the scalar evaluator. */
+
+#define BINARY_KERNEL(name, AVX_OP, SSE_OP, S_OP)                             \
+AVX2 static void name##_avx2(double *dst, const double *a,                   \
+                             const double *b, int n) {                       \
+    int i = 0;                                                               \
+    for (; i + 4 <= n; i += 4) {                                             \
+        __m256d va = _mm256_loadu_pd(a + i);                                 \
+        __m256d vb = _mm256_loadu_pd(b + i);                                 \
+        _mm256_storeu_pd(dst + i, AVX_OP(va, vb));                           \
+    }                                                                        \
+    for (; i < n; i++) dst[i] = S_OP(a[i], b[i]);                            \
+}                                                                            \
+static void name##_sse2(double *dst, const double *a,                        \
+                        const double *b, int n) {                            \
+    int i = 0;                                                               \
+    for (; i + 2 <= n; i += 2) {                                             \
+        __m128d va = _mm_loadu_pd(a + i);                                    \
+        __m128d vb = _mm_loadu_pd(b + i);                                    \
+        _mm_storeu_pd(dst + i, SSE_OP(va, vb));                              \
+    }                                                                        \
+    for (; i < n; i++) dst[i] = S_OP(a[i], b[i]);                            \
+}                                                                            \
+void name(double *dst, const double *a, const double *b, int n) {            \
+    if (use_avx2()) name##_avx2(dst, a, b, n);                               \
+    else            name##_sse2(dst, a, b, n);                               \
+}
+
+/* SSE_BODY is the SSE2 loop; it is left empty for ceil/floor, which need
+ * SSE4.1, so those fall through to the scalar tail. */
+#define UNARY_KERNEL(name, AVX_OP, SSE_BODY, S_OP)                            \
+AVX2 static void name##_avx2(double *dst, const double *a, int n) {          \
+    int i = 0;                                                               \
+    for (; i + 4 <= n; i += 4)                                               \
+        _mm256_storeu_pd(dst + i, AVX_OP(_mm256_loadu_pd(a + i)));           \
+    for (; i < n; i++) dst[i] = S_OP(a[i]);                                  \
+}                                                                            \
+static void name##_sse2(double *dst, const double *a, int n) {               \
+    int i = 0;                                                               \
+    SSE_BODY                                                                 \
+    for (; i < n; i++) dst[i] = S_OP(a[i]);                                  \
+}                                                                            \
+void name(double *dst, const double *a, int n) {                             \
+    if (use_avx2()) name##_avx2(dst, a, n);                                  \
+    else            name##_sse2(dst, a, n);                                  \
+}
+
+#define SSE_LOOP(SSE_OP)                                                      \
+    for (; i + 2 <= n; i += 2)                                               \
+        _mm_storeu_pd(dst + i, SSE_OP(_mm_loadu_pd(a + i)));
+
+BINARY_KERNEL(vec_add, _mm256_add_pd, _mm_add_pd, S_ADD)
+BINARY_KERNEL(vec_sub, _mm256_sub_pd, _mm_sub_pd, S_SUB)
+BINARY_KERNEL(vec_mul, _mm256_mul_pd, _mm_mul_pd, S_MUL)
+BINARY_KERNEL(vec_div, avx_div,       sse_div,    S_DIV)
+BINARY_KERNEL(vec_max, _mm256_max_pd, _mm_max_pd, S_MAX)
+BINARY_KERNEL(vec_min, _mm256_min_pd, _mm_min_pd, S_MIN)
+
+UNARY_KERNEL(vec_neg,   avx_neg,   SSE_LOOP(sse_neg),     S_NEG)
+UNARY_KERNEL(vec_abs,   avx_abs,   SSE_LOOP(sse_abs),     S_ABS)
+UNARY_KERNEL(vec_sqrt,  avx_sqrt,  SSE_LOOP(_mm_sqrt_pd), S_SQRT)
+UNARY_KERNEL(vec_ceil,  avx_ceil,  ,                      S_CEIL)
+UNARY_KERNEL(vec_floor, avx_floor, ,                      S_FLOOR)
+
+__attribute__((target("avx2,fma")))
+static void vec_fma_fma3(double *dst, const double *a, const double *b,
+                         const double *c, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d r = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i),
+                                    _mm256_loadu_pd(c + i));
+        _mm256_storeu_pd(dst + i, r);
+    }
+    for (; i < n; i++) dst[i] = fma(a[i], b[i], c[i]);
+}
+
+void vec_fma(double *dst, const double *a, const double *b, const double *c, int n) {
+    if (use_fma()) {
+        vec_fma_fma3(dst, a, b, c, n);
+        return;
+    }
+    for (int i = 0; i < n; i++) dst[i] = fma(a[i], b[i], c[i]);
+}
+
+#else /* !HAVE_X86_SIMD: portable scalar kernels */
+
+#define BINARY_KERNEL(name, S_OP)                                             \
+void name(double *dst, const double *a, const double *b, int n) {            \
+    for (int i = 0; i < n; i++) dst[i] = S_OP(a[i], b[i]);                   \
+}
+#define UNARY_KERNEL(name, S_OP)                                              \
+void name(double *dst, const double *a, int n) {                             \
+    for (int i = 0; i < n; i++) dst[i] = S_OP(a[i]);                         \
+}
+
+BINARY_KERNEL(vec_add, S_ADD)
+BINARY_KERNEL(vec_sub, S_SUB)
+BINARY_KERNEL(vec_mul, S_MUL)
+BINARY_KERNEL(vec_div, S_DIV)
+BINARY_KERNEL(vec_max, S_MAX)
+BINARY_KERNEL(vec_min, S_MIN)
+
+UNARY_KERNEL(vec_neg,   S_NEG)
+UNARY_KERNEL(vec_abs,   S_ABS)
+UNARY_KERNEL(vec_sqrt,  S_SQRT)
+UNARY_KERNEL(vec_ceil,  S_CEIL)
+UNARY_KERNEL(vec_floor, S_FLOOR)
+
+void vec_fma(double *dst, const double *a, const double *b, const double *c, int n) {
+    for (int i = 0; i < n; i++) dst[i] = fma(a[i], b[i], c[i]);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/* ---------- kernels without a vector instruction -------------------------- */
+
+void vec_fill(double *dst, double value, int n) {
+    for (int i = 0; i < n; i++) dst[i] = value;
+}
+
+void vec_pow(double *dst, const double *a, const double *b, int n) {
+    for (int i = 0; i < n; i++) dst[i] = pow(a[i], b[i]);
+}
+
+#define MAP_KERNEL(name, EXPR)                                                \
+static void name(double *dst, const double *a, int n) {                      \
+    for (int i = 0; i < n; i++) { double v = a[i]; dst[i] = (EXPR); }        \
+}
+
+MAP_KERNEL(map_sin,   sin(v))
+MAP_KERNEL(map_cos,   cos(v))
+MAP_KERNEL(map_tan,   tan(v))
+MAP_KERNEL(map_exp,   exp(v))
+MAP_KERNEL(map_log,   (v > 0) ? log10(v) : NAN)
+MAP_KERNEL(map_ln,    (v > 0) ? log(v) : NAN)
+MAP_KERNEL(map_asin,  asin(v))
+MAP_KERNEL(map_acos,  acos(v))
+MAP_KERNEL(map_atan,  atan(v))
+MAP_KERNEL(map_sinh,  sinh(v))
+MAP_KERNEL(map_cosh,  cosh(v))
+MAP_KERNEL(map_tanh,  tanh(v))
+MAP_KERNEL(map_sign,  (v > 0) ? 1 : (v < 0) ? -1 : v)
+
+typedef void (*UnaryKernel)(double *dst, const double *a, int n);
+
+static const UnaryKernel unary_kernels[FN_COUNT] = {
+    [FN_SIN] = map_sin, [FN_COS] = map_cos, [FN_TAN] = map_tan,
+    [FN_EXP] = map_exp, [FN_LOG] = map_log, [FN_SQRT] = vec_sqrt,
+    [FN_ABS] = vec_abs, [FN_LN] = map_ln,
+    [FN_ASIN] = map_asin, [FN_ACOS] = map_acos, [FN_ATAN] = map_atan,
+    [FN_SINH] = map_sinh, [FN_COSH] = map_cosh, [FN_TANH] = map_tanh,
+    [FN_CEIL] = vec_ceil, [FN_FLOOR] = vec_floor,
+    [FN_SIGN] = map_sign,
+};
+
+int vec_func(BuiltinFunc func, double *dst, const double *a, int n) {
+    if (func >= FN_COUNT || !unary_kernels[func]) return 0;
+    unary_kernels[func](dst, a, n);
+    return 1;
+}
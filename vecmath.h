@@ -0,0 +1,33 @@
+#ifndef VECMATH_H
+#define VECMATH_H
+
+#include "ast.h"
+
+/* Column kernels used by evaluate_batch().  Every kernel writes n results
+ * to dst; dst may alias either input.  Arithmetic, abs, sqrt, ceil, floor
+ * and max/min run as AVX2 or SSE2 code when the CPU supports it, with a
+ * scalar fallback elsewhere.  Semantics match evaluate() element for
+ * element, including the NaN returned for near-zero divisors. */
+
+void vec_fill(double *dst, double value, int n);
+void vec_add(double *dst, const double *a, const double *b, int n);
+void vec_sub(double *dst, const double *a, const double *b, int n);
+void vec_mul(double *dst, const double *a, const double *b, int n);
+void vec_div(double *dst, const double *a, const double *b, int n);
+void vec_max(double *dst, const double *a, const double *b, int n);
+void vec_min(double *dst, const double *a, const double *b, int n);
+void vec_pow(double *dst, const double *a, const double *b, int n);
+
+/* dst = a*b + c rounded once, as fma(); uses FMA3 when available. */
+void vec_fma(double *dst, const double *a, const double *b, const double *c, int n);
+
+void vec_neg(double *dst, const double *a, int n);
+void vec_abs(double *dst, const double *a, int n);
+void vec_sqrt(double *dst, const double *a, int n);
+void vec_ceil(double *dst, const double *a, int n);
+void vec_floor(double *dst, const double *a, int n);
+
+/* Applies a unary builtin; transcendental functions loop over libm. */
+int  vec_func(BuiltinFunc func, double *dst, const double *a, int n);
+
+#endif /* VECMATH_H */
@@ -0,0 +1,116 @@
+#include "viewport.h"
+#include "tiles.h"
+#include "interval.h"
+
+#define VIEW_MAX_CURVES 16
+/* Tiles per curve and redraw; a view needs 9-17 of them */
+#define VIEW_MAX_TILES  64
+
+typedef struct {
+    Sampler            sampler;
+    unsigned long long expr;        /* tile key, hashAST() of the linked tree */
+    char               title[128];
+    const char        *color;
+} ViewCurve;
+
+static struct {
+    ViewCurve    curves[VIEW_MAX_CURVES];
+    int          n;
+    char         title[128];
+    DecimateMode decimate;
+    long         width;
+    int          y_bounds;
+    double       x_min, x_max;      /* the range gnuplot showed last */
+    int          known;
+} view;
+
+void viewportRelease(void) {
+    for (int i = 0; i < view.n; i++) releaseSampler(&view.curves[i].sampler);
+    view.n = 0;
+    view.known = 0;
+}
+
+void viewportTrack(const char *title, const Sampler *samplers, const Curve *curves,
+                   int n, DecimateMode decimate, long width, int y_bounds) {
+    viewportRelease();
+    if (n > VIEW_MAX_CURVES) n = VIEW_MAX_CURVES;
+    for (int i = 0; i < n; i++) {
+        ViewCurve *v = &view.curves[i];
+        v->sampler = samplers[i];
+        v->expr = hashAST(samplers[i].node);
+        snprintf(v->title, sizeof(v->title), "%s", curves[i].title);
+        v->color = curves[i].color;
+    }
+    view.n = n;
+    snprintf(view.title, sizeof(view.title), "%s", title);
+    view.decimate = decimate;
+    view.width = width;
+    view.y_bounds = y_bounds;
+}
+
+int viewportActive(void) {
+    return view.n > 0;
+}
+
+/* Fills a curve with the tile samples in [x_min, x_max], plus one on
+ * either side so the line reaches the edges. */
+static void sampleView(ViewCurve *v, Curve *c, double x_min, double x_max) {
+    int level = tileLevel(x_min, x_max, VIEW_SAMPLES);
+    double step = ldexp(1.0, -level);
+    // Beyond 2^52 samples from 0, neighbouring x values are no longer distinct
+    if (fmax(fabs(x_min), fabs(x_max)) / step > 0x1p52) return;
+    long i_min = (long)floor(x_min / step) - 1, i_max = (long)ceil(x_max / step) + 1;
+    long first = (long)floor((double)i_min / TILE_POINTS);
+    long count = (long)floor((double)i_max / TILE_POINTS) - first + 1;
+    if (count > VIEW_MAX_TILES) count = VIEW_MAX_TILES;
+
+    const double *tiles[VIEW_MAX_TILES];
+    tilesFetch(&v->sampler, v->expr, level, first, count, tiles);
+    curveDecimate(c, view.decimate, view.width, x_min, x_max);
+    for (long k = 0; k < count; k++) {
+        for (long j = 0; j < TILE_POINTS; j++) {
+            long i = (first + k) * TILE_POINTS + j;
+            if (i >= i_min && i <= i_max) curveAdd(c, (double)i * step, tiles[k][j]);
+        }
+    }
+}
+
+static int redraw(double x_min, double x_max) {
+    Curve curves[VIEW_MAX_CURVES];
+    for (int i = 0; i < view.n; i++) {
+        memset(&curves[i], 0, sizeof(Curve));
+        snprintf(curves[i].title, sizeof(curves[i].title), "%s", view.curves[i].title);
+        curves[i].color = view.curves[i].color;
+        sampleView(&view.curves[i], &curves[i], x_min, x_max);
+    }
+    double y_min = NAN, y_max = NAN;
+    if (view.y_bounds) {
+        ASTNode *nodes[VIEW_MAX_CURVES];
+        for (int i = 0; i < view.n; i++) nodes[i] = view.curves[i].sampler.node;
+        intervalYLimits(nodes, view.n, x_min, x_max, &y_min, &y_max);
+    }
+    int ok = plotCurvesRange(view.title, curves, view.n, x_min, x_max, y_min, y_max);
+    for (int i = 0; i < view.n; i++) curveFree(&curves[i]);
+    return ok;
+}
+
+int viewportPoll(void) {
+    double x_min, x_max;
+    // After a let or def the curves are re-plotted; never redraw the old ones
+    for (int i = 0; i < view.n; i++) {
+        if (!samplerCurrent(&view.curves[i].sampler)) {
+            viewportRelease();
+            return 0;
+        }
+    }
+    if (!view.n || !plotterView(&x_min, &x_max) || !(x_max > x_min)) return 0;
+    // The first answer after a plot is the range it was drawn with
+    double eps = 1e-9 * (x_max - x_min);
+    if (view.known && fabs(x_min - view.x_min) <= eps && fabs(x_max - view.x_max) <= eps)
+        return 0;
+    int redrawn = view.known && redraw(x_min, x_max);
+    view.x_min = x_min;
+    view.x_max = x_max;
+    view.known = 1;
+    return redrawn;
+}
@@ -0,0 +1,28 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "sampler.h"
+#include "plotter.h"
+
+/* Follows zooming and panning in the plot window.  After a plot, its
+ * samplers are kept; viewportPoll() asks gnuplot which x-range it shows
+ * and, when that has changed, re-samples just that range at screen
+ * resolution from the tile cache and redraws. */
+
+/* Samples per visible range; the tile level puts 1-2x this many in view. */
+#define VIEW_SAMPLES 4096
+/* How often the idle prompt asks gnuplot for its x-range. */
+#define VIEW_POLL_MS 250
+
+/* Takes over n prepared samplers, whose nodes must be in the process
+ * arena, with the titles and colors of the curves that were just plotted.
+ * Releases the samplers tracked before.  With y_bounds, each redraw fixes
+ * the y-axis to the interval bounds of the curves over the view. */
+void viewportTrack(const char *title, const Sampler *samplers, const Curve *curves,
+                   int n, DecimateMode decimate, long width, int y_bounds);
+void viewportRelease(void);
+int  viewportActive(void);
+/* Returns 1 if the plot was redrawn. */
+int  viewportPoll(void);
+
+#endif /* VIEWPORT_H */